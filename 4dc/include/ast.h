@@ -3,12 +3,29 @@
 
 #include <string>
 #include <vector>
+#include <set>
 #include <iostream>
 #include <initializer_list>
 #include "llvm-dependencies.h"
 #include "vartype.h"
 
 class Builder;
+class BytecodeBuilder;
+
+/*
+ * Effets d'un fragment de code, utilisés pour prouver qu'une boucle For
+ * n'accède à ses tableaux que dans leurs bornes.
+ */
+struct CodeEffects
+{
+  std::set<std::string> readLocals;    // variables locales lues
+  std::set<std::string> writtenLocals; // variables locales affectées
+  bool readsGlobals = false;  // variables globales ou persistantes lues
+  bool writesGlobals = false; // variables globales ou persistantes affectées
+  bool calls = false;   // appel de méthode ou de builtin ayant un effet
+  bool resizes = false; // appel pouvant redimensionner un tableau
+  std::vector<std::pair<std::string, std::string>> indexedArrays; // $tableau{$index}
+};
 
 class AST
 {
@@ -21,20 +38,26 @@ class AST
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
-                ) {return this->_taggingPass(argVars, localVars, globaleVars, persistentVars);};
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                ) {return this->_taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);};
+    inline void effects(CodeEffects& e) const {this->_effects(e);}
 
     template<class T = AST>
     static T* Error(const std::string& msg);
     friend std::ostream& operator<<(std::ostream& out, const AST& ast);
   protected:
     virtual bool _isVar() const;
+    virtual void _effects(CodeEffects&) const;
   private:
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 ) = 0;
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const = 0;
 };
@@ -56,15 +79,19 @@ class BlocAST : public AST
     virtual ~BlocAST();
     virtual llvm::BasicBlock* Codegen(Builder&, llvm::Function* = nullptr);
     virtual llvm::BasicBlock* Codegen(Builder&, const std::string&, llvm::Function* = nullptr);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     std::vector<StatementAST*> _statements; // delete at destruction
     
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -75,6 +102,7 @@ class StatementAST : public AST
   public:
     virtual ~StatementAST();
     virtual bool Codegen(Builder&) = 0;
+    virtual bool Bytecodegen(BytecodeBuilder&) = 0;
   protected:
   private:
   
@@ -88,15 +116,19 @@ class StatementExprAST : public StatementAST
     StatementExprAST(ExprAST*);
     virtual ~StatementExprAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     ExprAST* _expr; // delete at destruction
     
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -108,16 +140,21 @@ class AffectationAST : public StatementAST
     AffectationAST(VariableAST * variableAST, ExprAST* expr);
     virtual ~AffectationAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     VariableAST * _variableAST;
     ExprAST* _expr; // delete at destruction
     
+    bool isSelfAppend() const;
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -130,16 +167,20 @@ class IfAST : public StatementAST
     IfAST(ExprAST* condAST, BlocAST* thenAST, BlocAST* elseAST);
     virtual ~IfAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     ExprAST *_condAST; // delete at destruction
     BlocAST *_thenAST, *_elseAST; // delete at destruction
     
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -150,6 +191,7 @@ class ForAST : public StatementAST
     ForAST(VariableAST * variableAST, ExprAST * beginAST, ExprAST * endAST, ExprAST * incrementAST, BlocAST* loopAST);
     virtual ~ForAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     VariableAST * _variableAST;
@@ -158,11 +200,20 @@ class ForAST : public StatementAST
     ExprAST *_incrementAST;
     BlocAST *_loopAST;
     
+    bool inBoundsCandidate(std::string& index, std::set<std::string>& arrays, long& step) const;
+    bool CodegenInBoundsCheck(Builder&, llvm::Value* beginV, const std::set<std::string>& arrays, long step,
+                              llvm::BasicBlock* checkedBB, std::map<std::string, llvm::Value*>& data, llvm::Value*& endV);
+    bool CodegenInBoundsLoop(Builder&, llvm::Value* endV, long step, llvm::BasicBlock* endBB);
+    bool CodegenLoop(Builder&, llvm::Value* beginV, llvm::BasicBlock* endBB);
+    bool CodegenIteration(Builder&, bool inBounds);
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -174,16 +225,20 @@ class WhileAST : public StatementAST
     WhileAST(ExprAST* condAST, BlocAST* loopAST);
     virtual ~WhileAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     ExprAST *_condAST;
     BlocAST *_loopAST;
     
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -195,16 +250,132 @@ class RepeatAST : public StatementAST
     RepeatAST(ExprAST* condAST, BlocAST* loopAST);
     virtual ~RepeatAST();
     virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     ExprAST *_condAST;
     BlocAST *_loopAST;
     
+    virtual void _effects(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+class CaseAST : public StatementAST
+{
+  public:
+    CaseAST(const std::vector<std::pair<ExprAST*, BlocAST*>>& cases, BlocAST* elseAST);
+    virtual ~CaseAST();
+    virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+  protected:
+  private:
+    std::vector<std::pair<ExprAST*, BlocAST*>> _cases; // delete at destruction
+    BlocAST *_elseAST; // delete at destruction
+    
+    bool switchable(ExprAST*& subject, std::vector<long>& values) const;
+    bool CodegenSwitch(Builder&, ExprAST* subject, const std::vector<long>& values);
+    bool CodegenChain(Builder&);
+    
+    virtual void _effects(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+// ARRAY LONGINT($tableau; taille), ARRAY REAL, ARRAY TEXT : crée ou
+// redimensionne le tableau
+class ArrayDeclarationAST : public StatementAST
+{
+  public:
+    ArrayDeclarationAST(const std::string& kind, VariableAST* array, ExprAST* size);
+    virtual ~ArrayDeclarationAST();
+    virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+  protected:
+  private:
+    std::string _kind;
+    VariableAST* _array; // delete at destruction
+    ExprAST* _size; // delete at destruction
+
+    std::string builtin() const;
+    virtual void _effects(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+// C_REAL($x; $y...), C_LONGINT(...), C_INTEGER(...), C_INTEGER 64 BITS(...),
+// C_TEXT(...), C_OBJECT(...), C_COLLECTION(...) : type des variables, sans
+// code généré
+class DeclarationAST : public StatementAST
+{
+  public:
+    DeclarationAST(VarType vtype, const std::vector<VariableAST*>& variables);
+    virtual ~DeclarationAST();
+    virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+  protected:
+  private:
+    VarType _vtype;
+    std::vector<VariableAST*> _variables; // delete at destruction
+
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+// SORT ARRAY($cle; $tableau2; ...; > ou <) : les tableaux suivants sont
+// réordonnés comme la clé
+class SortArrayAST : public StatementAST
+{
+  public:
+    SortArrayAST(const std::vector<VariableAST*>& arrays, bool descending);
+    virtual ~SortArrayAST();
+    virtual bool Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+  protected:
+  private:
+    std::vector<VariableAST*> _arrays; // delete at destruction
+    bool _descending;
+
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -215,10 +386,15 @@ class ExprAST : public AST
   public:
     virtual ~ExprAST();
     virtual llvm::Value* Codegen(Builder&) = 0;
+    virtual bool Bytecodegen(BytecodeBuilder&) = 0;
     void setType(VarType vtype);
     VarType getType() const;
+    inline bool isConstantInt(long& val) const {return this->_isConstantInt(val);}
+    inline bool isLocal(std::string& name) const {return this->_isLocal(name);}
   protected:
     VarType _vtype;
+    virtual bool _isConstantInt(long& val) const;
+    virtual bool _isLocal(std::string& name) const;
   private:
     
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const = 0;
@@ -230,7 +406,9 @@ class LiteralAST : public ExprAST
     LiteralAST(const std::string& val, VarType vtype);
     virtual ~LiteralAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
+    virtual bool _isConstantInt(long& val) const;
   private:
     std::string _val;
     
@@ -238,7 +416,9 @@ class LiteralAST : public ExprAST
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -250,10 +430,14 @@ class VariableAST : public ExprAST
     VariableAST();
     virtual ~VariableAST();
     virtual llvm::Value* Codegen(Builder&) = 0;
+    virtual bool Bytecodegen(BytecodeBuilder&) = 0;
     virtual llvm::Value* CodegenMute(Builder&, llvm::Value*) = 0;
+    virtual bool BytecodegenMute(BytecodeBuilder&) = 0;
+    inline void effectsMute(CodeEffects& e) const {this->_effectsMute(e);}
   protected:
     virtual bool _isVar() const;
   private:
+    virtual void _effectsMute(CodeEffects&) const = 0;
     
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const = 0;
 };
@@ -264,16 +448,23 @@ class LocalVariableAST : public VariableAST
     LocalVariableAST(const std::string &);
     virtual ~LocalVariableAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
     virtual llvm::Value* CodegenMute(Builder&, llvm::Value*);
+    virtual bool BytecodegenMute(BytecodeBuilder&);
   protected:
+    virtual bool _isLocal(std::string& name) const;
   private:
     std::string _name;
     
+    virtual void _effectsMute(CodeEffects&) const;
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -285,16 +476,22 @@ class GlobaleVariableAST : public VariableAST
     GlobaleVariableAST(const std::string &);
     virtual ~GlobaleVariableAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
     virtual llvm::Value* CodegenMute(Builder&, llvm::Value*);
+    virtual bool BytecodegenMute(BytecodeBuilder&);
   protected:
   private:
     std::string _name;
     
+    virtual void _effectsMute(CodeEffects&) const;
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -306,37 +503,144 @@ class PersistentVariableAST : public VariableAST
     PersistentVariableAST(const std::string &);
     virtual ~PersistentVariableAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
     virtual llvm::Value* CodegenMute(Builder&, llvm::Value*);
+    virtual bool BytecodegenMute(BytecodeBuilder&);
   protected:
   private:
     std::string _name;
 
+    virtual void _effectsMute(CodeEffects&) const;
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
     
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
 };
 
+// Élément d'un tableau : $tableau{$index}
+class ArrayElementAST : public VariableAST
+{
+  public:
+    ArrayElementAST(VariableAST* array, ExprAST* index);
+    virtual ~ArrayElementAST();
+    virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+    virtual llvm::Value* CodegenMute(Builder&, llvm::Value*);
+    virtual bool BytecodegenMute(BytecodeBuilder&);
+  protected:
+  private:
+    VariableAST* _array; // delete at destruction
+    ExprAST* _index; // delete at destruction
+
+    llvm::Value* CodegenElement(Builder&);
+    virtual void _effects(CodeEffects&) const;
+    virtual void _effectsMute(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+// Attribut d'un objet, $objet.nom ou $objet[texte], ou élément d'une
+// collection, $collection[index]
+class PropertyAST : public VariableAST
+{
+  public:
+    PropertyAST(ExprAST* object, const std::string& name);
+    PropertyAST(ExprAST* object, ExprAST* key);
+    virtual ~PropertyAST();
+    virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+    virtual llvm::Value* CodegenMute(Builder&, llvm::Value*);
+    virtual bool BytecodegenMute(BytecodeBuilder&);
+  protected:
+  private:
+    ExprAST* _object; // delete at destruction
+    std::string _name; // attribut nommé, sinon _key
+    ExprAST* _key; // delete at destruction
+
+    bool isElement() const;
+    bool borrowsObject(std::string& local) const;
+    int accessKind() const;
+    bool CodegenAccess(Builder&, bool mute, llvm::Value*& object, llvm::Value*& key);
+    bool BytecodegenAccess(BytecodeBuilder&, bool mute);
+    virtual void _effects(CodeEffects&) const;
+    virtual void _effectsMute(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
+// Méthode d'une collection : $collection.push(valeur),
+// $collection.insert(index; valeur). Renvoie la collection.
+class MemberCallAST : public ExprAST
+{
+  public:
+    MemberCallAST(ExprAST* object, const std::string& name, const std::vector<ExprAST*>& args);
+    virtual ~MemberCallAST();
+    virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+  protected:
+  private:
+    ExprAST* _object; // delete at destruction
+    std::string _name;
+    std::vector<ExprAST*> _args; // delete at destruction
+
+    bool checkArgs() const;
+    virtual void _effects(CodeEffects&) const;
+    virtual void _taggingPass(
+                  std::map<int, VarType>& argVars,
+                  std::map<std::string, VarType>& localVars,
+                  std::map<std::string, VarType>& globaleVars,
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
+                );
+
+    virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
+};
+
 class UniOpAST : public ExprAST
 {
   public:
     UniOpAST(const std::string& op, ExprAST* expr);
     virtual ~UniOpAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
+    virtual bool _isConstantInt(long& val) const;
   private:
     std::string _str;
     ExprAST *_expr; // delete at destruction
 
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
     
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -348,16 +652,29 @@ class BinOpAST : public ExprAST
     BinOpAST(const std::string& op, ExprAST* lhs, ExprAST* rhs);
     virtual ~BinOpAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
+    
+    inline const std::string& op() const {return this->_str;}
+    inline ExprAST* lhs() const {return this->_lhs;}
+    inline ExprAST* rhs() const {return this->_rhs;}
   protected:
   private:
     std::string _str;
     ExprAST *_lhs, *_rhs; // delete at destruction
 
+    bool isText() const;
+    bool isReal() const;
+    bool isLong() const;
+    llvm::Value* CodegenText(Builder&, llvm::Value* L, llvm::Value* R);
+    llvm::Value* CodegenReal(Builder&, llvm::Value* L, llvm::Value* R);
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
     
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -370,16 +687,21 @@ class CallAST : public ExprAST
     CallAST(const std::string&, const std::vector<ExprAST*>&);
     virtual ~CallAST();
     virtual llvm::Value* Codegen(Builder&);
+    virtual bool Bytecodegen(BytecodeBuilder&);
   protected:
   private:
     std::string _name;
     std::vector<ExprAST*> _args; // delete at destruction
     
+    std::string builtinName() const;
+    virtual void _effects(CodeEffects&) const;
     virtual void _taggingPass(
                   std::map<int, VarType>& argVars,
                   std::map<std::string, VarType>& localVars,
                   std::map<std::string, VarType>& globaleVars,
-                  std::map<std::string, VarType>& persistentVars
+                  std::map<std::string, VarType>& persistentVars,
+                  const std::map<std::string, VarType>& returnTypes,
+                  std::map<std::string, VarType>& propertyTypes
                 );
 
     virtual std::string _toString(const std::string& firstPrefix, const std::string& prefix) const;
@@ -0,0 +1,53 @@
+#ifndef BACKGROUNDCOMPILER_H
+#define BACKGROUNDCOMPILER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Compilation des méthodes en arrière-plan pendant l'exécution du programme.
+ *
+ * Le code généré appelle chaque méthode via un pointeur (slot). Tant que la
+ * méthode n'est pas compilée, son slot pointe sur un stub qui attend sa
+ * compilation (en la faisant passer en priorité) puis rappelle le slot.
+ * Une méthode compilée est installée en écrivant son adresse dans le slot.
+ */
+class BackgroundCompiler
+{
+  public:
+    // Compile la méthode numéro i et renvoie l'adresse de son code natif
+    typedef std::function<void*(unsigned)> Compiler;
+
+    BackgroundCompiler(const std::vector<intptr_t*>& slots, Compiler compiler);
+    ~BackgroundCompiler();
+
+    // Sans code (erreur de compilation), les appels de la méthode échouent
+    void install(unsigned method, void* code);
+    void start();
+    unsigned compiled();
+
+    // Appelée par les stubs depuis le code natif
+    static int32_t wait(int32_t method);
+  protected:
+  private:
+    std::vector<intptr_t*> _slots;
+    Compiler _compiler;
+    std::vector<bool> _compiled;
+    std::vector<bool> _failed;
+    std::deque<unsigned> _queue; // méthodes restant à compiler, par priorité
+    bool _stop;
+    std::mutex _mutex;
+    std::condition_variable _installed;
+    std::thread _thread;
+
+    static BackgroundCompiler* _current;
+
+    void run();
+};
+
+#endif // BACKGROUNDCOMPILER_H
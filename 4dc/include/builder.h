@@ -3,6 +3,7 @@
 
 #include "ast.h"
 #include "llvm-dependencies.h"
+#include "options.h"
 #include "util/file.h"
 #include <map>
 #include <string>
@@ -10,20 +11,44 @@
 #include <iostream>
 
 class Parser;
+class DiskObjectCache;
 class Func;
 class FunctionSignature;
 class Builder
 {
+  friend class Session;
+  friend struct fourdc_context;
   public:
     Builder();
     Builder(const std::string&);
+    Builder(const std::string&, llvm::LLVMContext&);
     ~Builder();
 
-    static void buildAll(const std::vector<std::pair<std::string,File>>&);
+    static void buildAll(const std::vector<std::pair<std::string,File>>&, const Options&, Builder* prepared = nullptr);
+    static Builder* prepare(const Options&);
+    static Builder* warmUp();
+    bool accepts(const Options&) const;
     void createJIT();
+    void createTargetMachine();
+    void emit(EmitKind kind, const std::string& filename, const std::string& runtimeLibrary);
     void setOptimizer(llvm::FunctionPassManager*);
+    void setModuleOptimizer(llvm::PassManager*);
+    void setOptLevel(unsigned optLevel, unsigned sizeLevel = 0);
+    void setTarget(const std::string& cpu, const std::vector<std::string>& features);
+    void resolveTarget(std::string& cpu, std::vector<std::string>& features) const;
+    void setLazyCompilation(bool lazy);
+    void setObjectCache(const std::string& directory);
+    void setFastMath(bool fastMath);
 
     llvm::FunctionPassManager* getStandardOptimizer();
+    llvm::PassManager* getStandardModuleOptimizer(unsigned inlineThreshold);
+
+    inline unsigned optLevel() const {return this->_optLevel;}
+    inline unsigned sizeLevel() const {return this->_sizeLevel;}
+    inline bool fastMath() const {return this->_fastMath;}
+    llvm::CodeGenOpt::Level codeGenOptLevel() const;
+    llvm::TargetOptions targetOptions() const;
+    const llvm::DataLayout* dataLayout() const;
 
     inline llvm::Module& module() {return *this->_mod;}
     inline llvm::LLVMContext& context(){return this->_ctx;}
@@ -34,7 +59,23 @@ class Builder
     inline std::map<std::string, llvm::AllocaInst*>& localVars()      {return this->_localVars;     }
     inline std::map<std::string, llvm::GlobalVariable*>& globalVars()     {return this->_globalVars;    }
     inline std::map<std::string, llvm::GlobalVariable*>& persistentVars() {return this->_persistentVars;}
+    llvm::Type* type(VarType vtype);
+    llvm::Value* convert(llvm::Value* V, llvm::Type* to);
+    inline llvm::Value* convert(llvm::Value* V, VarType to) {return this->convert(V, this->type(to));}
+    llvm::Value* loadMethod(const std::string& name, llvm::Function* F);
+    llvm::Value* arrayData(llvm::Value* array, llvm::Value* index, llvm::BasicBlock* failBB);
+    llvm::Value* arrayElement(llvm::Value* array, llvm::Value* index, VarType vtype);
+    llvm::Value* element(llvm::Value* data, llvm::Value* index, VarType vtype);
+    void pushInBounds(const std::string& index, const std::map<std::string, llvm::Value*>& data);
+    void popInBounds();
+    llvm::Value* inBoundsData(const std::string& array, const std::string& index) const;
+    llvm::Value* textConstant(const std::string& text);
+    llvm::Value* objectKey(const std::string& name);
+    llvm::Value* getProperty(llvm::Value* object, const std::string& name, int kind);
+    llvm::Value* setProperty(llvm::Value* object, const std::string& name, int kind, llvm::Value* bits);
+    llvm::Value* callBuiltin(const std::string& builtin, llvm::ArrayRef<llvm::Value*> args, const std::string& name = "");
     void optimize(llvm::Function*);
+    void optimizeModule(const std::vector<llvm::Function*>& methods, bool internalize = true);
     void declareBuiltins();
     void createAllocas(
                     std::map<std::string, VarType>& types,
@@ -43,7 +84,8 @@ class Builder
     );
     void createGlobals(
                     std::map<std::string, VarType>& types,
-                    std::map<std::string, llvm::GlobalVariable*>& vals
+                    std::map<std::string, llvm::GlobalVariable*>& vals,
+                    bool definition = true
     );
     void dumpDebug();
     void dumpDebug(llvm::Function*);
@@ -55,9 +97,31 @@ class Builder
     llvm::BasicBlock* _currentBlock;
     llvm::ExecutionEngine* _jit; // delete at destruction
     llvm::FunctionPassManager* _optimizer; // delete at destruction
+    llvm::PassManager* _moduleOptimizer; // delete at destruction
+    unsigned _optLevel;  // 0 à 3
+    unsigned _sizeLevel; // 0, 1 (-Os) ou 2 (-Oz)
+    bool _fastMath; // calcul réel sans respect strict d'IEEE 754
+    unsigned _inlineThreshold; // seuil d'inlining de _moduleOptimizer
+    std::string _targetCPU; // "native" : processeur hôte
+    std::vector<std::string> _targetFeatures;
+    llvm::TargetMachine* _targetMachine; // owned by the JIT, else delete at destruction
+    bool _lazy; // compilation des méthodes lors de leur premier appel
+    llvm::JITEventListener* _jitListener; // delete at destruction
+    DiskObjectCache* _objectCache; // delete at destruction, after the JIT
     std::map<std::string, llvm::AllocaInst*> _localVars;
     std::map<std::string, llvm::GlobalVariable*> _globalVars;
     std::map<std::string, llvm::GlobalVariable*> _persistentVars;
+    std::map<std::string, llvm::GlobalVariable*> _methodSlots; // compilation en arrière-plan
+    std::map<std::string, VarType> _returnTypes; // type du résultat des méthodes analysées
+    std::map<std::string, VarType> _propertyTypes; // type des attributs nommés des objets
+    llvm::GlobalVariable* _arrays; // BUILTINarrays : descripteurs des tableaux
+    llvm::GlobalVariable* _arrayCount; // BUILTINarrayCount
+    llvm::GlobalVariable* _objects; // BUILTINobjects : descripteurs des objets
+    llvm::GlobalVariable* _objectCount; // BUILTINobjectCount
+    llvm::StructType* _propertyCacheType; // FourDPropertyCache
+    // Boucles For dont les accès $tableau{$index} sont prouvés dans les bornes :
+    // variable index et données de chaque tableau, chargées avant la boucle
+    std::vector<std::pair<std::string, std::map<std::string, llvm::Value*>>> _inBounds;
     
     Func* parse(
         std::map<std::string, VarType>& globalVars,
@@ -65,9 +129,27 @@ class Builder
         const std::string& name,
         std::istream& in
     );
+    void taggingPass(
+        const std::vector<Func*>& methods,
+        std::map<std::string, VarType>& globalVars,
+        std::map<std::string, VarType>& persistentVars
+    );
     llvm::Function* build(Func* Fdef);
+    std::vector<llvm::Function*> buildParallel(
+        const std::vector<Func*>& methods,
+        const std::map<std::string, VarType>& globalVars,
+        const std::map<std::string, VarType>& persistentVars,
+        unsigned jobs
+    );
+    void runTiered(const std::vector<Func*>& methods, unsigned threshold);
+    void runBackground(const std::vector<Func*>& methods);
+    llvm::Function* createStub(llvm::Function* F, unsigned index, llvm::Function* wait);
+    std::vector<unsigned> calledMethods(llvm::Function* F, const std::vector<Func*>& methods);
     void callFunctionLLVM(llvm::Function *F);
     llvm::Function* createMain(FunctionSignature* signature, llvm::Function *F);
+    llvm::Value* cachedConstant(const std::string& create, const std::string& str, const std::string& name);
+    llvm::Value* propertyCache();
+    static bool execute(const std::vector<std::string>& command);
     static llvm::AllocaInst *createEntryBlockAlloca(llvm::Function *F, const std::string& name, llvm::Type* type);
 };
 
@@ -8,15 +8,23 @@
 
 class Builtin;
 class FunctionSignature;
-int BUILTINalert(int);
+
+// Effets d'un builtin, pour l'analyse des boucles (contrôles de bornes)
+enum class BuiltinEffect
+{
+  NONE,   // aucun effet : peut être réévalué librement
+  IO,     // entrées/sorties, sans effet sur les variables ni les tableaux
+  RESIZE  // peut redimensionner ou déplacer un tableau
+};
 
 class Builtin {
   public:
-    Builtin(FunctionSignature*, void*);
+    Builtin(FunctionSignature*, void*, BuiltinEffect = BuiltinEffect::IO);
     ~Builtin();
     
     inline FunctionSignature* signature() const {return _signature;}
     inline void* getPtr() const {return _ptr;}
+    inline BuiltinEffect effect() const {return _effect;}
     
     static std::map<std::string, Builtin*> _list;
     static std::map<std::string, Builtin*> getList();
@@ -25,6 +33,7 @@ class Builtin {
   private:
     FunctionSignature* _signature;
     void* _ptr;
+    BuiltinEffect _effect;
 };
 
 #endif // BUILTINS_H
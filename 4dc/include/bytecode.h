@@ -0,0 +1,116 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "vartype.h"
+#include "runtime.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * Bytecode à pile interprété par le premier niveau d'exécution (Interpreter).
+ *
+ * Il est généré directement depuis l'AST, sans passer par LLVM : une méthode
+ * exécutée une seule fois (initialisation...) ne paye jamais la génération de
+ * code natif.
+ */
+enum class OpCode : uint8_t
+{
+  PUSH,     // empile arg
+  CONST,    // empile la constante 64 bits numéro arg (réel, entier 64 bits)
+  LOAD,     // empile la variable locale arg
+  STORE,    // dépile dans la variable locale arg
+  LOADG,    // empile la variable globale (ou persistante) ptr
+  STOREG,   // dépile dans la variable globale (ou persistante) ptr
+  LOADGW, STOREGW, // idem pour une variable de 8 octets (réel, entier 64 bits)
+  POP,      // dépile une valeur inutilisée
+  ADD, SUB, MUL, DIV, NEG,
+  LT, LE, GT, GE, EQ, NE,
+  AND, OR,
+  // Entiers 64 bits : les comparaisons sont celles des entiers
+  ADDL, SUBL, MULL, DIVL, NEGL,
+  LTOI,     // tronque l'entier 64 bits au sommet de la pile à 32 bits
+  LTOR,     // convertit l'entier 64 bits au sommet de la pile en réel
+  RTOL,     // convertit le réel au sommet de la pile en entier 64 bits (troncature)
+  // Réels : opérations sur des double
+  ADDR, SUBR, MULR, DIVR, NEGR,
+  LTR, LER, GTR, GER, EQR, NER,
+  ITOR,     // convertit l'entier au sommet de la pile en réel
+  RTOI,     // convertit le réel au sommet de la pile en entier (troncature)
+  MATH,     // applique la fonction double(double) ptr au sommet de la pile
+  JUMP,     // saute à l'instruction arg
+  JUMPZ,    // dépile, et saute à l'instruction arg si la valeur est nulle
+  CALL,     // appelle la méthode numéro arg
+  BUILTIN,  // appelle le builtin ptr, qui prend arg arguments
+  BUILTINR, // appelle le builtin ptr, qui prend un réel
+  BUILTINL, // appelle le builtin ptr, qui prend un entier 64 bits
+  BUILTINIR, // appelle le builtin ptr, qui prend un entier puis un réel
+  RBUILTIN, // appelle le builtin ptr, qui prend un entier et rend un réel
+  // Objets et collections : valeurs de 64 bits de genre arg (FOURDVALUE_*)
+  GETV,     // dépile conteneur et clé, empile ptr(conteneur, clé, arg)
+  SETV,     // dépile valeur, conteneur et clé, empile ptr(conteneur, clé, arg, valeur)
+  GETP,     // GETV de $objet.nom, clé constante, par le cache ptr (FourDPropertyCache)
+  SETP,     // SETV de $objet.nom, clé constante, par le cache ptr
+  RET       // dépile la valeur de retour
+};
+
+struct Instruction
+{
+  OpCode op;
+  int32_t arg;
+  void* ptr;
+};
+
+struct Bytecode
+{
+  std::string name;
+  std::vector<Instruction> code;
+  unsigned argsNumber = 0;
+  unsigned slots = 0;     // variables locales, $0 (retour) et arguments compris
+  unsigned maxStack = 0;  // profondeur maximale de la pile d'évaluation
+  std::vector<int64_t> constants; // constantes de CONST
+  std::deque<FourDPropertyCache> caches; // caches de GETP et SETP, d'adresse fixe
+  std::vector<unsigned> callees; // méthodes appelées
+};
+
+class Func;
+class FunctionSignature;
+class BytecodeBuilder
+{
+  public:
+    BytecodeBuilder(
+        Bytecode& bytecode,
+        const std::vector<Func*>& methods,
+        const std::map<std::string, int32_t*>& globalVars,
+        const std::map<std::string, int32_t*>& persistentVars
+    );
+    ~BytecodeBuilder();
+
+    unsigned emit(OpCode op, int32_t arg = 0, void* ptr = nullptr);
+    unsigned emitReal(double value);
+    unsigned emitLong(int64_t value);
+    FourDPropertyCache* propertyCache();
+    void emitConvert(VarType from, VarType to);
+    inline unsigned here() const {return _bytecode.code.size();}
+    void patch(unsigned instruction, unsigned target);
+
+    int slot(const std::string& name);
+    int newSlot();
+    int32_t* globalVar(const std::string& name) const;
+    int32_t* persistentVar(const std::string& name) const;
+    int method(const std::string& name) const;
+    unsigned argsNumber(int method) const;
+    FunctionSignature* signature(int method) const;
+  protected:
+  private:
+    Bytecode& _bytecode;
+    const std::vector<Func*>& _methods;
+    const std::map<std::string, int32_t*>& _globalVars;
+    const std::map<std::string, int32_t*>& _persistentVars;
+    std::map<std::string, int> _slots;
+    unsigned _stack; // profondeur courante de la pile d'évaluation
+};
+
+#endif // BYTECODE_H
@@ -0,0 +1,20 @@
+#ifndef COMPILEERROR_H
+#define COMPILEERROR_H
+
+#include <stdexcept>
+#include <string>
+
+/*
+ * Erreur de lecture, d'analyse ou de compilation d'un programme 4D.
+ * Le message est celui affiché par le compilateur ("Build Error: ...").
+ * Interceptée par le pilote (main.cpp), la session et lib4dc.
+ */
+class CompileError : public std::runtime_error
+{
+  public:
+    explicit CompileError(const std::string& message)
+      : std::runtime_error(message)
+    {}
+};
+
+#endif // COMPILEERROR_H
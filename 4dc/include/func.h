@@ -9,6 +9,7 @@
 class Builder;
 class FunctionSignature;
 class BlocAST;
+class BytecodeBuilder;
 class Func
 {
   public:
@@ -21,11 +22,18 @@ class Func
     static llvm::Function* create(FunctionSignature*, Builder&);
     
     
+    // returnTypes : type du résultat des méthodes déjà analysées, pour le
+    // typage de leurs appels. propertyTypes : type des attributs nommés des
+    // objets, partagé par toutes les méthodes. Peut être répétée : la
+    // signature est remplacée.
     void taggingPass(
         std::map<std::string, VarType>& globaleVars,
-        std::map<std::string, VarType>& persistentVars
+        std::map<std::string, VarType>& persistentVars,
+        const std::map<std::string, VarType>& returnTypes,
+        std::map<std::string, VarType>& propertyTypes
     );
     llvm::Function* Codegen(Builder&);
+    bool Bytecodegen(BytecodeBuilder&);
     
     friend std::ostream& operator<<(std::ostream&, const Func&);
   protected:
@@ -0,0 +1,88 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "bytecode.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ * Exécution à deux niveaux.
+ *
+ * Les méthodes sont d'abord interprétées depuis leur bytecode. Chacune a un
+ * compteur d'appels et de retours en arrière dans les boucles : lorsqu'une
+ * méthode devient chaude, elle est compilée par le JIT (avec l'optimiseur
+ * habituel) dans un thread de fond, puis ses appels suivants passent
+ * directement par le code natif.
+ */
+class Func;
+class Interpreter
+{
+  public:
+    // Compile les méthodes données en code natif et renvoie leurs adresses
+    typedef std::function<void(const std::vector<unsigned>&, std::vector<void*>&)> Compiler;
+
+    Interpreter(unsigned threshold, Compiler compiler);
+    ~Interpreter();
+
+    bool load(
+        const std::vector<Func*>& methods,
+        const std::map<std::string, int32_t*>& globalVars,
+        const std::map<std::string, int32_t*>& persistentVars
+    );
+    // Les valeurs sont des entiers étendus à 64 bits, ou les bits d'un réel
+    int64_t call(unsigned method, const int64_t* args = nullptr);
+
+    unsigned nativeMethods() const;
+    inline unsigned methods() const {return _methods.size();}
+
+    // Au-delà, les méthodes restent interprétées (appel natif non généré)
+    static const unsigned MAX_NATIVE_ARGS = 6;
+    // Chaque appel interprété occupe un cadre de la pile native : au-delà de
+    // cette profondeur, l'interpréteur attend le code natif de la méthode
+    static const unsigned MAX_DEPTH = 1000;
+    // Appel d'une fonction native à argc arguments entiers (argc <= MAX_NATIVE_ARGS)
+    static int32_t callNative(void* f, unsigned argc, const int32_t* args);
+  protected:
+  private:
+
+    struct Method
+    {
+      unsigned index;
+      Bytecode bytecode;
+      uint64_t calls = 0;
+      uint64_t backEdges = 0;
+      bool requested = false; // compilation demandée
+      bool intSignature = true; // sans réel : appelable par callNative
+      bool compiled = false;  // modifié par le thread de compilation, sous le mutex
+      bool failed = false;    // erreur de compilation : reste interprétée
+      std::atomic<void*> native{nullptr};
+    };
+
+    std::vector<std::unique_ptr<Method>> _methods;
+    unsigned _threshold;
+    Compiler _compiler;
+
+    // Thread de compilation en arrière-plan
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::condition_variable _compiledCond;
+    std::deque<unsigned> _queue;
+    bool _stop;
+    // Profondeur des appels interprétés (l'exécution n'a qu'un thread)
+    unsigned _depth;
+
+    int64_t run(Method& m, const int64_t* args);
+    inline bool hot(const Method& m) const {return m.calls + m.backEdges >= _threshold;}
+    void promote(Method& m);
+    void* waitNative(Method& m);
+    void compileLoop();
+    bool reachable(unsigned method, std::vector<unsigned>& methods) const;
+};
+
+#endif // INTERPRETER_H
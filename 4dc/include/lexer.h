@@ -26,6 +26,7 @@ class Lexer
 
     Token eatIdToken();
     Token eatNumToken();
+    Token eatPropertyToken();
     Token eatStringToken();
     Token eatSymbolToken();
     Token eatOpToken();
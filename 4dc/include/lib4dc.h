@@ -0,0 +1,61 @@
+#ifndef LIB4DC_H
+#define LIB4DC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * lib4dc : le compilateur 4D intégrable dans un programme hôte
+ * (bibliothèque statique lib4dc.a ou partagée lib4dc.so).
+ *
+ * Un contexte reçoit les sources des méthodes depuis la mémoire, les compile
+ * avec le JIT, puis donne accès aux méthodes compilées, qui peuvent être
+ * appelées autant de fois que nécessaire. Les fonctions qui peuvent échouer
+ * renvoient une erreur (NULL en cas de succès), à libérer avec
+ * fourdc_error_dispose.
+ *
+ * Limite : ces erreurs sont celles de l'API (options, compilation, recherche,
+ * nombre d'arguments). Une erreur d'exécution du code 4D (indice hors des
+ * bornes, texte, objet ou JSON invalide...) est affichée sur la sortie
+ * d'erreur et termine le processus, comme pour le compilateur ; une division
+ * entière par zéro n'est pas vérifiée (SIGFPE sur x86). L'hôte qui ne peut pas s'arrêter appelle les
+ * méthodes dans un processus séparé.
+ *
+ * Chaque contexte a ses propres méthodes, variables et types. Le runtime est
+ * commun à tout le processus : tables des textes, des tableaux et des objets,
+ * listes libres, compteurs de références, clés et formes des objets. Les
+ * fonctions de l'API prennent donc un verrou global : des threads peuvent
+ * utiliser des contextes différents, mais une seule méthode 4D s'exécute à
+ * la fois dans le processus. Un contexte ne doit pas être utilisé par
+ * plusieurs threads à la fois.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct fourdc_context fourdc_context;
+typedef struct fourdc_method fourdc_method;
+typedef struct fourdc_error fourdc_error;
+
+/* Contexte de compilation, avec les options de la ligne de commande ("-O3", "-march=generic"...) */
+fourdc_error* fourdc_context_create(const char* const* options, int count, fourdc_context** context);
+void fourdc_context_dispose(fourdc_context* context);
+
+/* Ajoute une méthode à compiler : la dernière ajoutée n'a pas de rôle particulier */
+fourdc_error* fourdc_add_method(fourdc_context* context, const char* name, const char* source, size_t length);
+/* Compile les méthodes ajoutées ; ne peut être appelée qu'une fois par contexte */
+fourdc_error* fourdc_compile(fourdc_context* context);
+
+/* Méthode compilée, valide jusqu'à la destruction de son contexte */
+fourdc_error* fourdc_lookup(fourdc_context* context, const char* name, const fourdc_method** method);
+int fourdc_method_args(const fourdc_method* method);
+fourdc_error* fourdc_call(const fourdc_method* method, const int32_t* args, int count, int32_t* result);
+
+const char* fourdc_error_message(const fourdc_error* error);
+void fourdc_error_dispose(fourdc_error* error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIB4DC_H
@@ -0,0 +1,36 @@
+#ifndef OBJECTCACHE_H
+#define OBJECTCACHE_H
+
+#include "llvm-dependencies.h"
+#include <string>
+
+/*
+ * Cache sur disque du code machine généré par le JIT (MCJIT).
+ *
+ * Chaque module est identifié par une empreinte de son IR optimisé et de la
+ * cible (triplet, processeur, extensions, niveau d'optimisation) : si un
+ * fichier objet correspondant existe, il est chargé directement au lieu de
+ * relancer la génération de code.
+ */
+class DiskObjectCache : public llvm::ObjectCache
+{
+  public:
+    DiskObjectCache(const std::string& directory, const std::string& target);
+    virtual ~DiskObjectCache();
+
+    virtual void notifyObjectCompiled(const llvm::Module* M, const llvm::MemoryBuffer* obj);
+    virtual llvm::MemoryBuffer* getObject(const llvm::Module* M);
+
+    inline unsigned hits() const {return _hits;}
+    inline unsigned misses() const {return _misses;}
+  protected:
+  private:
+    std::string _directory;
+    std::string _target; // description de la cible, ajoutée à l'empreinte
+    unsigned _hits;
+    unsigned _misses;
+
+    std::string filename(const llvm::Module* M) const;
+};
+
+#endif // OBJECTCACHE_H
@@ -0,0 +1,78 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+
+// Format de sortie de la compilation à l'avance (--emit=...)
+enum class EmitKind
+{
+  NONE, // exécution immédiate par le JIT
+  OBJ,  // fichier objet
+  ASM,  // assembleur
+  BC,   // bitcode LLVM
+  SO    // bibliothèque partagée
+};
+
+/*
+ * Options de compilation passées au compilateur (ligne de commande).
+ */
+class Options
+{
+  public:
+    Options();
+    ~Options();
+
+    // Interprète une option de la ligne de commande.
+    // Renvoie false si l'option est inconnue ou mal formée.
+    bool parse(const std::string& arg);
+    static bool isOption(const std::string& arg);
+
+    /* getters */
+    unsigned inlineThreshold() const;
+    inline unsigned optLevel() const {return _optLevel;}
+    inline unsigned sizeLevel() const {return _sizeLevel;}
+    std::string optLevelName() const;
+    inline const std::string& targetCPU() const {return _targetCPU;}
+    inline const std::vector<std::string>& targetFeatures() const {return _targetFeatures;}
+    inline bool lazyCompilation() const {return _lazyCompilation;}
+    inline bool fastMath() const {return _fastMath;}
+    inline EmitKind emitKind() const {return _emitKind;}
+    std::string output(const std::string& source) const;
+    inline const std::string& runtimeLibrary() const {return _runtimeLibrary;}
+    inline const std::string& cacheDirectory() const {return _cacheDirectory;}
+    inline bool tiered() const {return _tiered;}
+    inline unsigned tierThreshold() const {return _tierThreshold;}
+    inline unsigned jobs() const {return _jobs;}
+    inline bool background() const {return _background;}
+    inline bool session() const {return _session;}
+    inline bool watch() const {return _watch;}
+
+    /* setters */
+    inline void setInlineThreshold(unsigned threshold) {_inlineThreshold = threshold; _defaultInlineThreshold = false;}
+    inline void setOptLevel(unsigned optLevel, unsigned sizeLevel = 0) {_optLevel = optLevel; _sizeLevel = sizeLevel;}
+    inline void setOutput(const std::string& output) {_output = output;}
+    inline void setRuntimeLibrary(const std::string& path) {_runtimeLibrary = path;}
+  protected:
+  private:
+    unsigned _inlineThreshold;
+    bool _defaultInlineThreshold; // seuil déduit du niveau d'optimisation
+    unsigned _optLevel;  // -O0 à -O3
+    unsigned _sizeLevel; // -Os : 1, -Oz : 2
+    std::string _targetCPU; // "native" : processeur de la machine hôte
+    std::vector<std::string> _targetFeatures; // "+avx2", "-fma"...
+    bool _lazyCompilation; // méthodes compilées en code natif à leur premier appel
+    bool _fastMath; // calcul réel réassociable, sans infini ni NaN
+    EmitKind _emitKind;
+    std::string _output; // vide : déduit du nom du fichier source
+    std::string _runtimeLibrary; // lib4dcrt.a, liée aux bibliothèques partagées
+    std::string _cacheDirectory; // vide : pas de cache du code machine
+    bool _tiered; // méthodes interprétées, puis compilées lorsqu'elles deviennent chaudes
+    unsigned _tierThreshold; // appels + itérations de boucle avant compilation
+    unsigned _jobs; // threads de compilation des méthodes
+    bool _background; // exécution dès que la méthode d'entrée est compilée
+    bool _session; // session persistante, recompilation des méthodes modifiées
+    bool _watch; // remplacement à chaud des méthodes modifiées pendant l'exécution
+};
+
+#endif // OPTIONS_H
@@ -12,11 +12,13 @@ class Parser
     Parser(Lexer&);
   ~Parser();
   BlocAST* parse();
+  inline int errorLine() const {return _errorLine;}
   protected:
   private:
     Lexer& _lexer;
     Token _tok;
     int _currentLine;
+    int _errorLine; // ligne de la première erreur, 0 si aucune
     
     std::string getErrorHeader();
 
@@ -31,9 +33,12 @@ class Parser
     ExprAST* parenthesis();
     ExprAST* identifier();
     ExprAST* callFunction(std::string functionName);
+    bool callArguments(std::vector<ExprAST*>& args);
+    ExprAST* property(ExprAST* object);
 
     VariableAST* persistantVariable();
     VariableAST* localVariable();
+    VariableAST* arrayElement(VariableAST* array);
 
 
     BlocAST* bloc();
@@ -42,6 +47,10 @@ class Parser
     StatementAST* forstatement();
     StatementAST* whilestatement();
     StatementAST* repeatstatement();
+    StatementAST* casestatement();
+    StatementAST* arraystatement();
+    StatementAST* sortarraystatement();
+    StatementAST* declarationstatement(VarType vtype);
   
     //PrototypeAST* prototype();
     // FunctionAST* functionDef();
@@ -0,0 +1,218 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+/*
+ * Runtime des programmes 4D compilés.
+ *
+ * Ces fonctions sont appelées par le code généré : elles sont liées au JIT
+ * par Builder::declareBuiltins, ou à la bibliothèque statique lib4dcrt.a
+ * pour les programmes compilés à l'avance (--emit=obj|so).
+ * Elles n'utilisent pas LLVM.
+ */
+#include <cstdint>
+
+/*
+ * Tableaux 4D (ARRAY LONGINT, ARRAY INTEGER, ARRAY REAL, ARRAY TEXT) : une
+ * variable tableau contient l'identifiant de son descripteur dans
+ * BUILTINarrays (0 : aucun tableau). Les éléments sont contigus, de l'élément
+ * 0 à l'élément size : des entiers 32 bits, des réels, ou des identifiants de
+ * textes dont le tableau détient une référence. Le descripteur d'un tableau
+ * local est libéré à la sortie de sa méthode, puis réutilisé.
+ */
+#define FOURDARRAY_LONGINT 0
+#define FOURDARRAY_REAL    1
+#define FOURDARRAY_TEXT    2
+struct FourDArray
+{
+  union {
+    int32_t* data;  // entiers, identifiants de textes
+    double* reals;
+  };
+  int32_t size;     // -1 pour le descripteur 0, réservé, et les descripteurs libres
+  int32_t capacity; // éléments alloués, élément 0 compris
+  int32_t kind;     // FOURDARRAY_*, -1 pour un descripteur libre
+};
+
+/*
+ * Textes 4D (UTF-8) : une variable texte contient l'identifiant de son
+ * descripteur dans BUILTINtexts (0 : texte vide). Les textes courts sont
+ * rangés dans le descripteur même, les autres dans un tampon alloué.
+ */
+#define FOURDTEXT_SMALL 15     // octets d'un texte court, zéro final non compris
+#define FOURDTEXT_CONSTANT -1  // références d'un texte littéral, jamais libéré
+struct FourDText
+{
+  int32_t refs;     // références détenues, FOURDTEXT_CONSTANT pour un littéral
+  int32_t size;     // octets, zéro final non compris
+  int32_t capacity; // octets alloués dans data ; 0 : texte court, dans small
+  int32_t length;   // caractères, -1 tant qu'ils ne sont pas comptés
+  union {
+    char* data;
+    char small[FOURDTEXT_SMALL + 1];
+  };
+};
+
+/*
+ * Objets et collections 4D : une variable objet contient l'identifiant de son
+ * descripteur dans BUILTINobjects (0 : objet indéfini). Un objet range ses
+ * propriétés dans l'ordre d'insertion (values), indexées par une table à
+ * adressage ouvert : un octet de contrôle par case (7 bits de l'empreinte de
+ * la clé, FOURDOBJECT_EMPTY ou FOURDOBJECT_DELETED) et la position de la
+ * propriété dans values. Une collection range ses éléments dans values.
+ * Les noms de propriétés sont des clés entières, internées une fois.
+ * Comme les textes, les objets sont comptés en références : variables et
+ * valeurs en détiennent une, un objet est libéré avec sa dernière référence
+ * (un cycle d'objets n'est pas libéré).
+ */
+#define FOURDVALUE_NULL    0
+#define FOURDVALUE_NUMBER  1 // entier 64 bits
+#define FOURDVALUE_REAL    2 // double, bit à bit
+#define FOURDVALUE_TEXT    3 // identifiant d'un texte, dont la valeur détient une référence
+#define FOURDVALUE_OBJECT  4 // identifiant d'un objet ou d'une collection
+#define FOURDVALUE_BOOLEAN 5
+#define FOURDVALUE_RELEASE 0x100 // ajouté au genre d'un accès : l'objet accédé rend ensuite sa référence
+struct FourDValue
+{
+  int32_t key;  // clé de la propriété ; 0 : élément de collection ou propriété supprimée
+  int32_t kind; // FOURDVALUE_*
+  int64_t bits;
+};
+
+#define FOURDOBJECT_OBJECT     1
+#define FOURDOBJECT_COLLECTION 2
+#define FOURDOBJECT_GROUP      16   // cases examinées ensemble lors d'une recherche
+#define FOURDOBJECT_EMPTY      0x80
+#define FOURDOBJECT_DELETED    0xFE
+#define FOURDOBJECT_DICTIONARY -1   // forme des objets sans forme (collection, propriété supprimée...)
+#define FOURDOBJECT_MAX_SHAPED 64   // propriétés au-delà desquelles un objet n'a plus de forme
+struct FourDObject
+{
+  int32_t kind;       // FOURDOBJECT_*, 0 pour le descripteur 0, réservé
+  int32_t shape;      // forme : suite des clés dans l'ordre d'insertion, ou FOURDOBJECT_DICTIONARY
+  int32_t size;       // valeurs utilisées, propriétés supprimées comprises
+  int32_t capacity;   // valeurs allouées
+  int32_t count;      // objet : propriétés définies
+  int32_t slots;      // objet : cases de la table (puissance de 2), 0 sans table
+  int32_t used;       // objet : cases pleines ou supprimées
+  uint8_t* control;   // objet : octet de contrôle de chaque case
+  int32_t* positions; // objet : position dans values de chaque case pleine
+  FourDValue* values;
+  int32_t refs;       // références détenues
+};
+
+/*
+ * Cache d'un accès $objet.nom : deux objets de même forme rangent la
+ * propriété à la même position. La forme 0 n'est celle d'aucun objet.
+ */
+struct FourDPropertyCache
+{
+  int32_t shape;
+  int32_t position;
+};
+
+extern "C" {
+  int BUILTINalert(int);
+  int BUILTINalertReal(double);
+  int BUILTINalertLong(int64_t);
+  int BUILTINabort();
+
+  // Descripteurs des tableaux, lus directement par le code généré
+  extern FourDArray* BUILTINarrays;
+  extern int32_t BUILTINarrayCount;
+
+  int BUILTINarrayResize(int array, int size);
+  int BUILTINarrayResizeReal(int array, int size);
+  int BUILTINarrayResizeText(int array, int size);
+  int BUILTINarrayRelease(int array);
+  int BUILTINarraySize(int array);
+  int BUILTINarrayAppend(int array, int value);
+  int BUILTINarrayAppendReal(int array, double value);
+  int BUILTINarrayAppendText(int array, int text);
+  int BUILTINarrayInsert(int array, int position, int count);
+  int BUILTINarrayDelete(int array, int position, int count);
+  int BUILTINarrayGet(int array, int index);
+  int BUILTINarraySet(int value, int array, int index);
+  // Éléments des tableaux de réels et de textes, appelés par GETV et SETV
+  int64_t BUILTINarrayGetValue(int array, int index, int kind);
+  int BUILTINarraySetValue(int array, int index, int kind, int64_t bits);
+  int BUILTINarrayOutOfBounds(int array, int index);
+
+  // Réductions sur les éléments 1 à size, vectorisées (arraysimd.cpp)
+  int BUILTINarraySum(int array);
+  int BUILTINarrayAverage(int array);
+  int BUILTINarrayMin(int array);
+  int BUILTINarrayMax(int array);
+  int BUILTINarrayFind(int array, int value);
+  double BUILTINarraySumReal(int array);
+  double BUILTINarrayAverageReal(int array);
+  double BUILTINarrayMinReal(int array);
+  double BUILTINarrayMaxReal(int array);
+  int BUILTINarrayFindReal(int array, double value);
+  int BUILTINarrayFindText(int array, int text);
+
+  // SORT ARRAY : tri stable de la clé, les tableaux suivis sont réordonnés comme elle
+  int BUILTINarraySortFollow(int array);
+  int BUILTINarraySort(int array, int descending);
+
+  // Textes (text.cpp). Les fonctions qui reçoivent un texte en rendent la
+  // référence, celles qui en renvoient un en donnent une.
+  extern FourDText* BUILTINtexts;
+  extern int32_t BUILTINtextCount;
+
+  int BUILTINtextNew(const char* data, int size);
+  const char* BUILTINtextData(int text, int* size); // sans rendre la référence
+  int BUILTINtextConstant(const char* data, int size);
+  int BUILTINtextRetain(int text);
+  int BUILTINtextRelease(int text);
+  int BUILTINtextConcat(int left, int right);
+  int BUILTINtextAppendTo(int text, int suffix);
+  int BUILTINtextCompare(int left, int right);
+  int BUILTINtextOrder(int left, int right); // BUILTINtextCompare sans rendre les références
+  int BUILTINtextFromInt(int value);
+  int BUILTINtextFromReal(double value);
+  int BUILTINtextFromLong(int64_t value);
+  int BUILTINtextToInt(int text);
+  int BUILTINalertText(int text);
+
+  // Fonctions sur les textes (textsimd.cpp). Les positions sont comptées en
+  // caractères à partir de 1, les recherches ignorent la casse ASCII.
+  int BUILTINtextLength(int text);
+  int BUILTINtextPosition(int find, int text);
+  int BUILTINtextPositionFrom(int find, int text, int start);
+  int BUILTINtextSubstring(int text, int start, int count);
+  int BUILTINtextSubstringToEnd(int text, int start);
+  int BUILTINtextReplace(int text, int oldText, int newText);
+  int BUILTINtextUppercase(int text);
+  int BUILTINtextLowercase(int text);
+
+  // Objets et collections (object.cpp). Les valeurs passent sur 64 bits avec
+  // leur genre (FOURDVALUE_*) : lues dans le genre demandé, converties s'il
+  // s'agit de nombres, valeur nulle du genre sinon. Un texte ou un objet lu
+  // porte sa propre référence ; OB REMOVE et JSON Stringify rendent celle de
+  // l'objet reçu, BUILTINcollectionInsert la renvoie avec la collection.
+  extern FourDObject* BUILTINobjects;
+  extern int32_t BUILTINobjectCount;
+
+  int BUILTINobjectNew();
+  int BUILTINcollectionNew();
+  int BUILTINobjectRetain(int object);
+  int BUILTINobjectRelease(int object);
+  int BUILTINobjectKey(const char* name, int size);
+  int BUILTINobjectKeyOf(int text);
+  int BUILTINobjectFindKey(int text);
+  const char* BUILTINobjectKeyName(int key, int* size);
+  int64_t BUILTINobjectGet(int object, int key, int kind);
+  int BUILTINobjectSet(int object, int key, int kind, int64_t value);
+  int BUILTINobjectRemove(int object, int text);
+  int64_t BUILTINobjectGetCached(int object, int key, int kind, FourDPropertyCache* cache);
+  int BUILTINobjectSetCached(int object, int key, int kind, int64_t value, FourDPropertyCache* cache);
+  int64_t BUILTINcollectionGet(int collection, int index, int kind);
+  int BUILTINcollectionSet(int collection, int index, int kind, int64_t value);
+  int BUILTINcollectionInsert(int collection, int index, int kind, int64_t value);
+  // JSON (json.cpp) : objets et collections natifs, propriétés dans leur ordre
+  // d'ajout
+  int BUILTINjsonParse(int text);
+  int BUILTINjsonStringify(int object);
+}
+
+#endif // RUNTIME_H
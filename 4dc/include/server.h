@@ -0,0 +1,30 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/*
+ * Serveur de compilation sur une socket Unix locale.
+ *
+ * Le démon initialise une fois pour toutes les cibles LLVM et prépare un
+ * Builder (JIT, optimiseurs, builtins déclarés) pour les options par défaut,
+ * puis crée par fork() un processus par connexion : une requête aux options
+ * par défaut compile avec la copie de ce Builder, les autres en construisent
+ * un. Le processus fils lit la requête : le dossier courant, les arguments et
+ * les descripteurs d'entrée/sortie du client (SCM_RIGHTS) ; le client reçoit
+ * en retour le code de sortie de la compilation. Seul l'utilisateur du démon
+ * peut s'y connecter (SO_PEERCRED).
+ */
+namespace Server {
+  // Compile et exécute un programme à partir des arguments de la ligne de commande
+  typedef std::function<int(const std::vector<std::string>&)> Command;
+
+  // Boucle du démon, jusqu'à SIGINT ou SIGTERM
+  int serve(const std::string& socketPath, Command command);
+  // Envoie une requête au démon et renvoie son code de sortie
+  int request(const std::string& socketPath, const std::vector<std::string>& args);
+}
+
+#endif // SERVER_H
@@ -0,0 +1,69 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "builder.h"
+#include "options.h"
+#include "util/file.h"
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+class Func;
+
+/*
+ * Session de compilation persistante : le Builder et le JIT sont conservés
+ * d'une compilation à l'autre. Pour chaque méthode, la session retient
+ * l'empreinte de son source, sa signature et ses dépendances (méthodes
+ * appelées, variables globales utilisées) : lors d'une mise à jour, seules
+ * les méthodes modifiées et celles qui en dépendent sont recompilées, puis
+ * liées de nouveau dans le JIT.
+ */
+class Session
+{
+  public:
+    Session(const std::vector<std::pair<std::string,File>>& files, const Options& options);
+    ~Session();
+
+    // Recompile les méthodes dont le source a changé depuis la dernière mise à jour.
+    // Renvoie le nombre de méthodes recompilées.
+    unsigned update();
+    // Exécute la méthode d'entrée (dernier fichier)
+    bool run();
+    // Lit les commandes (reload, run, quit) jusqu'à la fin du flux
+    void loop(std::istream& in);
+    // Exécute la méthode d'entrée dans un thread et recompile les fichiers
+    // modifiés pendant l'exécution, jusqu'à la fin de celle-ci
+    bool watch();
+  protected:
+  private:
+    struct Method
+    {
+      Func* def; // delete at destruction
+      uint64_t hash; // empreinte du source
+      std::set<std::string> callees;
+      std::set<std::string> globals;
+    };
+
+    Builder _builder;
+    std::vector<std::pair<std::string,File>> _files;
+    std::map<std::string, Method> _methods;
+    std::map<std::string, VarType> _globalVars;
+    std::map<std::string, VarType> _persistentVars;
+    std::string _entry; // nom de la méthode d'entrée
+    bool _indirect; // appels via le slot de chaque méthode (remplacement à chaud)
+    std::vector<llvm::Function*> _retired; // anciennes versions, libérées après l'exécution
+
+    void parse(
+        const std::pair<std::string,File>& file,
+        bool force,
+        std::vector<std::pair<Func*, uint64_t>>& parsed
+    );
+    void* entryPoint();
+    void releaseRetired();
+    void recordDependencies(Method& method, llvm::Function* F);
+};
+
+#endif // SESSION_H
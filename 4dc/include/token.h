@@ -14,6 +14,7 @@ enum class TokenType
   ID,       // Identifier
   NUM,      // Numerical literal
   STRING,   // String literal
+  PROPERTY, // .nom d'attribut d'objet
 
   DOLLAR,   // $
   DIAMOND,  // <>
@@ -22,6 +23,8 @@ enum class TokenType
   RIGHTP,   // )
   LEFTB,    // {
   RIGHTB,   // }
+  LEFTSB,   // [
+  RIGHTSB,  // ]
   SEMICOL,  // ;
   COLON,    // :
 
@@ -37,6 +40,9 @@ enum class TokenType
   
   REPEAT,   // Repeat
   UNTIL,    // Until
+
+  CASEOF,   // Case of
+  ENDCASE,  // End case
   
   AFFECT,   // :=
   
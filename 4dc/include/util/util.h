@@ -5,6 +5,7 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <cstdint>
 
 
 namespace Util {
@@ -19,8 +20,10 @@ namespace Util {
   std::string&& downcase(std::string&&);
   std::string&& upcase(std::string&&);
   std::string basename(const std::string&);
+  std::string dirname(const std::string&);
   double str2dbl(const std::string&);
   long str2long(const std::string&);
+  uint64_t hash(const std::string&);
   template<class T>
   std::string join(const std::vector<T>&, const std::string&);
   template<class T>
@@ -11,14 +11,35 @@ enum class VarType
 
   NUMBER,   // int, double, float... we dont know yet
   INT,      // int
+  LONG,     // entier 64 bits
+  REAL,     // double
   
   
   STRING,   // string
   BOOLEAN,  // true or false
+  OBJECT,   // objet ou collection, par son identifiant
+
+  // Tableaux, par l'identifiant de leur descripteur (ARRAY LONGINT, ARRAY REAL, ARRAY TEXT)
+  INT_ARRAY,
+  REAL_ARRAY,
+  STRING_ARRAY,
   
   VOID, // used to type functions with no return value
 };
 
 std::ostream& operator<<(std::ostream& out, VarType vtype);
 
+// Nombres entiers : les littéraux (NUMBER), les entiers 32 bits (INT) et 64 bits (LONG)
+inline bool isInteger(VarType vtype) {return vtype == VarType::NUMBER || vtype == VarType::INT || vtype == VarType::LONG;}
+inline bool isNumeric(VarType vtype) {return isInteger(vtype) || vtype == VarType::REAL;}
+// Valeurs de 8 octets : entiers 64 bits et réels
+inline bool isWide(VarType vtype) {return vtype == VarType::LONG || vtype == VarType::REAL;}
+inline bool isArray(VarType vtype) {return vtype == VarType::INT_ARRAY || vtype == VarType::REAL_ARRAY || vtype == VarType::STRING_ARRAY;}
+// Type des éléments d'un tableau ; un tableau de type inconnu (un paramètre)
+// est un tableau d'entiers
+inline VarType elementType(VarType vtype)
+{
+  return vtype == VarType::REAL_ARRAY ? VarType::REAL : vtype == VarType::STRING_ARRAY ? VarType::STRING : VarType::INT;
+}
+
 #endif // VARTYPE_H
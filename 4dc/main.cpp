@@ -1,9 +1,14 @@
 #include <iostream>
 
 #include "include/builder.h"
+#include "include/compileerror.h"
+#include "include/options.h"
+#include "include/server.h"
+#include "include/session.h"
 #include "include/util/logger.h"
 #include "include/util/file.h"
 #include "include/util/util.h"
+#include <cstdlib>
 #include <fstream>
 #include <vector>
 #include <tuple>
@@ -12,14 +17,33 @@ using namespace std;
 
 void compileFile(istream&, Builder&);
 
-int main(int argc, char *argv[])
+// prepared : Builder préparé par le serveur de compilation, ou nullptr
+int compile(const string& program, const vector<string>& args, Builder* prepared = nullptr)
 {
   vector<pair<string, File>> files;
+  Options options;
   
   bool readSTDIN = true;
-  for(int i =1; i < argc; i++){
+  // La bibliothèque du runtime est installée à côté du compilateur
+  auto slash = program.find_last_of("/\\");
+  if (slash != string::npos) {
+    options.setRuntimeLibrary(program.substr(0, slash + 1) + "lib4dcrt.a");
+  }
+  
+  for(unsigned i = 0; i < args.size(); i++){
+    std::string current_exec_name = args[i];
+    if (current_exec_name == "-o" && i + 1 < args.size()) {
+      options.setOutput(args[++i]);
+      continue;
+    }
+    if (Options::isOption(current_exec_name)) {
+      if (!options.parse(current_exec_name)) {
+        Logger::error << "Error: Unknown option \"" << current_exec_name << "\"" << endl;
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
     readSTDIN = false;
-    std::string current_exec_name = argv[i];
     if (current_exec_name == "-") {
       readSTDIN = true;
       break;
@@ -32,8 +56,62 @@ int main(int argc, char *argv[])
     files.emplace_back("stdin", File(""));
   }
   
-  Builder::buildAll(files);
+  try {
+    if (options.session()) {
+      // L'entrée standard est réservée aux commandes de la session
+      if (readSTDIN) {
+        Logger::error << "Error: --session and --watch require source files" << endl;
+        return EXIT_FAILURE;
+      }
+      if (options.emitKind() != EmitKind::NONE || options.tiered() || options.background()) {
+        Logger::warning << "Warning: --emit, --tiered et --background sont ignores avec --session" << endl;
+      }
+      Session session(files, options);
+      session.update();
+      if (options.watch()) {
+        return session.watch() ? 0 : EXIT_FAILURE;
+      }
+      bool ok = session.run();
+      session.loop(cin);
+      return ok ? 0 : EXIT_FAILURE;
+    }
+  
+    Builder::buildAll(files, options, prepared);
+  } catch (const CompileError& e) {
+    Logger::error << e.what() << endl;
+    return EXIT_FAILURE;
+  }
   
   return 0;
 }
 
+int main(int argc, char *argv[])
+{
+  string program = argv[0];
+  vector<string> args(argv + 1, argv + argc);
+  
+  // Démon de compilation : 4dc --server=SOCKET
+  if (!args.empty() && args[0].compare(0, 9, "--server=") == 0) {
+    // Les requêtes s'exécutent dans le dossier du client
+    char* path = realpath(argv[0], nullptr);
+    if (path) {
+      program = path;
+      free(path);
+    }
+    // Le JIT et les optimiseurs sont construits une fois, avant la première
+    // requête : chaque processus fils en hérite
+    Builder* prepared = Builder::warmUp();
+    int status = Server::serve(args[0].substr(9), [&program, prepared](const vector<string>& request) {
+      return compile(program, request, prepared);
+    });
+    delete prepared;
+    return status;
+  }
+  // Client : 4dc --connect=SOCKET [options] fichiers...
+  if (!args.empty() && args[0].compare(0, 10, "--connect=") == 0) {
+    return Server::request(args[0].substr(10), vector<string>(args.begin() + 1, args.end()));
+  }
+  
+  return compile(program, args);
+}
+
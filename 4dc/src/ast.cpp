@@ -1,11 +1,18 @@
 #include "../include/ast.h"
 #include <iostream>
 #include <sstream>
+#include <set>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include "../include/util/logger.h"
 #include "../include/util/util.h"
 #include "../include/builder.h"
 #include "../include/builtins.h"
 #include "../include/functionsignature.h"
+#include "../include/bytecode.h"
+#include "../include/runtime.h"
+#include "../include/func.h"
 
 using namespace std;
 using namespace llvm;
@@ -16,6 +23,113 @@ const string NAMED_PREFIX_END     = "  ";
 const string PREFIX_BEGIN         = "+> ";
 const string PREFIX_MIDDLE        = "|  ";
 const string PREFIX_END           = "   ";
+
+namespace {
+  // Appel, dans le bytecode, du builtin de clé builtin dans Builtin::getList()
+  void emitBuiltin(BytecodeBuilder& bb, const string& builtin)
+  {
+    Builtin* b = Builtin::getList()[builtin];
+    bb.emit(OpCode::BUILTIN, b->signature()->argsNumber(), b->getPtr());
+  }
+
+  // Textes et objets sont comptés en références : une valeur lue en porte
+  // une, une variable affectée rend celle de son ancienne valeur
+  bool counted(VarType vtype)
+  {
+    return vtype == VarType::STRING || vtype == VarType::OBJECT;
+  }
+
+  string retainBuiltin(VarType vtype)
+  {
+    return vtype == VarType::STRING ? "text.retain" : "object.retain";
+  }
+
+  string releaseBuiltin(VarType vtype)
+  {
+    return vtype == VarType::STRING ? "text.release" : "object.release";
+  }
+
+  // Une occurrence de variable sans type prend celui de la variable ; le
+  // premier type connu devient celui de la variable. Un nombre sans taille
+  // connue (NUMBER) devient réel ou entier 64 bits dès qu'une occurrence l'est.
+  void tagVariable(ExprAST* var, const string& name, map<string, VarType>& vars)
+  {
+    auto it = vars.find(name);
+    if (it != vars.end() && it->second != VarType::NOTDEFINE) {
+      if (it->second == VarType::NUMBER && isWide(var->getType())) {
+        it->second = var->getType();
+      } else if (var->getType() == VarType::NOTDEFINE
+                 || (var->getType() == VarType::NUMBER && isWide(it->second))) {
+        var->setType(it->second);
+      }
+    } else {
+      vars[name] = var->getType();
+    }
+  }
+
+  // Genre (FOURDVALUE_*) sous lequel une valeur de type vtype est rangée dans
+  // un objet ou une collection, et lue
+  int valueKind(VarType vtype)
+  {
+    switch (vtype) {
+    case VarType::STRING:
+      return FOURDVALUE_TEXT;
+    case VarType::REAL:
+      return FOURDVALUE_REAL;
+    case VarType::OBJECT:
+      return FOURDVALUE_OBJECT;
+    case VarType::BOOLEAN:
+      return FOURDVALUE_BOOLEAN;
+    default:
+      return FOURDVALUE_NUMBER;
+    }
+  }
+
+  // Valeur de 64 bits rangée dans un objet : un réel bit à bit
+  Value* valueBits(Builder& b, Value* V, VarType vtype)
+  {
+    V = b.convert(V, vtype);
+    if (vtype == VarType::REAL) {
+      return b.irbuilder().CreateBitCast(V, b.type(VarType::LONG), "value.bits");
+    }
+    return b.convert(V, VarType::LONG);
+  }
+
+  // Fonctions mathématiques sur un réel : intrinsèque LLVM dans le code natif,
+  // fonction de la libm dans l'interpréteur
+  struct MathFunction
+  {
+    Intrinsic::ID intrinsic;
+    double (*function)(double);
+    bool places; // Round et Trunc : nombre de décimales facultatif
+  };
+
+  const MathFunction* mathFunction(const string& name)
+  {
+    static const map<string, MathFunction> functions{
+      {"square root", {Intrinsic::sqrt, static_cast<double (*)(double)>(&::sqrt), false}},
+      {"exp", {Intrinsic::exp, static_cast<double (*)(double)>(&::exp), false}},
+      {"log", {Intrinsic::log, static_cast<double (*)(double)>(&::log), false}},
+      {"sin", {Intrinsic::sin, static_cast<double (*)(double)>(&::sin), false}},
+      {"cos", {Intrinsic::cos, static_cast<double (*)(double)>(&::cos), false}},
+      {"round", {Intrinsic::round, static_cast<double (*)(double)>(&::round), true}},
+      {"trunc", {Intrinsic::trunc, static_cast<double (*)(double)>(&::trunc), true}}
+    };
+    auto it = functions.find(name);
+    return it != functions.end() ? &it->second : nullptr;
+  }
+
+  // Facteur 10^décimales de Round et Trunc ; les décimales doivent être constantes
+  bool mathScale(ExprAST* places, double& scale)
+  {
+    long n;
+    if (!places->isConstantInt(n) || n < -308 || n > 308) {
+      return false;
+    }
+    scale = pow(10., n);
+    return true;
+  }
+}
  
 /**
  * AST
@@ -32,6 +146,9 @@ bool AST::_isVar() const
   return false;
 }
 
+void AST::_effects(CodeEffects&) const
+{}
+
 
 ostream& operator<<(ostream& out, const AST& ast)
 {
@@ -62,11 +179,20 @@ void BlocAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
   for (auto& statement : this->_statements) {
-    statement->taggingPass(argVars, localVars, globaleVars, persistentVars);
+    statement->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+}
+
+void BlocAST::_effects(CodeEffects& e) const
+{
+  for (auto& statement : this->_statements) {
+    statement->effects(e);
   }
 }
 
@@ -91,6 +217,14 @@ BasicBlock* BlocAST::Codegen(Builder& b, const std::string& name, Function* f)
   return block;
 }
 
+bool BlocAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  for (auto& statement : this->_statements) {
+    if (!statement->Bytecodegen(bb)) return false;
+  }
+  return true;
+}
+
 string BlocAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextFirstPrefix, nextPrefix;
@@ -129,15 +263,42 @@ void StatementExprAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+}
+
+void StatementExprAST::_effects(CodeEffects& e) const
+{
+  this->_expr->effects(e);
 }
 
 bool StatementExprAST::Codegen(Builder& b)
 {
-  return this->_expr->Codegen(b);
+  Value* V = this->_expr->Codegen(b);
+  if (!V) {
+    return false;
+  }
+  // Un texte ou un objet inutilisé rend sa référence
+  if (counted(this->_expr->getType())) {
+    b.callBuiltin(releaseBuiltin(this->_expr->getType()), V);
+  }
+  return true;
+}
+
+bool StatementExprAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->_expr->Bytecodegen(bb)) {
+    return false;
+  }
+  if (counted(this->_expr->getType())) {
+    emitBuiltin(bb, releaseBuiltin(this->_expr->getType()));
+  }
+  bb.emit(OpCode::POP);
+  return true;
 }
 
 string StatementExprAST::_toString(const string& firstPrefix, const string& prefix) const
@@ -168,21 +329,80 @@ void AffectationAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  this->_variableAST->setType(this->_expr->getType());
+  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  VarType exprType = this->_expr->getType();
+  VarType varType = this->_variableAST->getType();
+  if (varType == VarType::NOTDEFINE || (varType == VarType::NUMBER && isWide(exprType))) {
+    // La variable prend le type de sa première affectation ; un nombre affecté
+    // d'un réel ou d'un entier 64 bits en prend le type
+    this->_variableAST->setType(exprType);
+    this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  } else if (exprType == VarType::NOTDEFINE && dynamic_cast<PropertyAST*>(this->_expr)) {
+    // Un attribut d'objet sans type connu est lu au type de la variable
+    this->_expr->setType(varType);
+    this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  } else if (exprType != VarType::NOTDEFINE && (varType == VarType::STRING) != (exprType == VarType::STRING)) {
+    Logger::error << "AST error: implicite cast of " << exprType << " in " << varType << std::endl;
+  }
+}
+
+// $t:=$t+expression sur une variable locale texte : complétée sur place
+bool AffectationAST::isSelfAppend() const
+{
+  BinOpAST* binOp = dynamic_cast<BinOpAST*>(this->_expr);
+  string name, lhsName;
+  return this->_variableAST->getType() == VarType::STRING && binOp && binOp->op() == "+"
+      && this->_variableAST->isLocal(name) && binOp->lhs()->isLocal(lhsName) && name == lhsName;
+}
+
+void AffectationAST::_effects(CodeEffects& e) const
+{
+  this->_expr->effects(e);
+  this->_variableAST->effectsMute(e);
 }
 
 bool AffectationAST::Codegen(Builder& b)
 {
   assert(this->_variableAST != nullptr);
   assert(this->_expr != nullptr);
+  if (this->isSelfAppend()) {
+    BinOpAST* binOp = static_cast<BinOpAST*>(this->_expr);
+    Value* text = binOp->lhs()->Codegen(b);
+    Value* suffix = binOp->rhs()->Codegen(b);
+    if (!text || !suffix) {
+      return false;
+    }
+    Value* args[] = {text, suffix};
+    return this->_variableAST->CodegenMute(b, b.callBuiltin("text.appendto", args, "text.append"));
+  }
   return this->_variableAST->CodegenMute(b, this->_expr->Codegen(b));
 }
 
+bool AffectationAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  assert(this->_variableAST != nullptr);
+  assert(this->_expr != nullptr);
+  if (this->isSelfAppend()) {
+    BinOpAST* binOp = static_cast<BinOpAST*>(this->_expr);
+    if (!binOp->lhs()->Bytecodegen(bb) || !binOp->rhs()->Bytecodegen(bb)) {
+      return false;
+    }
+    emitBuiltin(bb, "text.appendto");
+    return this->_variableAST->BytecodegenMute(bb);
+  }
+  if (!this->_expr->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_expr->getType(), this->_variableAST->getType());
+  return this->_variableAST->BytecodegenMute(bb);
+}
+
 string AffectationAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextPrefix = prefix + NAMED_PREFIX_MIDDLE;
@@ -217,16 +437,27 @@ void IfAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
   if(_condAST->getType() != VarType::BOOLEAN){
     Logger::error << "AST error: the condition of 'if' must be a boolean, not a " << _condAST->getType() << std::endl;
   }
-  this->_thenAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_thenAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if (this->_elseAST) {
+    this->_elseAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+}
+
+void IfAST::_effects(CodeEffects& e) const
+{
+  this->_condAST->effects(e);
+  this->_thenAST->effects(e);
   if (this->_elseAST) {
-    this->_elseAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+    this->_elseAST->effects(e);
   }
 }
 
@@ -283,6 +514,28 @@ bool IfAST::Codegen(Builder& b)
   return true;
 }
 
+bool IfAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->_condAST->Bytecodegen(bb)) {
+    return false;
+  }
+  unsigned jumpElse = bb.emit(OpCode::JUMPZ);
+  if (!this->_thenAST->Bytecodegen(bb)) {
+    return false;
+  }
+  if (this->_elseAST) {
+    unsigned jumpEnd = bb.emit(OpCode::JUMP);
+    bb.patch(jumpElse, bb.here());
+    if (!this->_elseAST->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.patch(jumpEnd, bb.here());
+  } else {
+    bb.patch(jumpElse, bb.here());
+  }
+  return true;
+}
+
 string IfAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextPrefix = prefix + NAMED_PREFIX_MIDDLE;
@@ -323,13 +576,16 @@ void ForAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  this->_variableAST->setType(VarType::INT);
-  this->_beginAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  if(_beginAST->getType() != VarType::INT){
+  this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  bool isLong = this->_variableAST->getType() == VarType::LONG;
+  bool isTyped = isLong || this->_variableAST->getType() == VarType::INT;
+  this->_beginAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if(_beginAST->getType() != VarType::INT && _beginAST->getType() != VarType::LONG){
     if(_beginAST->getType() == VarType::NOTDEFINE){
       _beginAST->setType(VarType::INT);
     }else if(_beginAST->getType() == VarType::NUMBER){
@@ -339,8 +595,8 @@ void ForAST::_taggingPass(
       Logger::error << "AST error: the begin exression of 'for' must be an int, not a " << _beginAST->getType() << std::endl;
     }
   }
-  this->_endAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  if(_endAST->getType() != VarType::INT){
+  this->_endAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if(_endAST->getType() != VarType::INT && _endAST->getType() != VarType::LONG){
     if(_endAST->getType() == VarType::NOTDEFINE){
       _endAST->setType(VarType::INT);
     }else if(_endAST->getType() == VarType::NUMBER){
@@ -350,8 +606,8 @@ void ForAST::_taggingPass(
       Logger::error << "AST error: the end exression of 'for' must be an int, not a " << _endAST->getType() << std::endl;
     }
   }
-  this->_incrementAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  if(_incrementAST->getType() != VarType::INT){
+  this->_incrementAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if(_incrementAST->getType() != VarType::INT && _incrementAST->getType() != VarType::LONG){
     if(_incrementAST->getType() == VarType::NOTDEFINE){
       _incrementAST->setType(VarType::INT);
     }else if(_incrementAST->getType() == VarType::NUMBER){
@@ -361,6 +617,119 @@ void ForAST::_taggingPass(
       Logger::error << "AST error: the increment exression of 'for' must be an int, not a " << _incrementAST->getType() << std::endl;
     }  
   }
+
+  // Une variable sans taille connue devient entier 64 bits si l'une des
+  // expressions l'est ; les expressions sont converties au type de la variable
+  if (!isTyped && (_beginAST->getType() == VarType::LONG || _endAST->getType() == VarType::LONG
+                   || _incrementAST->getType() == VarType::LONG)) {
+    isLong = true;
+    this->_variableAST->setType(VarType::LONG);
+    this->_variableAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  if (!isLong) {
+    this->_variableAST->setType(VarType::INT);
+  }
+}
+
+void ForAST::_effects(CodeEffects& e) const
+{
+  this->_variableAST->effects(e);
+  this->_variableAST->effectsMute(e);
+  this->_beginAST->effects(e);
+  this->_endAST->effects(e);
+  this->_incrementAST->effects(e);
+  this->_loopAST->effects(e);
+}
+
+/*
+ * Versionnement de la boucle : si la variable de boucle est locale, le pas
+ * constant, et que le corps ne modifie ni la variable, ni les tableaux qu'elle
+ * indexe, ni la borne de fin, les accès $tableau{$variable} sont dans les
+ * bornes pour toute la boucle dès que la plage de la variable l'est.
+ * Cette plage est vérifiée une fois avant la boucle, qui est générée deux fois :
+ * sans contrôle des bornes si la vérification réussit, avec sinon.
+ */
+bool ForAST::inBoundsCandidate(string& index, set<string>& arrays, long& step) const
+{
+  if (!this->_variableAST->isLocal(index) || this->_variableAST->getType() == VarType::LONG
+      || !this->_incrementAST->isConstantInt(step) || step == 0 || step > INT32_MAX || step < -INT32_MAX) {
+    return false;
+  }
+  CodeEffects body;
+  this->_loopAST->effects(body);
+  if (body.resizes || body.writtenLocals.count(index)) {
+    return false;
+  }
+  for (auto& access : body.indexedArrays) {
+    if (access.second == index && !body.writtenLocals.count(access.first)) {
+      arrays.insert(access.first);
+    }
+  }
+  if (arrays.empty()) {
+    return false;
+  }
+
+  // La borne de fin est réévaluée à chaque itération : elle doit être sans
+  // effet, ne pas dépendre de ce que modifie le corps ni accéder aux tableaux
+  CodeEffects end;
+  this->_endAST->effects(end);
+  if (end.calls || !end.indexedArrays.empty() || (end.readsGlobals && body.writesGlobals)) {
+    return false;
+  }
+  for (auto& var : end.readLocals) {
+    if (body.writtenLocals.count(var)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Vérifie avant la boucle que toutes les valeurs prises par la variable sont
+ * des index valides des tableaux, et charge leurs données dans data.
+ * Branche vers checkedBB (boucle avec contrôles) sinon.
+ */
+bool ForAST::CodegenInBoundsCheck(Builder& b, Value* beginV, const set<string>& arrays, long step,
+                                  BasicBlock* checkedBB, map<string, Value*>& data, Value*& endV)
+{
+  IRBuilder<>& builder = b.irbuilder();
+  Function *f = builder.GetInsertBlock()->getParent();
+  Type* i32 = builder.getInt32Ty();
+
+  endV = this->_endAST->Codegen(b);
+  if (!endV) {
+    return false;
+  }
+  // Comme dans CodegenLoop : la borne est du type de la variable de boucle
+  endV = b.convert(endV, this->_variableAST->getType());
+  // Boucle croissante : begin < end, descendante : end < begin (sinon la
+  // boucle ne s'arrête qu'au débordement de la variable)
+  Value *lowV, *highV, *rangeV;
+  if (step > 0) {
+    lowV = beginV;
+    highV = endV;
+    rangeV = builder.CreateAnd(builder.CreateICmpSLT(beginV, endV),
+                               builder.CreateICmpSLE(endV, ConstantInt::get(i32, INT32_MAX - step, true)),
+                               "for.range.asc");
+  } else {
+    lowV = endV;
+    highV = beginV;
+    rangeV = builder.CreateAnd(builder.CreateICmpSLT(endV, beginV),
+                               builder.CreateICmpSGE(endV, ConstantInt::get(i32, INT32_MIN - step, true)),
+                               "for.range.dsc");
+  }
+  rangeV = builder.CreateAnd(rangeV, builder.CreateICmpSGE(lowV, ConstantInt::get(i32, 0)), "for.range");
+
+  BasicBlock *rangeBB = BasicBlock::Create(b.context(), "for.inbounds", f);
+  builder.CreateCondBr(rangeV, rangeBB, checkedBB);
+  builder.SetInsertPoint(rangeBB);
+  b.currentBlock() = rangeBB;
+
+  for (auto& name : arrays) {
+    Value* array = builder.CreateLoad(b.localVars()[name], "var.local." + name + ".");
+    data[name] = b.arrayData(array, highV, checkedBB);
+  }
+  return true;
 }
 
 bool ForAST::Codegen(Builder& b)
@@ -373,14 +742,8 @@ bool ForAST::Codegen(Builder& b)
   
   // Creates all the blocks
   BasicBlock *initBB = BasicBlock::Create(b.context(), "for.init", f);
-  BasicBlock *condBB = BasicBlock::Create(b.context(), "for.cond");
-  BasicBlock *condAscBB = BasicBlock::Create(b.context(), "for.condAsc");
-  BasicBlock *condDscBB = BasicBlock::Create(b.context(), "for.condDes");
-  BasicBlock *loopBB = BasicBlock::Create(b.context(), "for.body");
   BasicBlock *endBB = BasicBlock::Create(b.context(), "for.cont");
   
-
-  
   // Generate the link between previous code and the loop
   builder.CreateBr(initBB);
   builder.SetInsertPoint(initBB);
@@ -388,12 +751,108 @@ bool ForAST::Codegen(Builder& b)
 
   //init increment
   Value *beginV = this->_beginAST->Codegen(b);
+  if (!beginV) {
+    return false;
+  }
+  beginV = b.convert(beginV, this->_variableAST->getType());
   Value *initV = this->_variableAST->CodegenMute(b, beginV);
 
   if (!initV) {
     return false;
   }
 
+  // Boucle sans contrôle des bornes des tableaux, si elle est prouvée sûre
+  string index;
+  set<string> arrays;
+  long step;
+  if (b.optLevel() > 0 && this->inBoundsCandidate(index, arrays, step)) {
+    BasicBlock *checkedBB = BasicBlock::Create(b.context(), "for.checked");
+    map<string, Value*> data;
+    Value *endV;
+    if (!this->CodegenInBoundsCheck(b, beginV, arrays, step, checkedBB, data, endV)) {
+      return false;
+    }
+    b.pushInBounds(index, data);
+    bool generated = this->CodegenInBoundsLoop(b, endV, step, endBB);
+    b.popInBounds();
+    if (!generated) {
+      return false;
+    }
+    f->getBasicBlockList().push_back(checkedBB);
+    builder.SetInsertPoint(checkedBB);
+    b.currentBlock() = checkedBB;
+  }
+
+  if (!this->CodegenLoop(b, beginV, endBB)) {
+    return false;
+  }
+  
+  // Emit loop continuation block
+  f->getBasicBlockList().push_back(endBB);
+  builder.SetInsertPoint(endBB);
+  b.currentBlock() = endBB;
+  return true;
+}
+
+/*
+ * Boucle sans contrôle des bornes, sous forme canonique pour les passes de
+ * boucles et le vectoriseur : le sens est connu, la borne de fin (invariante)
+ * est évaluée une seule fois, il n'y a qu'une sortie et aucun appel par itération.
+ */
+bool ForAST::CodegenInBoundsLoop(Builder& b, Value* endV, long step, BasicBlock* endBB)
+{
+  IRBuilder<>& builder = b.irbuilder();
+  Function *f = builder.GetInsertBlock()->getParent();
+  
+  BasicBlock *condBB = BasicBlock::Create(b.context(), "for.inbounds.cond");
+  BasicBlock *loopBB = BasicBlock::Create(b.context(), "for.inbounds.body");
+
+  builder.CreateBr(condBB);
+  f->getBasicBlockList().push_back(condBB);
+  builder.SetInsertPoint(condBB);
+  b.currentBlock() = condBB;
+
+  Value *varV = this->_variableAST->Codegen(b);
+  Value *condV = step > 0 ? builder.CreateICmpSLE(varV, endV, "for.cond.expr.asc")
+                          : builder.CreateICmpSGE(varV, endV, "for.cond.expr.dsc");
+  builder.CreateCondBr(condV, loopBB, endBB);
+
+  f->getBasicBlockList().push_back(loopBB);
+  builder.SetInsertPoint(loopBB);
+  b.currentBlock() = loopBB;
+  if (!this->CodegenIteration(b, true)) {
+    return false;
+  }
+  builder.CreateBr(condBB);
+  return true;
+}
+
+// Corps de la boucle, puis incrément de la variable
+bool ForAST::CodegenIteration(Builder& b, bool inBounds)
+{
+  if (!this->_loopAST->Codegen(b)) {
+    return false;
+  }
+  Value *incV = this->_incrementAST->Codegen(b);
+  if (!incV) {
+    return false;
+  }
+  incV = b.convert(incV, this->_variableAST->getType());
+  // Dans la version sans contrôle des bornes, la plage vérifiée exclut le débordement
+  Value *newIV = b.irbuilder().CreateAdd(this->_variableAST->Codegen(b), incV, "for.i", false, inBounds);
+  return newIV && this->_variableAST->CodegenMute(b, newIV);
+}
+
+bool ForAST::CodegenLoop(Builder& b, Value* beginV, BasicBlock* endBB)
+{
+  IRBuilder<>& builder = b.irbuilder();
+  Function *f = builder.GetInsertBlock()->getParent();
+  
+  BasicBlock *condBB = BasicBlock::Create(b.context(), "for.cond");
+  BasicBlock *condAscBB = BasicBlock::Create(b.context(), "for.condAsc");
+  BasicBlock *condDscBB = BasicBlock::Create(b.context(), "for.condDes");
+  BasicBlock *loopBB = BasicBlock::Create(b.context(), "for.body");
+
   // Create the entry cond block
   builder.CreateBr(condBB);
   f->getBasicBlockList().push_back(condBB);
@@ -402,6 +861,10 @@ bool ForAST::Codegen(Builder& b)
   
   // Generate condition ( end > begin ? ascendant : descendant)
   Value *endV = this->_endAST->Codegen(b);
+  if (!endV) {
+    return false;
+  }
+  endV = b.convert(endV, this->_variableAST->getType());
   Value *condV = builder.CreateICmpSGT (endV, beginV, "for.cond.expr");
   if (!condV) {
     return false;
@@ -438,33 +901,77 @@ bool ForAST::Codegen(Builder& b)
   b.currentBlock() = loopBB;
   
   
-  // Generate loop body
-  if (!this->_loopAST->Codegen(b)) {
+  // Generate loop body and increment
+  if (!this->CodegenIteration(b, false)) {
     return false;
   }
   
-    //increment the increment
-    Value *incV = this->_incrementAST->Codegen(b);
-    Value *newIV = b.irbuilder().CreateAdd(this->_variableAST->Codegen(b), incV, "for.i", loopBB);
- 
-    if (!newIV) {
-      return false;
-    }
-  
-    Value *incrementV = this->_variableAST->CodegenMute(b, newIV);
-    
-    if (!incrementV) {
-      return false;
-    }
-
-  
   builder.CreateBr(condBB);
+  return true;
+}
 
-  
-  // Emit loop continuation block
-  f->getBasicBlockList().push_back(endBB);
-  builder.SetInsertPoint(endBB);
-  b.currentBlock() = endBB;
+bool ForAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  // Même sémantique que ForAST::Codegen : la valeur initiale est évaluée une
+  // fois, la borne et le pas à chaque itération.
+  int beginSlot = bb.newSlot();
+  int endSlot = bb.newSlot();
+  VarType vtype = this->_variableAST->getType();
+
+  if (!this->_beginAST->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_beginAST->getType(), vtype);
+  bb.emit(OpCode::STORE, beginSlot);
+  bb.emit(OpCode::LOAD, beginSlot);
+  if (!this->_variableAST->BytecodegenMute(bb)) {
+    return false;
+  }
+
+  // Condition ( end > begin ? ascendant : descendant)
+  unsigned condI = bb.here();
+  if (!this->_endAST->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_endAST->getType(), vtype);
+  bb.emit(OpCode::STORE, endSlot);
+  bb.emit(OpCode::LOAD, endSlot);
+  bb.emit(OpCode::LOAD, beginSlot);
+  bb.emit(OpCode::GT);
+  unsigned jumpDsc = bb.emit(OpCode::JUMPZ);
+
+  // $var <= end ? loop : end
+  this->_variableAST->Bytecodegen(bb);
+  bb.emit(OpCode::LOAD, endSlot);
+  bb.emit(OpCode::LE);
+  unsigned jumpAscEnd = bb.emit(OpCode::JUMPZ);
+  unsigned jumpBody = bb.emit(OpCode::JUMP);
+
+  // $var >= end ? loop : end
+  bb.patch(jumpDsc, bb.here());
+  this->_variableAST->Bytecodegen(bb);
+  bb.emit(OpCode::LOAD, endSlot);
+  bb.emit(OpCode::GE);
+  unsigned jumpDscEnd = bb.emit(OpCode::JUMPZ);
+
+  // Corps de la boucle et incrément
+  bb.patch(jumpBody, bb.here());
+  if (!this->_loopAST->Bytecodegen(bb)) {
+    return false;
+  }
+  this->_variableAST->Bytecodegen(bb);
+  if (!this->_incrementAST->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_incrementAST->getType(), vtype);
+  bb.emit(vtype == VarType::LONG ? OpCode::ADDL : OpCode::ADD);
+  if (!this->_variableAST->BytecodegenMute(bb)) {
+    return false;
+  }
+  bb.emit(OpCode::JUMP, condI);
+
+  bb.patch(jumpAscEnd, bb.here());
+  bb.patch(jumpDscEnd, bb.here());
   return true;
 }
 
@@ -502,10 +1009,12 @@ void WhileAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
   if(_condAST->getType() != VarType::BOOLEAN){
     if(_condAST->getType() == VarType::NOTDEFINE){
       _condAST->setType(VarType::BOOLEAN);
@@ -513,7 +1022,13 @@ void WhileAST::_taggingPass(
       Logger::error << "AST error: the condition of 'while' must be a boolean, not a " << _condAST->getType() << std::endl;
     }
   }
-  this->_loopAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_loopAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+}
+
+void WhileAST::_effects(CodeEffects& e) const
+{
+  this->_condAST->effects(e);
+  this->_loopAST->effects(e);
 }
 
 bool WhileAST::Codegen(Builder& b)
@@ -559,6 +1074,21 @@ bool WhileAST::Codegen(Builder& b)
   return true;
 }
 
+bool WhileAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  unsigned condI = bb.here();
+  if (!this->_condAST->Bytecodegen(bb)) {
+    return false;
+  }
+  unsigned jumpEnd = bb.emit(OpCode::JUMPZ);
+  if (!this->_loopAST->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emit(OpCode::JUMP, condI);
+  bb.patch(jumpEnd, bb.here());
+  return true;
+}
+
 string WhileAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextPrefix = prefix + PREFIX_MIDDLE;
@@ -587,11 +1117,13 @@ void RepeatAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_loopAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_loopAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->_condAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
   if(_condAST->getType() != VarType::BOOLEAN){
     if(_condAST->getType() == VarType::NOTDEFINE){
       _condAST->setType(VarType::BOOLEAN);
@@ -601,6 +1133,12 @@ void RepeatAST::_taggingPass(
   }
 }
 
+void RepeatAST::_effects(CodeEffects& e) const
+{
+  this->_condAST->effects(e);
+  this->_loopAST->effects(e);
+}
+
 bool RepeatAST::Codegen(Builder& b)
 {
   IRBuilder<>& builder = b.irbuilder();
@@ -637,10 +1175,23 @@ bool RepeatAST::Codegen(Builder& b)
   return true;
 }
 
-string RepeatAST::_toString(const string& firstPrefix, const string& prefix) const
+bool RepeatAST::Bytecodegen(BytecodeBuilder& bb)
 {
-  string nextPrefix = prefix + PREFIX_MIDDLE;
-  stringstream ss;
+  unsigned loopI = bb.here();
+  if (!this->_loopAST->Bytecodegen(bb)) {
+    return false;
+  }
+  if (!this->_condAST->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emit(OpCode::JUMPZ, loopI);
+  return true;
+}
+
+string RepeatAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextPrefix = prefix + PREFIX_MIDDLE;
+  stringstream ss;
   ss  << firstPrefix << "Statement::RepeatAST" << endl
       << this->_loopAST ->toString(prefix + "+[REPEAT]" + NAMED_PREFIX_BEGIN, nextPrefix + "     ");
   nextPrefix = prefix + PREFIX_END;
@@ -648,6 +1199,480 @@ string RepeatAST::_toString(const string& firstPrefix, const string& prefix) con
   return ss.str();
 }
 
+/**
+ * CaseAST
+ */
+CaseAST::CaseAST(const std::vector<std::pair<ExprAST*, BlocAST*>>& cases, BlocAST* elseAST)
+  : _cases(cases), _elseAST(elseAST)
+{}
+
+CaseAST::~CaseAST()
+{
+  for (auto& c : this->_cases) {
+    delete c.first;
+    delete c.second;
+  }
+  if (this->_elseAST) delete this->_elseAST;
+}
+
+void CaseAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  for (auto& c : this->_cases) {
+    c.first->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+    if(c.first->getType() != VarType::BOOLEAN){
+      Logger::error << "AST error: the condition of 'case' must be a boolean, not a " << c.first->getType() << std::endl;
+    }
+    c.second->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  if (this->_elseAST) {
+    this->_elseAST->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+}
+
+void CaseAST::_effects(CodeEffects& e) const
+{
+  for (auto& c : this->_cases) {
+    c.first->effects(e);
+    c.second->effects(e);
+  }
+  if (this->_elseAST) {
+    this->_elseAST->effects(e);
+  }
+}
+
+/*
+ * Un "Case of" peut être compilé en switch LLVM si toutes ses conditions sont
+ * de la forme "variable = constante entière" sur une même variable entière
+ * (INT ou LONG). Le backend se charge ensuite de choisir entre table de saut (cas denses)
+ * et arbre de recherche binaire (cas épars).
+ */
+bool CaseAST::switchable(ExprAST*& subject, std::vector<long>& values) const
+{
+  string subjectKey;
+  subject = nullptr;
+  values.clear();
+  for (auto& c : this->_cases) {
+    BinOpAST* cond = dynamic_cast<BinOpAST*>(c.first);
+    if (!cond || cond->op() != "=") {
+      return false;
+    }
+    ExprAST* var = cond->lhs();
+    long val;
+    if (!cond->rhs()->isConstantInt(val)) {
+      var = cond->rhs();
+      if (!cond->lhs()->isConstantInt(val)) {
+        return false;
+      }
+    }
+    // La variable n'a pas d'effet de bord : l'évaluer une seule fois est sûr
+    if (!var->isVar()) {
+      return false;
+    }
+    // Un sujet réel est comparé en réel, et une constante hors des entiers
+    // 32 bits ne peut pas être égale à un sujet INT
+    VarType type = var->getType();
+    if (type != VarType::INT && type != VarType::LONG) {
+      return false;
+    }
+    if (type == VarType::INT && (val < INT32_MIN || val > INT32_MAX)) {
+      return false;
+    }
+    string key = var->toString("", "");
+    if (!subject) {
+      subject = var;
+      subjectKey = key;
+    } else if (key != subjectKey) {
+      return false;
+    }
+    values.push_back(val);
+  }
+  return subject != nullptr;
+}
+
+bool CaseAST::Codegen(Builder& b)
+{
+  ExprAST* subject;
+  std::vector<long> values;
+  if (this->switchable(subject, values)) {
+    return this->CodegenSwitch(b, subject, values);
+  }
+  return this->CodegenChain(b);
+}
+
+bool CaseAST::CodegenSwitch(Builder& b, ExprAST* subject, const std::vector<long>& values)
+{
+  IRBuilder<>& builder = b.irbuilder();
+
+  // Find the function to generate the code in
+  Function *f = builder.GetInsertBlock()->getParent();
+  assert(f != nullptr);
+
+  Value *subjectV = subject->Codegen(b);
+  if (!subjectV) {
+    return false;
+  }
+  IntegerType *subjectType = cast<IntegerType>(subjectV->getType());
+
+  BasicBlock *elseBB = BasicBlock::Create(b.context(), "case.else");
+  BasicBlock *endBB = BasicBlock::Create(b.context(), "case.cont");
+
+  SwitchInst *switchI = builder.CreateSwitch(subjectV, elseBB, values.size());
+
+  std::set<long> seen;
+  for (unsigned int i = 0; i < this->_cases.size(); ++i) {
+    // Seul le premier cas vérifié est exécuté : les doublons sont inaccessibles
+    if (!seen.insert(values[i]).second) {
+      Logger::warning << "AST warning: duplicated case value " << values[i] << " is unreachable" << std::endl;
+      continue;
+    }
+    BasicBlock *caseBB = BasicBlock::Create(b.context(), "case.body", f);
+    switchI->addCase(ConstantInt::get(subjectType, values[i], true), caseBB);
+
+    builder.SetInsertPoint(caseBB);
+    b.currentBlock() = caseBB;
+    if (!this->_cases[i].second->Codegen(b)) {
+      return false;
+    }
+    builder.CreateBr(endBB);
+  }
+
+  // Emit else block.
+  f->getBasicBlockList().push_back(elseBB);
+  builder.SetInsertPoint(elseBB);
+  b.currentBlock() = elseBB;
+  if (this->_elseAST && !this->_elseAST->Codegen(b)) {
+    return false;
+  }
+  builder.CreateBr(endBB);
+
+  // Emit continuation block
+  f->getBasicBlockList().push_back(endBB);
+  builder.SetInsertPoint(endBB);
+  b.currentBlock() = endBB;
+  return true;
+}
+
+bool CaseAST::CodegenChain(Builder& b)
+{
+  IRBuilder<>& builder = b.irbuilder();
+
+  // Find the function to generate the code in
+  Function *f = builder.GetInsertBlock()->getParent();
+  assert(f != nullptr);
+
+  BasicBlock *endBB = BasicBlock::Create(b.context(), "case.cont");
+
+  for (auto& c : this->_cases) {
+    Value *condV = c.first->Codegen(b);
+    if (!condV) {
+      return false;
+    }
+    BasicBlock *caseBB = BasicBlock::Create(b.context(), "case.body", f);
+    BasicBlock *nextBB = BasicBlock::Create(b.context(), "case.next");
+    builder.CreateCondBr(condV, caseBB, nextBB);
+
+    builder.SetInsertPoint(caseBB);
+    b.currentBlock() = caseBB;
+    if (!c.second->Codegen(b)) {
+      return false;
+    }
+    builder.CreateBr(endBB);
+
+    // Le cas suivant n'est testé que si les précédents ont échoué
+    f->getBasicBlockList().push_back(nextBB);
+    builder.SetInsertPoint(nextBB);
+    b.currentBlock() = nextBB;
+  }
+
+  if (this->_elseAST && !this->_elseAST->Codegen(b)) {
+    return false;
+  }
+  builder.CreateBr(endBB);
+
+  // Emit continuation block
+  f->getBasicBlockList().push_back(endBB);
+  builder.SetInsertPoint(endBB);
+  b.currentBlock() = endBB;
+  return true;
+}
+
+bool CaseAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  // Chaîne de tests : le premier cas vérifié est exécuté
+  std::vector<unsigned> jumpsEnd;
+  for (auto& c : this->_cases) {
+    if (!c.first->Bytecodegen(bb)) {
+      return false;
+    }
+    unsigned jumpNext = bb.emit(OpCode::JUMPZ);
+    if (!c.second->Bytecodegen(bb)) {
+      return false;
+    }
+    jumpsEnd.push_back(bb.emit(OpCode::JUMP));
+    bb.patch(jumpNext, bb.here());
+  }
+  if (this->_elseAST && !this->_elseAST->Bytecodegen(bb)) {
+    return false;
+  }
+  for (unsigned jump : jumpsEnd) {
+    bb.patch(jump, bb.here());
+  }
+  return true;
+}
+
+string CaseAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextPrefix = prefix + NAMED_PREFIX_MIDDLE;
+  stringstream ss;
+  ss  << firstPrefix << "Statement::CASE" << endl;
+  int length = this->_cases.size();
+  for (int i = 0; i < length; ++i) {
+    ss  << this->_cases[i].first->toString(prefix + "+[CASE]" + NAMED_PREFIX_BEGIN, nextPrefix + "       ");
+    if (i + 1 == length && !this->_elseAST) {
+      nextPrefix = prefix + NAMED_PREFIX_END;
+    }
+    ss  << this->_cases[i].second->toString(prefix + "+[THEN]" + NAMED_PREFIX_BEGIN, nextPrefix + "       ");
+  }
+  if (this->_elseAST) {
+    nextPrefix = prefix + NAMED_PREFIX_END;
+    ss  << this->_elseAST->toString(prefix + "+[ELSE]" + NAMED_PREFIX_BEGIN, nextPrefix + "       ");
+  }
+  return ss.str();
+}
+
+/**
+ * ArrayDeclarationAST
+ */
+ArrayDeclarationAST::ArrayDeclarationAST(const std::string& kind, VariableAST* array, ExprAST* size)
+  : _kind(kind), _array(array), _size(size)
+{}
+
+ArrayDeclarationAST::~ArrayDeclarationAST()
+{
+  delete this->_array;
+  delete this->_size;
+}
+
+void ArrayDeclarationAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  this->_array->setType(this->_kind == "array real" ? VarType::REAL_ARRAY
+                        : this->_kind == "array text" ? VarType::STRING_ARRAY : VarType::INT_ARRAY);
+  this->_array->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->_size->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+}
+
+// ARRAY INTEGER est un ARRAY LONGINT
+string ArrayDeclarationAST::builtin() const
+{
+  return Builtin::getList().count(this->_kind) ? this->_kind : "array longint";
+}
+
+void ArrayDeclarationAST::_effects(CodeEffects& e) const
+{
+  this->_array->effects(e);
+  this->_size->effects(e);
+  this->_array->effectsMute(e);
+  e.calls = e.resizes = true;
+}
+
+// La variable reçoit l'identifiant du tableau, créé s'il n'existe pas encore
+bool ArrayDeclarationAST::Codegen(Builder& b)
+{
+  Value* array = this->_array->Codegen(b);
+  Value* size = this->_size->Codegen(b);
+  if (!array || !size) {
+    return false;
+  }
+  Function* resize = b.module().getFunction(Builtin::getList()[this->builtin()]->signature()->name());
+  Value* V = b.irbuilder().CreateCall2(resize, array, b.convert(size, VarType::INT), "array.resize");
+  return this->_array->CodegenMute(b, V);
+}
+
+bool ArrayDeclarationAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->_array->Bytecodegen(bb) || !this->_size->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_size->getType(), VarType::INT);
+  bb.emit(OpCode::BUILTIN, 2, Builtin::getList()[this->builtin()]->getPtr());
+  return this->_array->BytecodegenMute(bb);
+}
+
+string ArrayDeclarationAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  nextFirstPrefix = prefix + PREFIX_BEGIN;
+  nextPrefix = prefix + PREFIX_MIDDLE;
+  stringstream ss;
+  ss  << firstPrefix << "Statement::" << this->_kind << endl
+      << this->_array->toString(nextFirstPrefix, nextPrefix);
+  nextPrefix = prefix + PREFIX_END;
+  ss  << this->_size->toString(nextFirstPrefix, nextPrefix);
+  return ss.str();
+}
+
+/**
+ * DeclarationAST
+ */
+DeclarationAST::DeclarationAST(VarType vtype, const std::vector<VariableAST*>& variables)
+  : _vtype(vtype), _variables(variables)
+{}
+
+DeclarationAST::~DeclarationAST()
+{
+  for (VariableAST* variable : this->_variables) {
+    delete variable;
+  }
+}
+
+void DeclarationAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  for (VariableAST* variable : this->_variables) {
+    variable->setType(this->_vtype);
+    variable->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+}
+
+bool DeclarationAST::Codegen(Builder&)
+{
+  return true;
+}
+
+bool DeclarationAST::Bytecodegen(BytecodeBuilder&)
+{
+  return true;
+}
+
+string DeclarationAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  nextFirstPrefix = prefix + PREFIX_BEGIN;
+  nextPrefix = prefix + PREFIX_MIDDLE;
+  stringstream ss;
+  ss  << firstPrefix << "Statement::Declaration " << this->_vtype << endl;
+  int length = this->_variables.size();
+  for (int i = 0; i < length; ++i) {
+    if (i + 1 == length) {
+      nextPrefix = prefix + PREFIX_END;
+    }
+    ss << this->_variables[i]->toString(nextFirstPrefix, nextPrefix);
+  }
+  return ss.str();
+}
+
+/**
+ * SortArrayAST
+ */
+SortArrayAST::SortArrayAST(const std::vector<VariableAST*>& arrays, bool descending)
+  : _arrays(arrays), _descending(descending)
+{}
+
+SortArrayAST::~SortArrayAST()
+{
+  for (VariableAST* array : this->_arrays) {
+    delete array;
+  }
+}
+
+void SortArrayAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  for (VariableAST* array : this->_arrays) {
+    array->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+}
+
+// Le tri réordonne les éléments, pas les identifiants : les variables ne sont
+// que lues
+void SortArrayAST::_effects(CodeEffects& e) const
+{
+  for (VariableAST* array : this->_arrays) {
+    array->effects(e);
+  }
+  e.calls = e.resizes = true;
+}
+
+// Les tableaux suivants sont d'abord transmis un par un au runtime, puis le tri
+// de la clé les réordonne tous
+bool SortArrayAST::Codegen(Builder& b)
+{
+  Function* follow = b.module().getFunction(Builtin::getList()["array.sortfollow"]->signature()->name());
+  Function* sort = b.module().getFunction(Builtin::getList()["sort array"]->signature()->name());
+  for (size_t i = 1; i < this->_arrays.size(); ++i) {
+    Value* array = this->_arrays[i]->Codegen(b);
+    if (!array) {
+      return false;
+    }
+    b.irbuilder().CreateCall(follow, array);
+  }
+  Value* key = this->_arrays[0]->Codegen(b);
+  if (!key) {
+    return false;
+  }
+  b.irbuilder().CreateCall2(sort, key, b.irbuilder().getInt32(this->_descending));
+  return true;
+}
+
+bool SortArrayAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  for (size_t i = 1; i < this->_arrays.size(); ++i) {
+    if (!this->_arrays[i]->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emit(OpCode::BUILTIN, 1, Builtin::getList()["array.sortfollow"]->getPtr());
+    bb.emit(OpCode::POP);
+  }
+  if (!this->_arrays[0]->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emit(OpCode::PUSH, this->_descending ? 1 : 0);
+  bb.emit(OpCode::BUILTIN, 2, Builtin::getList()["sort array"]->getPtr());
+  bb.emit(OpCode::POP);
+  return true;
+}
+
+string SortArrayAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  stringstream ss;
+  ss  << firstPrefix << "Statement::sort array " << (this->_descending ? "<" : ">") << endl;
+  for (size_t i = 0; i < this->_arrays.size(); ++i) {
+    bool last = i + 1 == this->_arrays.size();
+    nextFirstPrefix = prefix + PREFIX_BEGIN;
+    nextPrefix = prefix + (last ? PREFIX_END : PREFIX_MIDDLE);
+    ss  << this->_arrays[i]->toString(nextFirstPrefix, nextPrefix);
+  }
+  return ss.str();
+}
+
+
 /**
  * ExprAST
  */
@@ -661,6 +1686,16 @@ void ExprAST::setType(VarType vtype){
   this->_vtype = vtype;
 }
 
+bool ExprAST::_isConstantInt(long& val) const
+{
+  return false;
+}
+
+bool ExprAST::_isLocal(string&) const
+{
+  return false;
+}
+
 
 /**
  * LiteralAST
@@ -676,7 +1711,9 @@ void LiteralAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {}
 
@@ -689,9 +1726,45 @@ string LiteralAST::_toString(const string& firstPrefix, const string& prefix) co
 
 Value* LiteralAST::Codegen(Builder& b)
 {
+  if (this->_vtype == VarType::STRING) {
+    return b.textConstant(this->_val);
+  }
+  if (this->_vtype == VarType::REAL) {
+    return ConstantFP::get(b.type(VarType::REAL), strtod(this->_val.c_str(), nullptr));
+  }
+  if (this->_vtype == VarType::LONG) {
+    return ConstantInt::get(b.context(), APInt(64, strtoll(this->_val.c_str(), nullptr, 10), true));
+  }
   return ConstantInt::get(b.context(), APInt(32, Util::str2long(this->_val), true));
 }
 
+bool LiteralAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  // Le bytecode est exécuté dans ce processus : le texte est créé dès maintenant
+  if (this->_vtype == VarType::STRING) {
+    bb.emit(OpCode::PUSH, BUILTINtextConstant(this->_val.data(), this->_val.size()));
+    return true;
+  }
+  if (this->_vtype == VarType::REAL) {
+    bb.emitReal(strtod(this->_val.c_str(), nullptr));
+    return true;
+  }
+  if (this->_vtype == VarType::LONG) {
+    bb.emitLong(strtoll(this->_val.c_str(), nullptr, 10));
+    return true;
+  }
+  bb.emit(OpCode::PUSH, static_cast<int32_t>(Util::str2long(this->_val)));
+  return true;
+}
+
+bool LiteralAST::_isConstantInt(long& val) const
+{
+  if (this->_vtype != VarType::NUMBER && this->_vtype != VarType::INT) {
+    return false;
+  }
+  return Util::strConvert(this->_val, val);
+}
+
 
 /**
  * VariableAST
@@ -726,14 +1799,32 @@ void LocalVariableAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
+  tagVariable(this, this->_name, localVars);
   int num = 0;
   if (Util::strConvert(this->_name, num) && num >= 0) {
     argVars[num] = this->getType();
   }
-  localVars[this->_name] = this->getType();
+}
+
+void LocalVariableAST::_effects(CodeEffects& e) const
+{
+  e.readLocals.insert(this->_name);
+}
+
+void LocalVariableAST::_effectsMute(CodeEffects& e) const
+{
+  e.writtenLocals.insert(this->_name);
+}
+
+bool LocalVariableAST::_isLocal(string& name) const
+{
+  name = this->_name;
+  return true;
 }
 
 string LocalVariableAST::_toString(const string& firstPrefix, const string& prefix) const
@@ -748,15 +1839,42 @@ Value* LocalVariableAST::Codegen(Builder& b)
   AllocaInst* Alloca = b.localVars()[this->_name];
   assert(Alloca != nullptr);
   Value* V = b.irbuilder().CreateLoad(Alloca, "var.local."+_name+".");
+  // Un texte ou un objet lu porte sa propre référence
+  if (V && counted(this->getType())) {
+    V = b.callBuiltin(retainBuiltin(this->getType()), V, "var.local."+_name+".");
+  }
   return V ? V : AST::Error<Value>("Unknown local variable name");
 }
 Value* LocalVariableAST::CodegenMute(Builder& b, llvm::Value* Val)
 {
   AllocaInst* Alloca = b.localVars()[this->_name];
   assert(Alloca != nullptr);
-  Value* V = b.irbuilder().CreateStore(Val, Alloca);
+  // La variable reprend la référence du texte ou de l'objet affecté et rend
+  // l'ancienne
+  if (counted(this->getType())) {
+    b.callBuiltin(releaseBuiltin(this->getType()), b.irbuilder().CreateLoad(Alloca, "var.local."+_name+".old"));
+  }
+  Value* V = b.irbuilder().CreateStore(b.convert(Val, Alloca->getAllocatedType()), Alloca);
   return V ? V : AST::Error<Value>("Unknown local variable name");
 }
+bool LocalVariableAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  bb.emit(OpCode::LOAD, bb.slot(this->_name));
+  if (counted(this->getType())) {
+    emitBuiltin(bb, retainBuiltin(this->getType()));
+  }
+  return true;
+}
+bool LocalVariableAST::BytecodegenMute(BytecodeBuilder& bb)
+{
+  if (counted(this->getType())) {
+    bb.emit(OpCode::LOAD, bb.slot(this->_name));
+    emitBuiltin(bb, releaseBuiltin(this->getType()));
+    bb.emit(OpCode::POP);
+  }
+  bb.emit(OpCode::STORE, bb.slot(this->_name));
+  return true;
+}
 
 /**
  * GlobaleVariableAST
@@ -770,10 +1888,22 @@ void GlobaleVariableAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  globaleVars[this->_name] = this->getType();
+  tagVariable(this, this->_name, globaleVars);
+}
+
+void GlobaleVariableAST::_effects(CodeEffects& e) const
+{
+  e.readsGlobals = true;
+}
+
+void GlobaleVariableAST::_effectsMute(CodeEffects& e) const
+{
+  e.writesGlobals = true;
 }
 
 string GlobaleVariableAST::_toString(const string& firstPrefix, const string& prefix) const
@@ -787,56 +1917,492 @@ Value* GlobaleVariableAST::Codegen(Builder& b)
 {
   GlobalVariable* ptr = b.globalVars()[this->_name];
   assert(ptr != nullptr);
-  Value* V = b.irbuilder().CreateLoad(ptr, "var.global."+_name+".");
+  // Variable réelle dans une autre méthode : lue au type de cette occurrence
+  Value* V = b.convert(b.irbuilder().CreateLoad(ptr, "var.global."+_name+"."), this->getType());
+  if (V && counted(this->getType())) {
+    V = b.callBuiltin(retainBuiltin(this->getType()), V, "var.global."+_name+".");
+  }
+  return V ? V : AST::Error<Value>("Unknown global variable name");
+}
+Value* GlobaleVariableAST::CodegenMute(Builder& b, llvm::Value* Val)
+{
+  GlobalVariable* ptr = b.globalVars()[this->_name];
+  assert(ptr != nullptr);
+  if (counted(this->getType())) {
+    b.callBuiltin(releaseBuiltin(this->getType()), b.irbuilder().CreateLoad(ptr, "var.global."+_name+".old"));
+  }
+  Value* V = b.irbuilder().CreateStore(b.convert(Val, ptr->getType()->getElementType()), ptr);
   return V ? V : AST::Error<Value>("Unknown global variable name");
 }
-Value* GlobaleVariableAST::CodegenMute(Builder& b, llvm::Value* Val)
+
+bool GlobaleVariableAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  int32_t* ptr = bb.globalVar(this->_name);
+  assert(ptr != nullptr);
+  bb.emit(isWide(this->getType()) ? OpCode::LOADGW : OpCode::LOADG, 0, ptr);
+  if (counted(this->getType())) {
+    emitBuiltin(bb, retainBuiltin(this->getType()));
+  }
+  return true;
+}
+bool GlobaleVariableAST::BytecodegenMute(BytecodeBuilder& bb)
+{
+  int32_t* ptr = bb.globalVar(this->_name);
+  assert(ptr != nullptr);
+  if (counted(this->getType())) {
+    bb.emit(OpCode::LOADG, 0, ptr);
+    emitBuiltin(bb, releaseBuiltin(this->getType()));
+    bb.emit(OpCode::POP);
+  }
+  bb.emit(isWide(this->getType()) ? OpCode::STOREGW : OpCode::STOREG, 0, ptr);
+  return true;
+}
+
+/**
+ * PersistentVariableAST
+ */
+PersistentVariableAST::PersistentVariableAST(const std::string& name)
+  : _name(name)
+{}
+PersistentVariableAST::~PersistentVariableAST() = default;
+
+void PersistentVariableAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  tagVariable(this, this->_name, persistentVars);
+}
+
+void PersistentVariableAST::_effects(CodeEffects& e) const
+{
+  e.readsGlobals = true;
+}
+
+void PersistentVariableAST::_effectsMute(CodeEffects& e) const
+{
+  e.writesGlobals = true;
+}
+
+string PersistentVariableAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  stringstream ss;
+  ss  << firstPrefix << "Expression::Variable <>" << this->_name << endl;
+  return ss.str();
+}
+
+Value* PersistentVariableAST::Codegen(Builder& b)
+{
+  GlobalVariable* ptr = b.persistentVars()[this->_name];
+  assert(ptr != nullptr);
+  // Variable réelle dans une autre méthode : lue au type de cette occurrence
+  Value* V = b.convert(b.irbuilder().CreateLoad(ptr, "var.persistent."+_name+"."), this->getType());
+  if (V && counted(this->getType())) {
+    V = b.callBuiltin(retainBuiltin(this->getType()), V, "var.persistent."+_name+".");
+  }
+  return V ? V : AST::Error<Value>("Unknown persistent variable name");
+}
+Value* PersistentVariableAST::CodegenMute(Builder& b, llvm::Value* Val)
+{
+  GlobalVariable* ptr = b.persistentVars()[this->_name];
+  assert(ptr != nullptr);
+  if (counted(this->getType())) {
+    b.callBuiltin(releaseBuiltin(this->getType()), b.irbuilder().CreateLoad(ptr, "var.persistent."+_name+".old"));
+  }
+  Value* V = b.irbuilder().CreateStore(b.convert(Val, ptr->getType()->getElementType()), ptr);
+  return V ? V : AST::Error<Value>("Unknown persistent variable name");
+}
+
+bool PersistentVariableAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  int32_t* ptr = bb.persistentVar(this->_name);
+  assert(ptr != nullptr);
+  bb.emit(isWide(this->getType()) ? OpCode::LOADGW : OpCode::LOADG, 0, ptr);
+  if (counted(this->getType())) {
+    emitBuiltin(bb, retainBuiltin(this->getType()));
+  }
+  return true;
+}
+bool PersistentVariableAST::BytecodegenMute(BytecodeBuilder& bb)
+{
+  int32_t* ptr = bb.persistentVar(this->_name);
+  assert(ptr != nullptr);
+  if (counted(this->getType())) {
+    bb.emit(OpCode::LOADG, 0, ptr);
+    emitBuiltin(bb, releaseBuiltin(this->getType()));
+    bb.emit(OpCode::POP);
+  }
+  bb.emit(isWide(this->getType()) ? OpCode::STOREGW : OpCode::STOREG, 0, ptr);
+  return true;
+}
+
+/**
+ * ArrayElementAST
+ */
+ArrayElementAST::ArrayElementAST(VariableAST* array, ExprAST* index)
+  : _array(array), _index(index)
+{}
+
+ArrayElementAST::~ArrayElementAST()
+{
+  delete this->_array;
+  delete this->_index;
+}
+
+void ArrayElementAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  this->_array->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->_index->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->setType(elementType(this->_array->getType()));
+}
+
+void ArrayElementAST::_effects(CodeEffects& e) const
+{
+  this->_array->effects(e);
+  this->_index->effects(e);
+  string array, index;
+  if (this->_array->isLocal(array) && this->_index->isLocal(index)) {
+    e.indexedArrays.push_back(make_pair(array, index));
+  }
+}
+
+// Modifier un élément ne modifie ni la variable tableau ni la taille du tableau
+void ArrayElementAST::_effectsMute(CodeEffects& e) const
+{
+  this->_effects(e);
+}
+
+string ArrayElementAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  nextFirstPrefix = prefix + PREFIX_BEGIN;
+  nextPrefix = prefix + PREFIX_MIDDLE;
+  stringstream ss;
+  ss  << firstPrefix << "Expression::Element" << endl
+      << this->_array->toString(nextFirstPrefix, nextPrefix);
+  nextPrefix = prefix + PREFIX_END;
+  ss  << this->_index->toString(nextFirstPrefix, nextPrefix);
+  return ss.str();
+}
+
+/*
+ * Adresse de l'élément. Le contrôle des bornes est omis lorsqu'une boucle For
+ * englobante l'a déjà fait pour toute la plage de l'index (ForAST::Codegen).
+ */
+Value* ArrayElementAST::CodegenElement(Builder& b)
+{
+  Value* index = this->_index->Codegen(b);
+  if (!index) {
+    return nullptr;
+  }
+  index = b.convert(index, VarType::INT);
+  string arrayName, indexName;
+  if (this->_array->isLocal(arrayName) && this->_index->isLocal(indexName)) {
+    if (Value* data = b.inBoundsData(arrayName, indexName)) {
+      return b.element(data, index, this->getType());
+    }
+  }
+  Value* array = this->_array->Codegen(b);
+  if (!array) {
+    return nullptr;
+  }
+  return b.arrayElement(array, index, this->getType());
+}
+
+Value* ArrayElementAST::Codegen(Builder& b)
+{
+  Value* ptr = this->CodegenElement(b);
+  if (!ptr) {
+    return nullptr;
+  }
+  Value* V = b.irbuilder().CreateLoad(ptr, "array.value");
+  // Un texte lu porte sa propre référence
+  if (this->getType() == VarType::STRING) {
+    V = b.callBuiltin("text.retain", V, "array.text");
+  }
+  return V;
+}
+// Le tableau reprend la référence du texte affecté et rend l'ancienne
+Value* ArrayElementAST::CodegenMute(Builder& b, llvm::Value* Val)
+{
+  Value* ptr = this->CodegenElement(b);
+  if (!ptr) {
+    return nullptr;
+  }
+  if (this->getType() == VarType::STRING) {
+    b.callBuiltin("text.release", b.irbuilder().CreateLoad(ptr, "array.old"));
+  }
+  return b.irbuilder().CreateStore(b.convert(Val, this->getType()), ptr);
+}
+
+// Tableaux de réels et de textes : GETV et SETV, qui passent des valeurs de
+// 64 bits
+bool ArrayElementAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->_array->Bytecodegen(bb) || !this->_index->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_index->getType(), VarType::INT);
+  if (this->getType() == VarType::INT) {
+    bb.emit(OpCode::BUILTIN, 2, Builtin::getList()["array.get"]->getPtr());
+  } else {
+    bb.emit(OpCode::GETV, valueKind(this->getType()), Builtin::getList()["array.getvalue"]->getPtr());
+  }
+  return true;
+}
+// La valeur à affecter est déjà sur la pile : premier argument de BUILTINarraySet
+bool ArrayElementAST::BytecodegenMute(BytecodeBuilder& bb)
+{
+  if (!this->_array->Bytecodegen(bb) || !this->_index->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_index->getType(), VarType::INT);
+  if (this->getType() == VarType::INT) {
+    bb.emit(OpCode::BUILTIN, 3, Builtin::getList()["array.set"]->getPtr());
+  } else {
+    bb.emit(OpCode::SETV, valueKind(this->getType()), Builtin::getList()["array.setvalue"]->getPtr());
+  }
+  bb.emit(OpCode::POP);
+  return true;
+}
+
+
+/**
+ * PropertyAST
+ */
+PropertyAST::PropertyAST(ExprAST* object, const std::string& name)
+  : _object(object), _name(name), _key(nullptr)
+{}
+PropertyAST::PropertyAST(ExprAST* object, ExprAST* key)
+  : _object(object), _key(key)
+{}
+
+PropertyAST::~PropertyAST()
+{
+  delete this->_object;
+  delete this->_key;
+}
+
+void PropertyAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  this->_object->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if (this->_object->getType() == VarType::NOTDEFINE && this->_object->isVar()) {
+    this->_object->setType(VarType::OBJECT);
+    this->_object->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  if (this->_key) {
+    this->_key->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  } else {
+    tagVariable(this, this->_name, propertyTypes);
+  }
+}
+
+// $collection[index] ; un texte entre crochets est un nom d'attribut
+bool PropertyAST::isElement() const
+{
+  return this->_key && this->_key->getType() != VarType::STRING;
+}
+
+// L'objet d'une variable locale est emprunté, sans référence : aucun appel
+// pendant l'accès ne peut modifier la variable
+bool PropertyAST::borrowsObject(string& local) const
+{
+  return this->_object->getType() == VarType::OBJECT && this->_object->isLocal(local);
+}
+
+// Genre de la valeur ; un objet lu avec sa référence la rend après l'accès
+int PropertyAST::accessKind() const
+{
+  string local;
+  bool owned = this->_object->getType() == VarType::OBJECT && !this->borrowsObject(local);
+  return valueKind(this->getType()) | (owned ? FOURDVALUE_RELEASE : 0);
+}
+
+void PropertyAST::_effects(CodeEffects& e) const
+{
+  this->_object->effects(e);
+  if (this->_key) {
+    this->_key->effects(e);
+  }
+  e.readsGlobals = true;
+}
+
+// Les objets sont partagés : modifier un attribut modifie l'objet de toutes
+// les variables qui le désignent
+void PropertyAST::_effectsMute(CodeEffects& e) const
+{
+  this->_object->effects(e);
+  if (this->_key) {
+    this->_key->effects(e);
+  }
+  e.writesGlobals = true;
+}
+
+string PropertyAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  nextFirstPrefix = prefix + PREFIX_BEGIN;
+  nextPrefix = prefix + (this->_key ? PREFIX_MIDDLE : PREFIX_END);
+  stringstream ss;
+  ss  << firstPrefix << "Expression::Property " << this->_name << endl
+      << this->_object->toString(nextFirstPrefix, nextPrefix);
+  if (this->_key) {
+    nextPrefix = prefix + PREFIX_END;
+    ss  << this->_key->toString(nextFirstPrefix, nextPrefix);
+  }
+  return ss.str();
+}
+
+/*
+ * Objet et clé de l'accès. Un attribut nommé passe par le cache du site
+ * (Builder::getProperty), sans clé ; un attribut calculé est cherché sans
+ * être créé pour une lecture.
+ */
+bool PropertyAST::CodegenAccess(Builder& b, bool mute, Value*& object, Value*& key)
+{
+  string local;
+  if (this->borrowsObject(local)) {
+    object = b.irbuilder().CreateLoad(b.localVars()[local], "var.local."+local+".");
+  } else {
+    object = this->_object->Codegen(b);
+  }
+  if (!object) {
+    return false;
+  }
+  object = b.convert(object, VarType::OBJECT);
+  key = nullptr;
+  if (!this->_key) {
+    return true;
+  }
+  key = this->_key->Codegen(b);
+  if (!key) {
+    return false;
+  }
+  if (this->isElement()) {
+    key = b.convert(key, VarType::INT);
+  } else {
+    key = b.callBuiltin(mute ? "object.keyof" : "object.findkey", key, "object.key");
+  }
+  return true;
+}
+
+Value* PropertyAST::Codegen(Builder& b)
 {
-  GlobalVariable* ptr = b.globalVars()[this->_name];
-  assert(ptr != nullptr);
-  Value* V = b.irbuilder().CreateStore(Val, ptr);
-  return V ? V : AST::Error<Value>("Unknown global variable name");
+  Value *object, *key;
+  if (!this->CodegenAccess(b, false, object, key)) {
+    return nullptr;
+  }
+  VarType vtype = this->getType();
+  Value* V;
+  if (!this->_key) {
+    V = b.getProperty(object, this->_name, this->accessKind());
+  } else {
+    Value* args[] = {object, key, b.irbuilder().getInt32(this->accessKind())};
+    V = b.callBuiltin(this->isElement() ? "collection.get" : "object.get", args, "property");
+  }
+  if (vtype == VarType::REAL) {
+    return b.irbuilder().CreateBitCast(V, b.type(VarType::REAL), "property.real");
+  }
+  V = b.convert(V, vtype);
+  if (vtype == VarType::BOOLEAN) {
+    return b.irbuilder().CreateICmpNE(V, b.irbuilder().getInt32(0), "property.bool");
+  }
+  return V;
 }
-
-
-/**
- * PersistentVariableAST
- */
-PersistentVariableAST::PersistentVariableAST(const std::string& name)
-  : _name(name)
-{}
-PersistentVariableAST::~PersistentVariableAST() = default;
-
-void PersistentVariableAST::_taggingPass(
-              std::map<int, VarType>& argVars,
-              std::map<std::string, VarType>& localVars,
-              std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
-            )
+// L'objet reprend la référence du texte ou de l'objet affecté et rend l'ancienne
+Value* PropertyAST::CodegenMute(Builder& b, llvm::Value* Val)
 {
-  persistentVars[this->_name] = this->getType();
+  if (!Val) {
+    return nullptr;
+  }
+  VarType vtype = this->getType();
+  Val = valueBits(b, Val, vtype);
+  Value *object, *key;
+  if (!this->CodegenAccess(b, true, object, key)) {
+    return nullptr;
+  }
+  if (!this->_key) {
+    return b.setProperty(object, this->_name, this->accessKind(), Val);
+  }
+  Value* args[] = {object, key, b.irbuilder().getInt32(this->accessKind()), Val};
+  return b.callBuiltin(this->isElement() ? "collection.set" : "object.set", args);
 }
 
-string PersistentVariableAST::_toString(const string& firstPrefix, const string& prefix) const
+// Empile l'objet et la clé ; la clé d'un attribut nommé est internée dès la
+// génération du bytecode, exécuté dans le même processus
+bool PropertyAST::BytecodegenAccess(BytecodeBuilder& bb, bool mute)
 {
-  stringstream ss;
-  ss  << firstPrefix << "Expression::Variable <>" << this->_name << endl;
-  return ss.str();
+  string local;
+  if (this->borrowsObject(local)) {
+    bb.emit(OpCode::LOAD, bb.slot(local));
+  } else if (!this->_object->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_object->getType(), VarType::OBJECT);
+  if (!this->_key) {
+    bb.emit(OpCode::PUSH, BUILTINobjectKey(this->_name.data(), this->_name.size()));
+    return true;
+  }
+  if (!this->_key->Bytecodegen(bb)) {
+    return false;
+  }
+  if (this->isElement()) {
+    bb.emitConvert(this->_key->getType(), VarType::INT);
+  } else {
+    emitBuiltin(bb, mute ? "object.keyof" : "object.findkey");
+  }
+  return true;
 }
 
-Value* PersistentVariableAST::Codegen(Builder& b)
+bool PropertyAST::Bytecodegen(BytecodeBuilder& bb)
 {
-  GlobalVariable* ptr = b.persistentVars()[this->_name];
-  assert(ptr != nullptr);
-  Value* V = b.irbuilder().CreateLoad(ptr, "var.persistent."+_name+".");
-  return V ? V : AST::Error<Value>("Unknown persistent variable name");
+  if (!this->BytecodegenAccess(bb, false)) {
+    return false;
+  }
+  VarType vtype = this->getType();
+  if (!this->_key) {
+    bb.emit(OpCode::GETP, this->accessKind(), bb.propertyCache());
+  } else {
+    Builtin* get = Builtin::getList()[this->isElement() ? "collection.get" : "object.get"];
+    bb.emit(OpCode::GETV, this->accessKind(), get->getPtr());
+  }
+  if (!isWide(vtype)) {
+    bb.emit(OpCode::LTOI);
+  }
+  return true;
 }
-Value* PersistentVariableAST::CodegenMute(Builder& b, llvm::Value* Val)
+// La valeur à affecter est déjà sur la pile, au type de l'attribut
+bool PropertyAST::BytecodegenMute(BytecodeBuilder& bb)
 {
-  GlobalVariable* ptr = b.persistentVars()[this->_name];
-  assert(ptr != nullptr);
-  Value* V = b.irbuilder().CreateStore(Val, ptr);
-  return V ? V : AST::Error<Value>("Unknown persistent variable name");
+  if (!this->BytecodegenAccess(bb, true)) {
+    return false;
+  }
+  if (!this->_key) {
+    bb.emit(OpCode::SETP, this->accessKind(), bb.propertyCache());
+  } else {
+    Builtin* set = Builtin::getList()[this->isElement() ? "collection.set" : "object.set"];
+    bb.emit(OpCode::SETV, this->accessKind(), set->getPtr());
+  }
+  bb.emit(OpCode::POP);
+  return true;
 }
 
 
@@ -855,13 +2421,20 @@ void UniOpAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
-  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_expr->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
   this->setType(this->_expr->getType());
 }
 
+void UniOpAST::_effects(CodeEffects& e) const
+{
+  this->_expr->effects(e);
+}
+
 string UniOpAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextFirstPrefix, nextPrefix;
@@ -881,10 +2454,35 @@ Value* UniOpAST::Codegen(Builder& b)
   if (!L) return nullptr;
   
   if (this->_str == "+") return L;
+  if (this->_str == "-" && L->getType()->isDoubleTy()) return b.irbuilder().CreateFNeg(L, "negtmp");
   if (this->_str == "-") return b.irbuilder().CreateNeg(L, "negtmp");
   return AST::Error<Value>("invalid unary operator");
 }
 
+bool UniOpAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->_expr->Bytecodegen(bb)) return false;
+
+  if (this->_str == "+") return true;
+  if (this->_str == "-") {
+    VarType vtype = this->_expr->getType();
+    bb.emit(vtype == VarType::REAL ? OpCode::NEGR : vtype == VarType::LONG ? OpCode::NEGL : OpCode::NEG);
+    return true;
+  }
+  return AST::Error<bool>("invalid unary operator");
+}
+
+bool UniOpAST::_isConstantInt(long& val) const
+{
+  if (!this->_expr->isConstantInt(val)) return false;
+  if (this->_str == "+") return true;
+  if (this->_str == "-") {
+    val = -val;
+    return true;
+  }
+  return false;
+}
+
 /**
  * BinOpAST
  */
@@ -901,14 +2499,17 @@ void BinOpAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
   VarType opType = VarType::NOTDEFINE;
-  this->_lhs->taggingPass(argVars, localVars, globaleVars, persistentVars);
-  this->_rhs->taggingPass(argVars, localVars, globaleVars, persistentVars);
+  this->_lhs->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  this->_rhs->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
   if(this->_lhs->getType() != VarType::NOTDEFINE){
-    if(this->_rhs->getType()!=VarType::NOTDEFINE && this->_lhs->getType() != this->_rhs->getType() ){
+    if(this->_rhs->getType()!=VarType::NOTDEFINE && this->_lhs->getType() != this->_rhs->getType()
+       && !(isNumeric(this->_lhs->getType()) && isNumeric(this->_rhs->getType()))){
       Logger::error << "AST error: implicite cast of " << this->_rhs->getType() << " in " << this->_lhs->getType() << std::endl;
     }
     opType = this->_lhs->getType();
@@ -916,9 +2517,44 @@ void BinOpAST::_taggingPass(
     opType = this->_rhs->getType();
   }   
 
+  // Entier et réel : l'entier est converti, l'opération est réelle. Une
+  // variable sans type de l'autre côté est aussi un réel.
+  if (this->isReal()) {
+    opType = VarType::REAL;
+    for (ExprAST* operand : {this->_lhs, this->_rhs}) {
+      if (operand->getType() == VarType::NOTDEFINE && operand->isVar()) {
+        operand->setType(VarType::REAL);
+        operand->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+      }
+    }
+  }
+
+  // Entier 64 bits : l'autre opérande est étendu, comme pour les réels
+  if (this->isLong()) {
+    opType = VarType::LONG;
+    for (ExprAST* operand : {this->_lhs, this->_rhs}) {
+      if (operand->getType() == VarType::NOTDEFINE && operand->isVar()) {
+        operand->setType(VarType::LONG);
+        operand->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+      }
+    }
+  }
+
+  // Texte : une variable sans type de l'autre côté est aussi un texte
+  if (this->_lhs->getType() == VarType::STRING || this->_rhs->getType() == VarType::STRING) {
+    opType = VarType::STRING;
+    for (ExprAST* operand : {this->_lhs, this->_rhs}) {
+      if (operand->getType() == VarType::NOTDEFINE && operand->isVar()) {
+        operand->setType(VarType::STRING);
+        operand->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+      }
+    }
+  }
+
   if(this->_str != "<" &&
      this->_str != ">" &&
      this->_str != "=" &&
+     this->_str != "#" &&
      this->_str != "<=" &&
      this->_str != ">=" &&
      this->_str != "&" &&
@@ -930,6 +2566,12 @@ void BinOpAST::_taggingPass(
   }
 }
 
+void BinOpAST::_effects(CodeEffects& e) const
+{
+  this->_lhs->effects(e);
+  this->_rhs->effects(e);
+}
+
 string BinOpAST::_toString(const string& firstPrefix, const string& prefix) const
 {
   string nextFirstPrefix, nextPrefix;
@@ -951,13 +2593,22 @@ Value* BinOpAST::Codegen(Builder& b)
     return nullptr;
   }
   
-  auto* BB = b.currentBlock();
-  assert(BB != nullptr);
-  // Opérations arithmétiques
-  if (this->_str == "+") return b.irbuilder().CreateAdd(L, R, "op.add", BB);
-  if (this->_str == "-") return b.irbuilder().CreateSub(L, R, "op.sub", BB);
-  if (this->_str == "*") return b.irbuilder().CreateMul(L, R, "op.mul", BB);
-  if (this->_str == "/") return b.irbuilder().CreateSDiv(L, R, "op.div", BB);
+  if (this->isText()) {
+    return this->CodegenText(b, L, R);
+  }
+  if (this->isReal()) {
+    return this->CodegenReal(b, L, R);
+  }
+  if (this->isLong()) {
+    L = b.convert(L, VarType::LONG);
+    R = b.convert(R, VarType::LONG);
+  }
+  
+  // Opérations arithmétiques : elles bouclent sur 32 ou 64 bits, comme dans l'interpréteur
+  if (this->_str == "+") return b.irbuilder().CreateAdd(L, R, "op.add");
+  if (this->_str == "-") return b.irbuilder().CreateSub(L, R, "op.sub");
+  if (this->_str == "*") return b.irbuilder().CreateMul(L, R, "op.mul");
+  if (this->_str == "/") return b.irbuilder().CreateSDiv(L, R, "op.div");
   
   // Comparaisons
   if (this->_str == "<")  return b.irbuilder().CreateICmpSLT(L, R, "op.lt");
@@ -979,13 +2630,166 @@ Value* BinOpAST::Codegen(Builder& b)
   return AST::Error<Value>(ss.str());
 }
 
+bool BinOpAST::isText() const
+{
+  return this->_lhs->getType() == VarType::STRING || this->_rhs->getType() == VarType::STRING;
+}
+
+// Opération arithmétique ou comparaison dont un opérande est réel
+bool BinOpAST::isReal() const
+{
+  return (this->_lhs->getType() == VarType::REAL || this->_rhs->getType() == VarType::REAL)
+      && this->_str != "&" && this->_str != "|";
+}
+
+// Opération arithmétique ou comparaison entière dont un opérande est un entier
+// 64 bits
+bool BinOpAST::isLong() const
+{
+  return (this->_lhs->getType() == VarType::LONG || this->_rhs->getType() == VarType::LONG)
+      && !this->isReal() && this->_str != "&" && this->_str != "|";
+}
+
+// Opérations sur des double ; en --fast-math, l'IRBuilder y ajoute les
+// drapeaux qui autorisent réassociation et contraction
+Value* BinOpAST::CodegenReal(Builder& b, Value* L, Value* R)
+{
+  IRBuilder<>& irb = b.irbuilder();
+  L = b.convert(L, VarType::REAL);
+  R = b.convert(R, VarType::REAL);
+  if (this->_str == "+") return irb.CreateFAdd(L, R, "op.fadd");
+  if (this->_str == "-") return irb.CreateFSub(L, R, "op.fsub");
+  if (this->_str == "*") return irb.CreateFMul(L, R, "op.fmul");
+  if (this->_str == "/") return irb.CreateFDiv(L, R, "op.fdiv");
+  // Comparaisons ordonnées : fausses avec NaN, sauf #
+  static const std::map<std::string, CmpInst::Predicate> predicates{
+    {"<", CmpInst::FCMP_OLT}, {"<=", CmpInst::FCMP_OLE}, {">", CmpInst::FCMP_OGT},
+    {">=", CmpInst::FCMP_OGE}, {"=", CmpInst::FCMP_OEQ}, {"#", CmpInst::FCMP_UNE}
+  };
+  auto it = predicates.find(this->_str);
+  if (it == predicates.end()) {
+    stringstream ss;
+    ss << endl << "Build Error: Invalid real operator " << _str;
+    return AST::Error<Value>(ss.str());
+  }
+  return irb.CreateFCmp(it->second, L, R, "op.fcmp");
+}
+
+// Concaténation, ou comparaison par BUILTINtextCompare (-1, 0 ou 1)
+Value* BinOpAST::CodegenText(Builder& b, Value* L, Value* R)
+{
+  Value* args[] = {L, R};
+  if (this->_str == "+") {
+    return b.callBuiltin("text.concat", args, "op.concat");
+  }
+  static const std::map<std::string, CmpInst::Predicate> predicates{
+    {"<", CmpInst::ICMP_SLT}, {"<=", CmpInst::ICMP_SLE}, {">", CmpInst::ICMP_SGT},
+    {">=", CmpInst::ICMP_SGE}, {"=", CmpInst::ICMP_EQ}, {"#", CmpInst::ICMP_NE}
+  };
+  auto it = predicates.find(this->_str);
+  if (it == predicates.end()) {
+    stringstream ss;
+    ss << endl << "Build Error: Invalid text operator " << _str;
+    return AST::Error<Value>(ss.str());
+  }
+  Value* order = b.callBuiltin("text.compare", args, "op.compare");
+  return b.irbuilder().CreateICmp(it->second, order, ConstantInt::get(order->getType(), 0), "op.textcmp");
+}
+
+bool BinOpAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (this->isReal()) {
+    if (!this->_lhs->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_lhs->getType(), VarType::REAL);
+    if (!this->_rhs->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_rhs->getType(), VarType::REAL);
+    static const std::map<std::string, OpCode> realOpCodes{
+      {"+", OpCode::ADDR}, {"-", OpCode::SUBR}, {"*", OpCode::MULR}, {"/", OpCode::DIVR},
+      {"<", OpCode::LTR}, {"<=", OpCode::LER}, {">", OpCode::GTR}, {">=", OpCode::GER},
+      {"=", OpCode::EQR}, {"#", OpCode::NER}
+    };
+    auto it = realOpCodes.find(this->_str);
+    if (it == realOpCodes.end()) {
+      stringstream ss;
+      ss << endl << "Build Error: Invalid real operator " << _str;
+      return AST::Error<bool>(ss.str());
+    }
+    bb.emit(it->second);
+    return true;
+  }
+
+  if (this->isLong()) {
+    if (!this->_lhs->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_lhs->getType(), VarType::LONG);
+    if (!this->_rhs->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_rhs->getType(), VarType::LONG);
+    // Les comparaisons d'entiers portent déjà sur 64 bits
+    static const std::map<std::string, OpCode> longOpCodes{
+      {"+", OpCode::ADDL}, {"-", OpCode::SUBL}, {"*", OpCode::MULL}, {"/", OpCode::DIVL},
+      {"<", OpCode::LT}, {"<=", OpCode::LE}, {">", OpCode::GT}, {">=", OpCode::GE},
+      {"=", OpCode::EQ}, {"#", OpCode::NE}
+    };
+    auto it = longOpCodes.find(this->_str);
+    if (it == longOpCodes.end()) {
+      stringstream ss;
+      ss << endl << "Build Error: Invalid binary operator " << _str;
+      return AST::Error<bool>(ss.str());
+    }
+    bb.emit(it->second);
+    return true;
+  }
+
+  if (!this->_lhs->Bytecodegen(bb) || !this->_rhs->Bytecodegen(bb)) {
+    return false;
+  }
+
+  if (this->isText()) {
+    if (this->_str == "+") {
+      emitBuiltin(bb, "text.concat");
+      return true;
+    }
+    if (this->_str != "<" && this->_str != "<=" && this->_str != ">" && this->_str != ">="
+        && this->_str != "=" && this->_str != "#") {
+      stringstream ss;
+      ss << endl << "Build Error: Invalid text operator " << _str;
+      return AST::Error<bool>(ss.str());
+    }
+    // Comparaison de l'ordre des textes avec 0
+    emitBuiltin(bb, "text.compare");
+    bb.emit(OpCode::PUSH, 0);
+  }
+
+  static const std::map<std::string, OpCode> opCodes{
+    {"+", OpCode::ADD}, {"-", OpCode::SUB}, {"*", OpCode::MUL}, {"/", OpCode::DIV},
+    {"<", OpCode::LT}, {"<=", OpCode::LE}, {">", OpCode::GT}, {">=", OpCode::GE},
+    {"&", OpCode::AND}, {"|", OpCode::OR}, {"=", OpCode::EQ}, {"#", OpCode::NE}
+  };
+  auto it = opCodes.find(this->_str);
+  if (it == opCodes.end()) {
+    stringstream ss;
+    ss << endl << "Build Error: Invalid binary operator " << _str;
+    return AST::Error<bool>(ss.str());
+  }
+  bb.emit(it->second);
+  return true;
+}
 
 /**
  * CallAST
  */
 CallAST::CallAST(const std::string& name, const std::vector<ExprAST*>& args)
   : _name(name), _args(args)
-{}
+{
+  this->_vtype = VarType::NOTDEFINE;
+}
 CallAST::~CallAST()
 {
   auto it = this->_args.begin();
@@ -1000,11 +2804,89 @@ void CallAST::_taggingPass(
               std::map<int, VarType>& argVars,
               std::map<std::string, VarType>& localVars,
               std::map<std::string, VarType>& globaleVars,
-              std::map<std::string, VarType>& persistentVars
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
             )
 {
   for (auto& arg : this->_args) {
-    arg->taggingPass(argVars, localVars, globaleVars, persistentVars);
+    arg->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  if (mathFunction(this->_name)) {
+    this->setType(VarType::REAL);
+    return;
+  }
+  // Type du résultat d'un builtin, ou d'une méthode déjà analysée.
+  // Une variable sans type passée là où le builtin attend un texte en est un.
+  string name = this->builtinName();
+  if (!name.empty()) {
+    FunctionSignature* signature = Builtin::getList()[name]->signature();
+    vector<VarType> argsType = signature->argsType();
+    for (size_t i = 0; i < this->_args.size() && i < argsType.size(); ++i) {
+      ExprAST* arg = this->_args[i];
+      if (argsType[i] == VarType::STRING && arg->getType() == VarType::NOTDEFINE && arg->isVar()) {
+        arg->setType(VarType::STRING);
+        arg->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+      }
+    }
+    this->setType(signature->returnType());
+  } else {
+    // NOTDEFINE si la méthode n'est pas encore analysée : la seconde passe de
+    // Builder::taggingPass type l'appel
+    auto it = returnTypes.find(this->_name);
+    if (it != returnTypes.end()) {
+      this->setType(it->second);
+    }
+  }
+}
+
+// Clé du builtin appelé, "" pour une méthode. Un builtin "nom.text" ou
+// "nom.real" remplace "nom" quand son premier argument est un texte ou un réel
+// (ALERT, String) ou un tableau de textes ou de réels (APPEND TO ARRAY, Sum),
+// "nom.N" quand il reçoit N arguments (paramètre facultatif).
+string CallAST::builtinName() const
+{
+  VarType first = this->_args.empty() ? VarType::NOTDEFINE : this->_args[0]->getType();
+  if (isArray(first)) {
+    first = elementType(first);
+  }
+  if (first == VarType::STRING && Builtin::getList().count(this->_name + ".text")) {
+    return this->_name + ".text";
+  }
+  if (first == VarType::REAL && Builtin::getList().count(this->_name + ".real")) {
+    return this->_name + ".real";
+  }
+  if (first == VarType::LONG && Builtin::getList().count(this->_name + ".long")) {
+    return this->_name + ".long";
+  }
+  string arity = this->_name + "." + Util::toS(this->_args.size());
+  if (Builtin::getList().count(arity)) {
+    return arity;
+  }
+  return Builtin::getList().count(this->_name) ? this->_name : "";
+}
+
+void CallAST::_effects(CodeEffects& e) const
+{
+  for (auto& arg : this->_args) {
+    arg->effects(e);
+  }
+  if (mathFunction(this->_name)) {
+    return;
+  }
+  BuiltinEffect effect = BuiltinEffect::RESIZE;
+  string builtin = this->builtinName();
+  if (!builtin.empty()) {
+    effect = Builtin::getList()[builtin]->effect();
+  } else {
+    // Une méthode peut modifier les variables globales et les tableaux
+    e.writesGlobals = true;
+  }
+  if (effect != BuiltinEffect::NONE) {
+    e.calls = true;
+  }
+  if (effect == BuiltinEffect::RESIZE) {
+    e.resizes = true;
   }
 }
 
@@ -1027,10 +2909,36 @@ string CallAST::_toString(const string& firstPrefix, const string& prefix) const
 
 Value* CallAST::Codegen(Builder& b)
 {
-  string& name = this->_name;
+  if (const MathFunction* math = mathFunction(this->_name)) {
+    double scale = 1;
+    if (this->_args.size() != 1 && !(math->places && this->_args.size() == 2 && mathScale(this->_args[1], scale))) {
+      stringstream ss;
+      ss  << endl << "Build Error: Incorrect args passed to \"" << this->_name << "\": "
+          << "a real" << (math->places ? " and a constant number of places" : "") << " expected";
+      return AST::Error<Value>(ss.str());
+    }
+    Value* V = this->_args[0]->Codegen(b);
+    if (!V) {
+      return nullptr;
+    }
+    IRBuilder<>& irb = b.irbuilder();
+    V = b.convert(V, VarType::REAL);
+    Value* scaleV = ConstantFP::get(V->getType(), scale);
+    if (scale != 1) {
+      V = irb.CreateFMul(V, scaleV, "math.scaled");
+    }
+    V = irb.CreateCall(Intrinsic::getDeclaration(&b.module(), math->intrinsic, V->getType()), V, "math");
+    if (scale != 1) {
+      V = irb.CreateFDiv(V, scaleV, "math.unscaled");
+    }
+    return V;
+  }
+
+  string name = this->_name;
   
-  if (Builtin::getList().count(name)) {
-    name = Builtin::getList()[name]->signature()->name();
+  string builtin = this->builtinName();
+  if (!builtin.empty()) {
+    name = Builtin::getList()[builtin]->signature()->name();
   }
   // Look up the name in the global module table.
   Function *CalleeF = b.module().getFunction(name);
@@ -1050,16 +2958,230 @@ Value* CallAST::Codegen(Builder& b)
 
   std::vector<Value*> ArgsV;
 
+  // Les arguments entiers ou réels sont convertis au type des paramètres
+  auto param = CalleeF->arg_begin();
   auto it = this->_args.begin();
   auto endIT = this->_args.end();
-  for (; it != endIT; ++it) {
-    ArgsV.push_back((*it)->Codegen(b));
-    if (!ArgsV.back()) {
+  for (; it != endIT; ++it, ++param) {
+    Value* V = (*it)->Codegen(b);
+    if (!V) {
       return nullptr;
     }
+    ArgsV.push_back(b.convert(V, param->getType()));
+  }
+
+  // Compilation en arrière-plan ou remplacement à chaud : appel via le slot de la méthode
+  Value* result;
+  if (Value* method = b.loadMethod(name, CalleeF)) {
+    result = b.irbuilder().CreateCall(method, ArgsV, "call." + name);
+  } else {
+    result = b.irbuilder().CreateCall(CalleeF, ArgsV, "call." + name);
+  }
+  // Méthode réelle dont le type n'était pas connu lors de l'analyse de l'appel
+  return b.convert(result, this->getType());
+}
+
+bool CallAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  const string& name = this->_name;
+  unsigned argsNumber;
+  Builtin* builtin = nullptr;
+  FunctionSignature* signature;
+  int method = -1;
+
+  if (const MathFunction* math = mathFunction(name)) {
+    double scale = 1;
+    if (this->_args.size() != 1 && !(math->places && this->_args.size() == 2 && mathScale(this->_args[1], scale))) {
+      stringstream ss;
+      ss  << endl << "Build Error: Incorrect args passed to \"" << name << "\": "
+          << "a real" << (math->places ? " and a constant number of places" : "") << " expected";
+      return AST::Error<bool>(ss.str());
+    }
+    if (!this->_args[0]->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_args[0]->getType(), VarType::REAL);
+    if (scale != 1) {
+      bb.emitReal(scale);
+      bb.emit(OpCode::MULR);
+    }
+    bb.emit(OpCode::MATH, 0, reinterpret_cast<void*>(math->function));
+    if (scale != 1) {
+      bb.emitReal(scale);
+      bb.emit(OpCode::DIVR);
+    }
+    return true;
+  }
+
+  if (!this->builtinName().empty()) {
+    builtin = Builtin::getList()[this->builtinName()];
+    signature = builtin->signature();
+  } else {
+    method = bb.method(name);
+    if (method < 0) {
+      stringstream ss;
+      ss  << endl << "Build Error: Unknown function \"" << name << "\"";
+      return AST::Error<bool>(ss.str());
+    }
+    signature = bb.signature(method);
+  }
+  argsNumber = signature->argsNumber();
+
+  // If argument mismatch error.
+  if (argsNumber != this->_args.size()) {
+    stringstream ss;
+    ss  << endl << "Build Error: Incorrect args number passed to \"" << name << "\": "
+        << argsNumber << " expected, " << this->_args.size() << " passed";
+    return AST::Error<bool>(ss.str());
+  }
+
+  vector<VarType> argsType = signature->argsType();
+  for (unsigned i = 0; i < argsNumber; ++i) {
+    if (!this->_args[i]->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_args[i]->getType(), argsType[i]);
+  }
+
+  if (builtin && argsNumber == 1 && argsType[0] == VarType::REAL) {
+    bb.emit(OpCode::BUILTINR, 1, builtin->getPtr());
+  } else if (builtin && argsNumber == 1 && argsType[0] == VarType::LONG) {
+    bb.emit(OpCode::BUILTINL, 1, builtin->getPtr());
+  } else if (builtin && argsNumber == 2 && argsType[1] == VarType::REAL) {
+    bb.emit(OpCode::BUILTINIR, 2, builtin->getPtr());
+  } else if (builtin && argsNumber == 1 && signature->returnType() == VarType::REAL) {
+    bb.emit(OpCode::RBUILTIN, 1, builtin->getPtr());
+  } else if (builtin) {
+    bb.emit(OpCode::BUILTIN, argsNumber, builtin->getPtr());
+  } else {
+    bb.emit(OpCode::CALL, method);
   }
+  bb.emitConvert(signature->returnType(), this->getType());
+  return true;
+}
+
+/**
+ * MemberCallAST
+ */
+MemberCallAST::MemberCallAST(ExprAST* object, const std::string& name, const std::vector<ExprAST*>& args)
+  : _object(object), _name(name), _args(args)
+{}
+MemberCallAST::~MemberCallAST()
+{
+  delete this->_object;
+  for (auto& arg : this->_args) {
+    delete arg;
+  }
+}
+
+void MemberCallAST::_taggingPass(
+              std::map<int, VarType>& argVars,
+              std::map<std::string, VarType>& localVars,
+              std::map<std::string, VarType>& globaleVars,
+              std::map<std::string, VarType>& persistentVars,
+              const std::map<std::string, VarType>& returnTypes,
+              std::map<std::string, VarType>& propertyTypes
+            )
+{
+  this->_object->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  if (this->_object->getType() == VarType::NOTDEFINE && this->_object->isVar()) {
+    this->_object->setType(VarType::OBJECT);
+    this->_object->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  for (auto& arg : this->_args) {
+    arg->taggingPass(argVars, localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+  }
+  this->setType(VarType::OBJECT);
+}
+
+bool MemberCallAST::checkArgs() const
+{
+  if ((this->_name == "push" && this->_args.size() == 1) || (this->_name == "insert" && this->_args.size() == 2)) {
+    return true;
+  }
+  stringstream ss;
+  ss  << endl << "Build Error: Unknown collection method \"" << this->_name << "\" with "
+      << this->_args.size() << " argument(s)";
+  AST::Error<bool>(ss.str());
+  return false;
+}
+
+void MemberCallAST::_effects(CodeEffects& e) const
+{
+  this->_object->effects(e);
+  for (auto& arg : this->_args) {
+    arg->effects(e);
+  }
+  e.writesGlobals = true;
+}
 
-  return b.irbuilder().CreateCall(CalleeF, ArgsV, "call." + name);
+string MemberCallAST::_toString(const string& firstPrefix, const string& prefix) const
+{
+  string nextFirstPrefix, nextPrefix;
+  nextFirstPrefix = prefix + PREFIX_BEGIN;
+  nextPrefix = prefix + PREFIX_MIDDLE;
+  stringstream ss;
+  ss << firstPrefix << "Expression::MemberCall " << this->_name << endl
+     << this->_object->toString(nextFirstPrefix, nextPrefix);
+  int length = this->_args.size();
+  for (int i = 0; i < length ; ++i) {
+    if (i + 1 == length) {
+      nextPrefix = prefix + PREFIX_END;
+    }
+    ss << this->_args[i]->toString(nextFirstPrefix, nextPrefix);
+  }
+  return ss.str();
 }
 
+// push(valeur) insère à la fin : l'index est ramené à la taille de la
+// collection. La collection renvoyée porte la référence de celle lue.
+Value* MemberCallAST::Codegen(Builder& b)
+{
+  if (!this->checkArgs()) {
+    return nullptr;
+  }
+  Value* collection = this->_object->Codegen(b);
+  if (!collection) {
+    return nullptr;
+  }
+  collection = b.convert(collection, VarType::OBJECT);
+  Value* index = b.irbuilder().getInt32(INT32_MAX);
+  if (this->_name == "insert") {
+    index = this->_args[0]->Codegen(b);
+    if (!index) {
+      return nullptr;
+    }
+    index = b.convert(index, VarType::INT);
+  }
+  ExprAST* valueAST = this->_args.back();
+  Value* value = valueAST->Codegen(b);
+  if (!value) {
+    return nullptr;
+  }
+  VarType vtype = valueAST->getType();
+  Value* args[] = {collection, index, b.irbuilder().getInt32(valueKind(vtype)), valueBits(b, value, vtype)};
+  return b.callBuiltin("collection.insert", args, "collection");
+}
 
+bool MemberCallAST::Bytecodegen(BytecodeBuilder& bb)
+{
+  if (!this->checkArgs()) {
+    return false;
+  }
+  // SETV : la valeur, puis la collection et l'index
+  ExprAST* valueAST = this->_args.back();
+  if (!valueAST->Bytecodegen(bb) || !this->_object->Bytecodegen(bb)) {
+    return false;
+  }
+  bb.emitConvert(this->_object->getType(), VarType::OBJECT);
+  if (this->_name == "insert") {
+    if (!this->_args[0]->Bytecodegen(bb)) {
+      return false;
+    }
+    bb.emitConvert(this->_args[0]->getType(), VarType::INT);
+  } else {
+    bb.emit(OpCode::PUSH, INT32_MAX);
+  }
+  bb.emit(OpCode::SETV, valueKind(valueAST->getType()), Builtin::getList()["collection.insert"]->getPtr());
+  return true;
+}
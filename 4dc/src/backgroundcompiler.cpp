@@ -0,0 +1,106 @@
+#include "../include/backgroundcompiler.h"
+#include "../include/compileerror.h"
+#include "../include/util/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+
+using namespace std;
+
+BackgroundCompiler* BackgroundCompiler::_current = nullptr;
+
+BackgroundCompiler::BackgroundCompiler(const vector<intptr_t*>& slots, Compiler compiler)
+  : _slots(slots), _compiler(compiler), _compiled(slots.size(), false), _failed(slots.size(), false), _stop(false)
+{
+  assert(_current == nullptr);
+  _current = this;
+}
+
+BackgroundCompiler::~BackgroundCompiler()
+{
+  // La compilation en cours se termine, les méthodes restantes sont abandonnées
+  {
+    lock_guard<mutex> lock(this->_mutex);
+    this->_stop = true;
+  }
+  if (this->_thread.joinable()) {
+    this->_thread.join();
+  }
+  _current = nullptr;
+}
+
+void BackgroundCompiler::install(unsigned method, void* code)
+{
+  assert(method < this->_slots.size());
+  lock_guard<mutex> lock(this->_mutex);
+  // Sans code, le slot garde son stub : la méthode n'a pas pu être compilée
+  if (code) {
+    // Le code natif lit le slot avec un chargement atomique (acquire)
+    reinterpret_cast<atomic<intptr_t>*>(this->_slots[method])
+        ->store(reinterpret_cast<intptr_t>(code), memory_order_release);
+  } else {
+    this->_failed[method] = true;
+  }
+  this->_compiled[method] = true;
+  this->_installed.notify_all();
+}
+
+void BackgroundCompiler::start()
+{
+  for (unsigned i = 0; i < this->_compiled.size(); ++i) {
+    if (!this->_compiled[i]) {
+      this->_queue.push_back(i);
+    }
+  }
+  this->_thread = thread(&BackgroundCompiler::run, this);
+}
+
+unsigned BackgroundCompiler::compiled()
+{
+  lock_guard<mutex> lock(this->_mutex);
+  return count(this->_compiled.begin(), this->_compiled.end(), true)
+       - count(this->_failed.begin(), this->_failed.end(), true);
+}
+
+int32_t BackgroundCompiler::wait(int32_t method)
+{
+  BackgroundCompiler* bc = _current;
+  assert(bc != nullptr);
+  unique_lock<mutex> lock(bc->_mutex);
+  if (!bc->_compiled[method]) {
+    // La méthode attendue passe devant les autres
+    auto it = find(bc->_queue.begin(), bc->_queue.end(), static_cast<unsigned>(method));
+    if (it != bc->_queue.end()) {
+      bc->_queue.erase(it);
+      bc->_queue.push_front(method);
+    }
+    Logger::debug << "Attente de la compilation de la methode " << method << endl;
+    bc->_installed.wait(lock, [bc, method] {return bc->_compiled[method];});
+  }
+  // L'erreur de compilation a été affichée par le thread de fond
+  if (bc->_failed[method]) {
+    Logger::error << "Runtime Error: La methode " << method << " appelee n'a pas pu etre compilee" << endl;
+    exit(EXIT_FAILURE);
+  }
+  return 0;
+}
+
+void BackgroundCompiler::run()
+{
+  unique_lock<mutex> lock(this->_mutex);
+  while (!this->_stop && !this->_queue.empty()) {
+    unsigned method = this->_queue.front();
+    this->_queue.pop_front();
+    lock.unlock();
+    // Une erreur tardive ne concerne que les appels de cette méthode
+    void* code = nullptr;
+    try {
+      code = this->_compiler(method);
+    } catch (const CompileError& e) {
+      Logger::error << e.what() << endl;
+    }
+    this->install(method, code);
+    lock.lock();
+  }
+}
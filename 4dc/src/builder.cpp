@@ -5,18 +5,72 @@
 #include "../include/functionsignature.h"
 #include "../include/util/logger.h"
 #include "../include/builtins.h"
+#include "../include/runtime.h"
+#include "../include/objectcache.h"
+#include "../include/interpreter.h"
+#include "../include/backgroundcompiler.h"
+#include "../include/compileerror.h"
+#include "../include/options.h"
+#include "../include/util/util.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace llvm;
 
+namespace {
+  // Trace les fonctions compilées en code natif par le JIT : en compilation
+  // paresseuse, seules les méthodes réellement appelées le sont.
+  class CompilationListener : public JITEventListener
+  {
+    public:
+      CompilationListener() : _count(0) {}
+      virtual void NotifyFunctionEmitted(const Function& F, void*, size_t size,
+                                         const EmittedFunctionDetails&)
+      {
+        ++this->_count;
+        Logger::debug << "JIT : fonction " << F.getName().str() << " compilee ("
+                      << size << " octets)" << endl;
+      }
+      inline unsigned count() const {return this->_count;}
+    private:
+      unsigned _count;
+  };
+
+  // Temps écoulé depuis since, en millisecondes
+  double elapsedMs(chrono::steady_clock::time_point since)
+  {
+    auto elapsed = chrono::steady_clock::now() - since;
+    return chrono::duration_cast<chrono::microseconds>(elapsed).count() / 1000.;
+  }
+}
+
 Builder::Builder()
   : Builder("Builder")
 {}
 Builder::Builder(const string& name)
-  : _mod(new Module(name, getGlobalContext())),
-    _irb(getGlobalContext()), _ctx(_mod->getContext()),
+  : Builder(name, getGlobalContext())
+{}
+Builder::Builder(const string& name, LLVMContext& ctx)
+  : _mod(new Module(name, ctx)),
+    _irb(ctx), _ctx(_mod->getContext()),
     _currentBlock(nullptr),
-    _jit(nullptr), _optimizer(nullptr)
+    _jit(nullptr), _optimizer(nullptr), _moduleOptimizer(nullptr),
+    _optLevel(2), _sizeLevel(0), _fastMath(false),
+    _inlineThreshold(0), _targetCPU("native"), _targetMachine(nullptr),
+    _lazy(true), _jitListener(nullptr), _objectCache(nullptr),
+    _arrays(nullptr), _arrayCount(nullptr),
+    _objects(nullptr), _objectCount(nullptr), _propertyCacheType(nullptr)
 {}
 
 Builder::~Builder()
@@ -27,18 +81,101 @@ Builder::~Builder()
     delete this->_jit;
   } else {
     delete this->_mod;
+    if (this->_targetMachine) {
+      delete this->_targetMachine;
+    }
+  }
+  if (this->_jitListener) {
+    delete this->_jitListener;
+  }
+  if (this->_objectCache) {
+    delete this->_objectCache;
   }
   if (this->_optimizer) {
     delete this->_optimizer;
   }
+  if (this->_moduleOptimizer) {
+    delete this->_moduleOptimizer;
+  }
 }
 
-void Builder::buildAll(const vector<pair<string,File>>& files)
+/*
+ * Builder prêt à construire un programme avec ces options : JIT (ou machine
+ * cible en compilation à l'avance), optimiseurs et builtins déclarés.
+ */
+Builder* Builder::prepare(const Options& options)
 {
+  bool aot = options.emitKind() != EmitKind::NONE;
+  bool tiered = options.tiered() && !aot;
+  bool background = options.background() && !aot && !tiered;
+  
+  unique_ptr<Builder> builder(new Builder());
+  builder->setOptLevel(options.optLevel(), options.sizeLevel());
+  builder->setTarget(options.targetCPU(), options.targetFeatures());
+  builder->setFastMath(options.fastMath());
+  // Le thread de compilation compile chaque méthode chaude avec ses appelées :
+  // le code natif ne doit jamais rappeler le JIT depuis le thread d'exécution.
+  // Idem en compilation en arrière-plan : les méthodes sont compilées une à une.
+  builder->setLazyCompilation(options.lazyCompilation() && !tiered && !background);
+  if (!options.cacheDirectory().empty()) {
+    if (tiered || background) {
+      Logger::warning << "Warning: --cache est ignore avec --tiered et --background" << endl;
+    } else {
+      builder->setObjectCache(options.cacheDirectory());
+    }
+  }
+  if (aot) {
+    builder->createTargetMachine();
+  } else {
+    builder->createJIT();
+  }
+  builder->setOptimizer(builder->getStandardOptimizer());
+  builder->setModuleOptimizer(builder->getStandardModuleOptimizer(options.inlineThreshold()));
+  builder->_inlineThreshold = options.inlineThreshold();
+  
+  // Déclaration de toutes les BUILTINs existants
+  Logger::debug << "Declaration des BUILTINs" << endl;
+  builder->declareBuiltins();
+  Logger::debug << "Fin de la declaration des BUILTINs" << endl << endl;
+  return builder.release();
+}
+
+/*
+ * Un Builder préparé, encore vierge, peut construire le programme si son JIT,
+ * sa cible et ses optimiseurs sont ceux que demandent les options ; seule la
+ * compilation paresseuse se règle encore après la création du JIT.
+ */
+bool Builder::accepts(const Options& options) const
+{
+  return this->_jit && !this->_objectCache
+      && options.emitKind() == EmitKind::NONE && options.cacheDirectory().empty()
+      && options.optLevel() == this->_optLevel && options.sizeLevel() == this->_sizeLevel
+      && options.fastMath() == this->_fastMath
+      && options.targetCPU() == this->_targetCPU && options.targetFeatures() == this->_targetFeatures
+      && options.inlineThreshold() == this->_inlineThreshold;
+}
+
+/*
+ * Construit et exécute (ou émet) le programme. prepared, s'il accepte les
+ * options, est utilisé au lieu d'un nouveau Builder : le serveur de
+ * compilation le prépare avant de créer le processus de chaque requête.
+ */
+void Builder::buildAll(const vector<pair<string,File>>& files, const Options& options, Builder* prepared)
+{
+  auto start = chrono::steady_clock::now();
+  bool aot = options.emitKind() != EmitKind::NONE;
+  bool tiered = options.tiered() && !aot;
+  bool background = options.background() && !aot && !tiered;
+  
   // Création de l'objet Builder qui va permettre de construire le programme
-  Builder builder;
-  builder.createJIT();
-  builder.setOptimizer(builder.getStandardOptimizer());
+  unique_ptr<Builder> owned;
+  if (prepared && prepared->accepts(options)) {
+    prepared->setLazyCompilation(options.lazyCompilation() && !tiered && !background);
+  } else {
+    owned.reset(prepare(options));
+    prepared = owned.get();
+  }
+  Builder& builder = *prepared;
   
   // listes des variables globales et persistantes
   map<string, VarType> globalVars;
@@ -63,19 +200,14 @@ void Builder::buildAll(const vector<pair<string,File>>& files)
     } else {
       ifstream in(file->filename());
       if (!in) {
-        Logger::error << "Cannot read file \"" << file->filename() << "\"" << endl;
-        exit(EXIT_FAILURE);
+        throw CompileError("Cannot read file \"" + file->filename() + "\"");
       }
       Logger::debug << "\"" << file->filename() << "\":" << endl;
       functionsDef[i] = builder.parse(globalVars, persistentVars, *name, in);
     }
     Logger::debug << *functionsDef[i];
   }
-  
-  // Déclaration de toutes les BUILTINs existants
-  Logger::debug << "Declaration des BUILTINs" << endl;
-  builder.declareBuiltins();
-  Logger::debug << "Fin de la declaration des BUILTINs" << endl << endl;
+  builder.taggingPass(functionsDef, globalVars, persistentVars);
   
   Logger::debug << "Declaration des variables globales" << endl
                 << "  globales     : ";
@@ -87,13 +219,39 @@ void Builder::buildAll(const vector<pair<string,File>>& files)
   
   Logger::debug << endl << "Fin de la declaration des variables globales" << endl << endl;
   
-  for (unsigned int i = 0; i < files.size(); ++i) {
-    functions[i] = builder.build(functionsDef[i]);
+  if (tiered) {
+    Logger::info << "Temps de compilation : " << elapsedMs(start) << " ms (bytecode)" << endl;
+    builder.runTiered(functionsDef, options.tierThreshold());
+    for (auto& Fdef : functionsDef) {
+      delete Fdef;
+    }
+    return;
+  }
+  if (background) {
+    builder.runBackground(functionsDef);
+    for (auto& Fdef : functionsDef) {
+      delete Fdef;
+    }
+    return;
+  }
+  
+  if (options.jobs() > 1 && files.size() > 1) {
+    functions = builder.buildParallel(functionsDef, globalVars, persistentVars, options.jobs());
+  } else {
+    for (unsigned int i = 0; i < files.size(); ++i) {
+      functions[i] = builder.build(functionsDef[i]);
+    }
   }
   Function* main = builder.createMain(functionsDef.back()->signature(), functions.back());
   
   Logger::debug << endl << "Toutes les fonctions ont ete compilees avec succes !" << endl << endl;
   
+  // Optimisations inter-fonctions, une fois toutes les fonctions construites
+  Logger::debug << "Optimisation du module... ";
+  // En compilation à l'avance, les méthodes restent visibles depuis l'extérieur
+  builder.optimizeModule(functions, !aot);
+  Logger::debug << "OK" << endl << endl;
+  
   for (unsigned int i = 0; i < files.size(); ++i) {
     delete functionsDef[i];
   }
@@ -102,10 +260,38 @@ void Builder::buildAll(const vector<pair<string,File>>& files)
   
   cout << endl;
   
+  Logger::info << "Temps de compilation : " << elapsedMs(start) << " ms"
+               << " (-O" << options.optLevelName()
+               << ", seuil d'inlining : " << options.inlineThreshold() << ")" << endl;
+  
+  if (aot) {
+    string output = options.output(files.back().first);
+    builder.emit(options.emitKind(), output, options.runtimeLibrary());
+    Logger::info << "Fichier genere : " << output << endl;
+    return;
+  }
   builder.callFunctionLLVM(main);
 }
 
 
+/*
+ * Initialise les cibles et prépare un Builder pour les options par défaut :
+ * JIT, optimiseurs et builtins. Un processus créé ensuite par fork() (serveur
+ * de compilation) en hérite une copie, qu'il utilise une seule fois ; le JIT
+ * de LLVM 3.5 ne crée aucun thread, ses objets restent valides dans le fils.
+ */
+Builder* Builder::warmUp()
+{
+  auto start = chrono::steady_clock::now();
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  InitializeNativeTargetAsmParser();
+  Builder* builder = prepare(Options());
+  Logger::debug << "Compilateur initialise en " << elapsedMs(start) << " ms" << endl;
+  return builder;
+}
+
+
 Func* Builder::parse(
     map<string, VarType>& globalVars,
     map<string, VarType>& persistentVars,
@@ -125,7 +311,7 @@ Func* Builder::parse(
   BlocAST* ast = parser.parse();
   
   if (!ast) {
-    exit(EXIT_FAILURE);
+    throw CompileError("Parser Error (" + Util::toS(parser.errorLine()) + "): Couldn't parse function \"" + name + "\"");
   }
   
   if (&in == &cin) {
@@ -137,15 +323,40 @@ Func* Builder::parse(
   
   Func* Fdef = new Func(name, ast);
   if (Fdef) {
-    Fdef->taggingPass(globalVars, persistentVars);
+    Fdef->taggingPass(globalVars, persistentVars, this->_returnTypes, this->_propertyTypes);
+    this->_returnTypes[Fdef->name()] = Fdef->signature()->returnType();
   } else {
-    Logger::error << "Error: Couldn't parse function \"" << name << "\"" << endl;
-    exit(EXIT_FAILURE);
+    throw CompileError("Error: Couldn't parse function \"" + name + "\"");
   }
   Logger::debug << "Fin du parse" << endl << endl;
   return Fdef;
 }
 
+/*
+ * Seconde passe de tag, une fois toutes les méthodes analysées : un appel
+ * analysé avant la méthode appelée n'avait pas encore de type. Répétée tant
+ * que le type du résultat d'une méthode change.
+ */
+void Builder::taggingPass(
+    const vector<Func*>& methods,
+    map<string, VarType>& globalVars,
+    map<string, VarType>& persistentVars
+)
+{
+  bool changed = true;
+  for (int passes = 0; changed && passes < 8; ++passes) {
+    changed = false;
+    for (Func* Fdef : methods) {
+      Fdef->taggingPass(globalVars, persistentVars, this->_returnTypes, this->_propertyTypes);
+      VarType& returnType = this->_returnTypes[Fdef->name()];
+      if (returnType != Fdef->signature()->returnType()) {
+        returnType = Fdef->signature()->returnType();
+        changed = true;
+      }
+    }
+  }
+}
+
 llvm::Function* Builder::build(Func* Fdef)
 {
   assert(Fdef != nullptr);
@@ -154,25 +365,327 @@ llvm::Function* Builder::build(Func* Fdef)
     Logger::debug << endl << "Dump: ";
     dumpDebug(F);
   } else {
-    Logger::error << "Build Error: Couldn't build function \"" << Fdef->name() << "\"" << endl;
-    exit(EXIT_FAILURE);
+    throw CompileError("Build Error: Couldn't build function \"" + Fdef->name() + "\"");
   }
   return F;
 }
 
+/*
+ * Compilation des méthodes sur plusieurs threads. Chaque thread a son propre
+ * LLVMContext et son propre module, dans lequel sont déclarés les builtins,
+ * les variables globales et toutes les méthodes : il peut donc construire et
+ * optimiser ses méthodes indépendamment des autres. Les modules sont ensuite
+ * transférés en bitcode vers le contexte principal et liés au module.
+ */
+vector<Function*> Builder::buildParallel(
+    const vector<Func*>& methods,
+    const map<string, VarType>& globalVars,
+    const map<string, VarType>& persistentVars,
+    unsigned jobs
+)
+{
+  if (jobs > methods.size()) {
+    jobs = methods.size();
+  }
+  Logger::debug << "Compilation de " << methods.size() << " fonctions sur " << jobs << " threads" << endl;
+  
+  string dataLayout;
+  if (this->dataLayout()) {
+    dataLayout = this->dataLayout()->getStringRepresentation();
+  }
+  string triple = this->_mod->getTargetTriple();
+  
+  vector<string> bitcodes(jobs);
+  vector<exception_ptr> errors(jobs);
+  vector<thread> workers;
+  for (unsigned j = 0; j < jobs; ++j) {
+    workers.emplace_back([&, j] {
+      try {
+        LLVMContext ctx;
+        Builder shard("Shard" + Util::toS(j), ctx);
+        shard.module().setDataLayout(dataLayout);
+        shard.module().setTargetTriple(triple);
+        shard.setOptLevel(this->_optLevel, this->_sizeLevel);
+        shard.setFastMath(this->_fastMath);
+        shard.setOptimizer(shard.getStandardOptimizer());
+      
+        // Déclarations seulement : les définitions sont dans le module principal
+        shard.declareBuiltins();
+        map<string, VarType> shardGlobalVars = globalVars;
+        map<string, VarType> shardPersistentVars = persistentVars;
+        shard.createGlobals(shardGlobalVars, shard.globalVars(), false);
+        shard.createGlobals(shardPersistentVars, shard.persistentVars(), false);
+        for (auto& Fdef : methods) {
+          Func::create(Fdef->signature(), shard);
+        }
+      
+        for (unsigned i = j; i < methods.size(); i += jobs) {
+          shard.build(methods[i]);
+        }
+      
+        raw_string_ostream out(bitcodes[j]);
+        WriteBitcodeToFile(&shard.module(), out);
+        out.flush();
+      } catch (...) {
+        // Relancée par le thread principal
+        errors[j] = current_exception();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (auto& error : errors) {
+    if (error) {
+      rethrow_exception(error);
+    }
+  }
+  
+  // Le contexte principal n'est utilisé que par ce thread
+  for (unsigned j = 0; j < jobs; ++j) {
+    unique_ptr<MemoryBuffer> buffer(MemoryBuffer::getMemBuffer(bitcodes[j], "Shard" + Util::toS(j), false));
+    ErrorOr<Module*> shard = parseBitcodeFile(buffer.get(), this->context());
+    if (!shard) {
+      throw CompileError("Build Error: " + shard.getError().message());
+    }
+    string err;
+    if (Linker::LinkModules(this->_mod, shard.get(), Linker::DestroySource, &err)) {
+      delete shard.get();
+      throw CompileError("Build Error: " + err);
+    }
+    delete shard.get();
+  }
+  
+  vector<Function*> functions(methods.size());
+  for (unsigned i = 0; i < methods.size(); ++i) {
+    functions[i] = this->_mod->getFunction(methods[i]->name());
+    assert(functions[i] != nullptr);
+  }
+  return functions;
+}
+
 void Builder::callFunctionLLVM(Function* F)
 {
   assert(F != nullptr);
   if (F && this->_jit) {
     Logger::info << "Execution :" << endl;
+    auto start = chrono::steady_clock::now();
+    if (this->_objectCache) {
+      // MCJIT : génère (ou charge depuis le cache) le code de tout le module
+      this->_jit->finalizeObject();
+    }
     void* fptr = this->_jit->getPointerToFunction(F);
+    double jitTime = elapsedMs(start);
 
     // cast to native function
     int (*f)() = (int (*)())(intptr_t)fptr;
-    Logger::info << "=> " << f() << endl;
+    start = chrono::steady_clock::now();
+    int result = f();
+    double runTime = elapsedMs(start);
+    Logger::info << "=> " << result << endl;
+    Logger::info << "Temps de generation du code natif : " << jitTime << " ms" << endl
+                 << "Temps d'execution : " << runTime << " ms" << endl;
+    if (this->_objectCache) {
+      Logger::info << "Cache du code machine : " << this->_objectCache->hits() << " module(s) charge(s), "
+                   << this->_objectCache->misses() << " module(s) genere(s)" << endl;
+    }
+    if (this->_jitListener) {
+      Logger::debug << "Fonctions compilees par le JIT : "
+                    << static_cast<CompilationListener*>(this->_jitListener)->count() << endl;
+    }
   }
 }
 
+void Builder::runTiered(const vector<Func*>& methods, unsigned threshold)
+{
+  assert(!methods.empty());
+  FunctionSignature* signature = methods.back()->signature();
+  if (signature->argsNumber() != 0) {
+    stringstream ss;
+    ss << "Build Error: " << *signature << " must take 0 argument";
+    throw CompileError(ss.str());
+  }
+  
+  // Toutes les méthodes sont déclarées : le thread de compilation peut ensuite
+  // construire n'importe laquelle d'entre elles, dans n'importe quel ordre.
+  for (auto& Fdef : methods) {
+    Func::create(Fdef->signature(), *this);
+  }
+  
+  // L'interpréteur et le code natif partagent les mêmes variables
+  map<string, int32_t*> globalVars, persistentVars;
+  for (auto& var : this->_globalVars) {
+    globalVars[var.first] = static_cast<int32_t*>(this->_jit->getPointerToGlobal(var.second));
+  }
+  for (auto& var : this->_persistentVars) {
+    persistentVars[var.first] = static_cast<int32_t*>(this->_jit->getPointerToGlobal(var.second));
+  }
+  
+  // Appelé depuis le thread de compilation, seul à utiliser le Builder et le JIT
+  // une fois l'exécution commencée.
+  auto compiler = [this, &methods](const vector<unsigned>& indexes, vector<void*>& code) {
+    for (unsigned i : indexes) {
+      Function* F = this->module().getFunction(methods[i]->name());
+      if (!F || F->empty()) {
+        this->build(methods[i]);
+      }
+    }
+    for (unsigned i : indexes) {
+      Function* F = this->module().getFunction(methods[i]->name());
+      code.push_back(this->_jit->getPointerToFunction(F));
+    }
+  };
+  
+  Interpreter interpreter(threshold, compiler);
+  if (!interpreter.load(methods, globalVars, persistentVars)) {
+    throw CompileError("Build Error: Couldn't generate bytecode");
+  }
+  
+  Logger::info << "Execution :" << endl;
+  auto start = chrono::steady_clock::now();
+  int64_t value = interpreter.call(methods.size() - 1);
+  // Comme la fonction main du JIT : un résultat réel ou 64 bits est tronqué
+  int result = static_cast<int32_t>(value);
+  if (signature->returnType() == VarType::REAL) {
+    double real;
+    memcpy(&real, &value, sizeof(real));
+    result = static_cast<int32_t>(real);
+  }
+  double runTime = elapsedMs(start);
+  Logger::info << "=> " << result << endl;
+  Logger::info << "Temps d'execution : " << runTime << " ms" << endl
+               << "Methodes compilees en code natif : " << interpreter.nativeMethods()
+               << "/" << interpreter.methods() << endl;
+}
+
+/*
+ * Compilation en arrière-plan : seules la méthode d'entrée et les méthodes
+ * qu'elle appelle directement sont compilées avant le début de l'exécution.
+ * Les autres le sont par un thread de fond pendant l'exécution, et installées
+ * dans leur slot dès qu'elles sont prêtes.
+ */
+void Builder::runBackground(const vector<Func*>& methods)
+{
+  assert(!methods.empty());
+  auto start = chrono::steady_clock::now();
+  
+  // Déclaration des méthodes et de leurs slots
+  Type* slotType = this->dataLayout()->getIntPtrType(this->context());
+  vector<Function*> functions;
+  for (auto& Fdef : methods) {
+    functions.push_back(Func::create(Fdef->signature(), *this));
+    this->_methodSlots[Fdef->name()] = new GlobalVariable(
+        this->module(), slotType, false, GlobalValue::InternalLinkage,
+        ConstantInt::get(slotType, 0), Fdef->name() + ".slot"
+    );
+  }
+  
+  // Les stubs attendent la compilation de leur méthode
+  Type* intType = Type::getInt32Ty(this->context());
+  Function* wait = Function::Create(
+      FunctionType::get(intType, vector<Type*>{intType}, false),
+      Function::ExternalLinkage, "4dc.wait", &this->module()
+  );
+  this->_jit->addGlobalMapping(wait, (void*) &BackgroundCompiler::wait);
+  
+  vector<intptr_t*> slots;
+  for (unsigned i = 0; i < methods.size(); ++i) {
+    Function* stub = this->createStub(functions[i], i, wait);
+    intptr_t* slot = static_cast<intptr_t*>(this->_jit->getPointerToGlobal(this->_methodSlots[methods[i]->name()]));
+    *slot = reinterpret_cast<intptr_t>(this->_jit->getPointerToFunction(stub));
+    slots.push_back(slot);
+  }
+  
+  // Une fois l'exécution commencée, seul le thread de fond utilise le Builder et le JIT
+  auto compile = [this, &methods](unsigned i) -> void* {
+    Function* F = this->module().getFunction(methods[i]->name());
+    if (F->empty()) {
+      this->build(methods[i]);
+    }
+    return this->_jit->getPointerToFunction(F);
+  };
+  BackgroundCompiler compiler(slots, compile);
+  
+  // Méthode d'entrée et ses appelées directes
+  unsigned entry = methods.size() - 1;
+  compiler.install(entry, compile(entry));
+  for (unsigned callee : this->calledMethods(functions[entry], methods)) {
+    compiler.install(callee, compile(callee));
+  }
+  Function* main = this->createMain(methods[entry]->signature(), functions[entry]);
+  int (*f)() = (int (*)())(intptr_t) this->_jit->getPointerToFunction(main);
+  
+  Logger::info << "Temps avant execution : " << elapsedMs(start) << " ms ("
+               << compiler.compiled() << "/" << methods.size() << " methodes compilees)" << endl;
+  compiler.start();
+  
+  Logger::info << "Execution :" << endl;
+  start = chrono::steady_clock::now();
+  int result = f();
+  double runTime = elapsedMs(start);
+  Logger::info << "=> " << result << endl;
+  Logger::info << "Temps d'execution : " << runTime << " ms" << endl
+               << "Methodes compilees a la fin de l'execution : " << compiler.compiled()
+               << "/" << methods.size() << endl;
+}
+
+Value* Builder::loadMethod(const string& name, Function* F)
+{
+  auto it = this->_methodSlots.find(name);
+  if (it == this->_methodSlots.end()) {
+    return nullptr;
+  }
+  // Appel récursif : direct, pour que l'élimination des appels terminaux le
+  // reconnaisse. Une exécution en cours garde sa version de la méthode.
+  BasicBlock* block = this->irbuilder().GetInsertBlock();
+  if (block && block->getParent() == F) {
+    return nullptr;
+  }
+  // Le slot peut être modifié par le thread de compilation à tout moment
+  LoadInst* ptr = this->irbuilder().CreateLoad(it->second, "slot." + name);
+  ptr->setAlignment(this->dataLayout()->getPointerSize());
+  ptr->setAtomic(Acquire);
+  return this->irbuilder().CreateIntToPtr(ptr, F->getType(), "method." + name);
+}
+
+Function* Builder::createStub(Function* F, unsigned index, Function* wait)
+{
+  Function* stub = Function::Create(F->getFunctionType(), Function::InternalLinkage,
+                                    F->getName() + ".stub", &this->module());
+  BasicBlock* block = BasicBlock::Create(this->context(), "stub.entry", stub);
+  this->irbuilder().SetInsertPoint(block);
+  this->currentBlock() = block;
+  
+  this->irbuilder().CreateCall(wait, ConstantInt::get(Type::getInt32Ty(this->context()), index));
+  vector<Value*> args;
+  for (auto& arg : stub->args()) {
+    args.push_back(&arg);
+  }
+  Value* method = this->loadMethod(F->getName().str(), F);
+  this->irbuilder().CreateRet(this->irbuilder().CreateCall(method, args));
+  verifyFunction(*stub);
+  return stub;
+}
+
+vector<unsigned> Builder::calledMethods(Function* F, const vector<Func*>& methods)
+{
+  // Les appels de méthodes sont des chargements de leur slot
+  vector<unsigned> callees;
+  for (auto& BB : *F) {
+    for (auto& I : BB) {
+      LoadInst* load = dyn_cast<LoadInst>(&I);
+      if (!load) continue;
+      for (unsigned i = 0; i < methods.size(); ++i) {
+        if (load->getPointerOperand() == this->_methodSlots[methods[i]->name()]
+            && find(callees.begin(), callees.end(), i) == callees.end()) {
+          callees.push_back(i);
+        }
+      }
+    }
+  }
+  return callees;
+}
+
 Function* Builder::createMain(FunctionSignature* signature, Function* F)
 {
   Logger::debug << "Creation de la fonction main" << endl;
@@ -180,8 +693,9 @@ Function* Builder::createMain(FunctionSignature* signature, Function* F)
   assert(F != nullptr);
   
   if (signature->argsNumber() != 0) {
-    Logger::error << "Build Error: " << *signature << " must take 0 argument" << endl;
-    exit(EXIT_FAILURE);
+    stringstream ss;
+    ss << "Build Error: " << *signature << " must take 0 argument";
+    throw CompileError(ss.str());
   }
   
   string name = module().getFunction("main") ? "/main" : "main";
@@ -200,6 +714,7 @@ Function* Builder::createMain(FunctionSignature* signature, Function* F)
   
   Value* retVal = irbuilder().CreateCall(F, std::vector<Value*>{}, "calltmp");
   assert(retVal != nullptr);
+  retVal = this->convert(retVal, VarType::INT);
   
   irbuilder().CreateRet(retVal);
   Logger::debug << "  Verification... ";
@@ -218,10 +733,196 @@ void Builder::createJIT()
   string err;
   EngineBuilder eb = EngineBuilder(this->_mod);
   eb.setErrorStr(&err);
-  auto jit = eb.create();
+  eb.setOptLevel(this->codeGenOptLevel());
+  
+  // Cible le processeur hôte (ou celui demandé) pour profiter d'AVX2, FMA, BMI...
+  string cpu;
+  vector<string> features;
+  this->resolveTarget(cpu, features);
+  eb.setMCPU(cpu);
+  eb.setMAttrs(features);
+  eb.setCodeModel(CodeModel::JITDefault);
+  eb.setTargetOptions(this->targetOptions());
+  Logger::debug << "Processeur cible : " << cpu << " " << Util::join(features, ",") << endl;
+  
+  // Le cache du code machine nécessite MCJIT, qui compile le module en entier :
+  // la compilation paresseuse ne s'applique plus.
+  if (this->_objectCache) {
+    eb.setUseMCJIT(true);
+    eb.setMCJITMemoryManager(new SectionMemoryManager());
+  }
+  
+  this->_targetMachine = eb.selectTarget();
+  if (!this->_targetMachine) {
+    throw CompileError("Critical Error: Cible non supportee : " + cpu);
+  }
+  // Le moteur JIT prend le contrôle de la TargetMachine
+  auto jit = eb.create(this->_targetMachine);
   this->_jit = jit;
   if (!jit) {
-    Logger::critical << "Critical Error: Impossible de creer le moteur JIT : " << err << endl;
+    delete this->_targetMachine;
+    this->_targetMachine = nullptr;
+    throw CompileError("Critical Error: Impossible de creer le moteur JIT : " + err);
+  }
+  
+  // En compilation paresseuse, chaque appel vers une méthode non encore
+  // compilée passe par un stub qui la compile lors de son premier appel.
+  jit->DisableLazyCompilation(!this->_lazy);
+  this->_jitListener = new CompilationListener();
+  jit->RegisterJITEventListener(this->_jitListener);
+  
+  if (this->_objectCache) {
+    jit->setObjectCache(this->_objectCache);
+  }
+}
+
+void Builder::setObjectCache(const string& directory)
+{
+  // L'empreinte d'un module inclut tout ce qui influe sur le code machine
+  // en plus de son IR : la cible, le niveau d'optimisation et les options de
+  // la cible (targetOptions : calcul flottant rapide). Appelée après
+  // setOptLevel, setTarget et setFastMath.
+  string cpu;
+  vector<string> features;
+  this->resolveTarget(cpu, features);
+  string target = sys::getProcessTriple() + " " + cpu + " " + Util::join(features, ",")
+                + " -O" + Util::toS(this->_optLevel) + "/" + Util::toS(this->_sizeLevel)
+                + (this->_fastMath ? " --fast-math" : "");
+  this->_objectCache = new DiskObjectCache(directory, target);
+}
+
+void Builder::createTargetMachine()
+{
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  InitializeNativeTargetAsmParser();
+  
+  string err;
+  string triple = sys::getProcessTriple();
+  const Target* target = TargetRegistry::lookupTarget(triple, err);
+  if (!target) {
+    throw CompileError("Critical Error: Cible non supportee : " + triple + " : " + err);
+  }
+  
+  string cpu;
+  vector<string> features;
+  this->resolveTarget(cpu, features);
+  Logger::debug << "Processeur cible : " << triple << " " << cpu << " " << Util::join(features, ",") << endl;
+  
+  // Code indépendant de la position : l'objet peut être lié dans une bibliothèque partagée
+  this->_targetMachine = target->createTargetMachine(
+      triple, cpu, Util::join(features, ","), this->targetOptions(),
+      Reloc::PIC_, CodeModel::Default, this->codeGenOptLevel()
+  );
+  if (!this->_targetMachine) {
+    throw CompileError("Critical Error: Cible non supportee : " + cpu);
+  }
+  this->_mod->setTargetTriple(triple);
+  this->_mod->setDataLayout(this->_targetMachine->getDataLayout());
+}
+
+/*
+ * Exécute une commande sans passer par le shell : les noms de fichiers sont
+ * transmis tels quels, quels que soient leurs caractères.
+ */
+bool Builder::execute(const vector<string>& command)
+{
+  vector<char*> argv;
+  for (const string& arg : command) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    return false;
+  }
+  if (pid == 0) {
+    execvp(argv[0], argv.data());
+    _exit(127);
+  }
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+void Builder::emit(EmitKind kind, const string& filename, const string& runtimeLibrary)
+{
+  assert(this->_targetMachine != nullptr);
+  
+  // Bibliothèque partagée : fichier objet temporaire lié avec le runtime
+  if (kind == EmitKind::SO) {
+    string object = filename + ".o";
+    this->emit(EmitKind::OBJ, object, runtimeLibrary);
+    // -pthread : SORT ARRAY trie les grands tableaux sur plusieurs threads
+    vector<string> command{"c++", "-shared", "-pthread", "-o", filename, object, runtimeLibrary};
+    Logger::debug << Util::join(command, " ") << endl;
+    bool linked = execute(command);
+    remove(object.c_str());
+    if (!linked) {
+      throw CompileError("Error: Echec de l'edition des liens de \"" + filename + "\"");
+    }
+    return;
+  }
+  
+  string err;
+  raw_fd_ostream out(filename.c_str(), err, sys::fs::F_None);
+  if (!err.empty()) {
+    throw CompileError("Error: Impossible d'ecrire \"" + filename + "\" : " + err);
+  }
+  
+  if (kind == EmitKind::BC) {
+    WriteBitcodeToFile(this->_mod, out);
+    return;
+  }
+  
+  PassManager codegen;
+  codegen.add(new DataLayoutPass(*this->dataLayout()));
+  formatted_raw_ostream fout(out);
+  auto fileType = kind == EmitKind::ASM ? TargetMachine::CGFT_AssemblyFile
+                                        : TargetMachine::CGFT_ObjectFile;
+  if (this->_targetMachine->addPassesToEmitFile(codegen, fout, fileType)) {
+    throw CompileError("Error: La cible ne peut pas generer ce type de fichier");
+  }
+  codegen.run(*this->_mod);
+}
+
+/*
+ * Fast-math : les opérations réelles peuvent être réassociées, contractées en
+ * FMA et vectorisées (réductions), en supposant qu'aucune valeur n'est infinie
+ * ni NaN. Le résultat peut différer au dernier bit près d'un calcul IEEE strict.
+ */
+void Builder::setFastMath(bool fastMath)
+{
+  this->_fastMath = fastMath;
+  FastMathFlags flags;
+  if (fastMath) {
+    flags.setUnsafeAlgebra();
+  }
+  this->_irb.SetFastMathFlags(flags);
+}
+
+TargetOptions Builder::targetOptions() const
+{
+  TargetOptions options;
+  if (this->_fastMath) {
+    options.UnsafeFPMath = true;
+    options.NoInfsFPMath = true;
+    options.NoNaNsFPMath = true;
+    options.AllowFPOpFusion = FPOpFusion::Fast;
+  }
+  return options;
+}
+
+void Builder::setLazyCompilation(bool lazy)
+{
+  this->_lazy = lazy;
+  if (this->_jit) {
+    this->_jit->DisableLazyCompilation(!lazy);
   }
 }
 
@@ -230,14 +931,86 @@ void Builder::setOptimizer(FunctionPassManager* optimizer)
   this->_optimizer = optimizer;
 }
 
+void Builder::setTarget(const string& cpu, const vector<string>& features)
+{
+  this->_targetCPU = cpu;
+  this->_targetFeatures = features;
+}
+
+void Builder::resolveTarget(string& cpu, vector<string>& features) const
+{
+  features.clear();
+  if (this->_targetCPU.empty() || this->_targetCPU == "native") {
+    cpu = sys::getHostCPUName();
+    // Extensions réellement disponibles sur la machine hôte
+    StringMap<bool> hostFeatures;
+    if (sys::getHostCPUFeatures(hostFeatures)) {
+      for (auto& feature : hostFeatures) {
+        features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+      }
+    }
+  } else {
+    cpu = this->_targetCPU;
+  }
+  // Les extensions demandées explicitement sont prioritaires
+  features.insert(features.end(), this->_targetFeatures.begin(), this->_targetFeatures.end());
+}
+
+void Builder::setOptLevel(unsigned optLevel, unsigned sizeLevel)
+{
+  this->_optLevel = optLevel;
+  this->_sizeLevel = sizeLevel;
+}
+
+CodeGenOpt::Level Builder::codeGenOptLevel() const
+{
+  switch (this->_optLevel) {
+  case 0:
+    return CodeGenOpt::None;
+  case 1:
+    return CodeGenOpt::Less;
+  case 2:
+    return CodeGenOpt::Default;
+  default:
+    return CodeGenOpt::Aggressive;
+  }
+}
+
+const DataLayout* Builder::dataLayout() const
+{
+  if (this->_jit) {
+    return this->_jit->getDataLayout();
+  }
+  if (this->_targetMachine) {
+    return this->_targetMachine->getDataLayout();
+  }
+  return this->_mod->getDataLayout();
+}
+
 FunctionPassManager* Builder::getStandardOptimizer()
 {
   FunctionPassManager* optimizer = new FunctionPassManager(this->_mod);
 
+  // -O0 : démarrage le plus rapide possible, mais la récursion profonde doit
+  // rester sans pile. L'élimination des appels terminaux travaille sur des
+  // registres : les variables locales y sont promues d'abord.
+  if (this->_optLevel == 0) {
+    optimizer->add(createPromoteMemoryToRegisterPass());
+    optimizer->add(createCFGSimplificationPass());
+    optimizer->add(createTailCallEliminationPass());
+    optimizer->add(createCFGSimplificationPass());
+    optimizer->doInitialization();
+    return optimizer;
+  }
+
   // Set up the optimizer pipeline.  Start with registering info about how the
   // target lays out data structures.
-  if (this->_jit) {
-    optimizer->add(new DataLayoutPass(*this->_jit->getDataLayout()));
+  if (this->dataLayout()) {
+    optimizer->add(new DataLayoutPass(*this->dataLayout()));
+  }
+  // Target specific costs (vector width...), used by the vectorizers.
+  if (this->_targetMachine) {
+    this->_targetMachine->addAnalysisPasses(*optimizer);
   }
   // Provide basic AliasAnalysis support for GVN.
   optimizer->add(createBasicAliasAnalysisPass());
@@ -251,12 +1024,54 @@ FunctionPassManager* Builder::getStandardOptimizer()
   optimizer->add(createGVNPass());
   // Simplify the control flow graph (deleting unreachable blocks, etc).
   optimizer->add(createCFGSimplificationPass());
+  // Turn self-recursive calls (including accumulator style ones such as
+  // "$0 := $1 * f($1 - 1)") into loops, so deep recursion no longer uses stack.
+  optimizer->add(createTailCallEliminationPass());
+  // Clean up the loops created by the tail call elimination.
+  optimizer->add(createCFGSimplificationPass());
 
   optimizer->doInitialization();
   return optimizer;
 }
 
 
+void Builder::setModuleOptimizer(PassManager* optimizer)
+{
+  this->_moduleOptimizer = optimizer;
+}
+
+PassManager* Builder::getStandardModuleOptimizer(unsigned inlineThreshold)
+{
+  if (this->_optLevel == 0) {
+    return nullptr;
+  }
+  PassManager* optimizer = new PassManager();
+
+  if (this->dataLayout()) {
+    optimizer->add(new DataLayoutPass(*this->dataLayout()));
+  }
+  if (this->_targetMachine) {
+    this->_targetMachine->addAnalysisPasses(*optimizer);
+  }
+
+  // Pipeline standard de LLVM correspondant au niveau d'optimisation :
+  // IPSCCP, function attrs, inliner, SROA, passes de boucles (rotate, LICM,
+  // unswitch, indvars, unroll...), GVN, vectoriseurs à partir de -O2...
+  PassManagerBuilder pmb;
+  pmb.OptLevel = this->_optLevel;
+  pmb.SizeLevel = this->_sizeLevel;
+  pmb.Inliner = createFunctionInliningPass(inlineThreshold);
+  pmb.LoopVectorize = this->_optLevel >= 2 && this->_sizeLevel == 0;
+  pmb.SLPVectorize = this->_optLevel >= 3;
+  pmb.populateModulePassManager(*optimizer);
+
+  // Remove the methods which are no longer called.
+  optimizer->add(createGlobalDCEPass());
+
+  return optimizer;
+}
+
+
 void Builder::optimize(Function* f)
 {
   if (this->_optimizer) {
@@ -264,6 +1079,21 @@ void Builder::optimize(Function* f)
   }
 }
 
+void Builder::optimizeModule(const vector<Function*>& methods, bool internalize)
+{
+  if (!this->_moduleOptimizer) {
+    return;
+  }
+  // Seule la fonction main est appelée de l'extérieur : les méthodes 4D peuvent
+  // être supprimées du module une fois inlinées partout.
+  if (internalize) {
+    for (auto& F : methods) {
+      F->setLinkage(GlobalValue::InternalLinkage);
+    }
+  }
+  this->_moduleOptimizer->run(*this->_mod);
+}
+
 void Builder::declareBuiltins()
 {
   Function* F;
@@ -277,8 +1107,340 @@ void Builder::declareBuiltins()
       _jit->addGlobalMapping(F, builtin->getPtr());
     }
   }
+  this->module().getFunction("BUILTINarrayOutOfBounds")->setDoesNotReturn();
+
+  // Descripteurs des tableaux, lus directement par le code généré
+  Type* i32 = Type::getInt32Ty(context());
+  StructType* arrayType = StructType::get(i32->getPointerTo(), i32, i32, i32, nullptr);
+  this->_arrays = this->module().getNamedGlobal("BUILTINarrays");
+  if (!this->_arrays) {
+    this->_arrays = new GlobalVariable(this->module(), arrayType->getPointerTo(), false,
+                                       GlobalValue::ExternalLinkage, nullptr, "BUILTINarrays");
+  }
+  this->_arrayCount = this->module().getNamedGlobal("BUILTINarrayCount");
+  if (!this->_arrayCount) {
+    this->_arrayCount = new GlobalVariable(this->module(), i32, false,
+                                           GlobalValue::ExternalLinkage, nullptr, "BUILTINarrayCount");
+  }
+  if (_jit && !_jit->getPointerToGlobalIfAvailable(this->_arrays)) {
+    _jit->addGlobalMapping(this->_arrays, (void*) &::BUILTINarrays);
+    _jit->addGlobalMapping(this->_arrayCount, (void*) &::BUILTINarrayCount);
+  }
+
+  // Création des textes littéraux, hors de la table des builtins : elle prend
+  // l'adresse des caractères
+  if (!this->module().getFunction("BUILTINtextConstant")) {
+    vector<Type*> args{Type::getInt8PtrTy(context()), i32};
+    FunctionType* FT = FunctionType::get(i32, args, false);
+    F = Function::Create(FT, Function::ExternalLinkage, "BUILTINtextConstant", &this->module());
+    if (_jit) {
+      _jit->addGlobalMapping(F, (void*) &::BUILTINtextConstant);
+    }
+  }
+  // Clés des noms de propriétés d'objets, de même
+  if (!this->module().getFunction("BUILTINobjectKey")) {
+    vector<Type*> args{Type::getInt8PtrTy(context()), i32};
+    FunctionType* FT = FunctionType::get(i32, args, false);
+    F = Function::Create(FT, Function::ExternalLinkage, "BUILTINobjectKey", &this->module());
+    if (_jit) {
+      _jit->addGlobalMapping(F, (void*) &::BUILTINobjectKey);
+    }
+  }
+
+  // Descripteurs des objets, lus directement par les caches des accès
+  // $objet.nom, et accès par cache, qui prennent l'adresse du cache
+  Type* i64 = Type::getInt64Ty(context());
+  StructType* valueType = StructType::get(i32, i32, i64, nullptr);
+  StructType* objectType = StructType::get(i32, i32, i32, i32, i32, i32, i32, Type::getInt8PtrTy(context()),
+                                           i32->getPointerTo(), valueType->getPointerTo(), i32, nullptr);
+  this->_propertyCacheType = StructType::get(i32, i32, nullptr);
+  this->_objects = this->module().getNamedGlobal("BUILTINobjects");
+  if (!this->_objects) {
+    this->_objects = new GlobalVariable(this->module(), objectType->getPointerTo(), false,
+                                        GlobalValue::ExternalLinkage, nullptr, "BUILTINobjects");
+  }
+  this->_objectCount = this->module().getNamedGlobal("BUILTINobjectCount");
+  if (!this->_objectCount) {
+    this->_objectCount = new GlobalVariable(this->module(), i32, false,
+                                            GlobalValue::ExternalLinkage, nullptr, "BUILTINobjectCount");
+  }
+  if (_jit && !_jit->getPointerToGlobalIfAvailable(this->_objects)) {
+    _jit->addGlobalMapping(this->_objects, (void*) &::BUILTINobjects);
+    _jit->addGlobalMapping(this->_objectCount, (void*) &::BUILTINobjectCount);
+  }
+  Type* cachePtr = this->_propertyCacheType->getPointerTo();
+  if (!this->module().getFunction("BUILTINobjectGetCached")) {
+    vector<Type*> args{i32, i32, i32, cachePtr};
+    F = Function::Create(FunctionType::get(i64, args, false), Function::ExternalLinkage,
+                         "BUILTINobjectGetCached", &this->module());
+    if (_jit) {
+      _jit->addGlobalMapping(F, (void*) &::BUILTINobjectGetCached);
+    }
+  }
+  if (!this->module().getFunction("BUILTINobjectSetCached")) {
+    vector<Type*> args{i32, i32, i32, i64, cachePtr};
+    F = Function::Create(FunctionType::get(i32, args, false), Function::ExternalLinkage,
+                         "BUILTINobjectSetCached", &this->module());
+    if (_jit) {
+      _jit->addGlobalMapping(F, (void*) &::BUILTINobjectSetCached);
+    }
+  }
+}
+
+/*
+ * Données du tableau array si index est dans ses bornes (0 à sa taille),
+ * sinon branchement vers failBB. Le descripteur 0, de taille -1, et les
+ * identifiants invalides échouent toujours.
+ */
+Value* Builder::arrayData(Value* array, Value* index, BasicBlock* failBB)
+{
+  IRBuilder<>& irb = this->irbuilder();
+  Function* F = irb.GetInsertBlock()->getParent();
+  BasicBlock* validBB = BasicBlock::Create(this->context(), "array.valid", F);
+  BasicBlock* inBoundsBB = BasicBlock::Create(this->context(), "array.inbounds", F);
+
+  Value* count = irb.CreateLoad(this->_arrayCount, "array.count");
+  irb.CreateCondBr(irb.CreateICmpULT(array, count, "array.isvalid"), validBB, failBB);
+  irb.SetInsertPoint(validBB);
+  this->currentBlock() = validBB;
+
+  Value* descriptor = irb.CreateInBoundsGEP(irb.CreateLoad(this->_arrays, "arrays"), array, "array.descriptor");
+  Value* size = irb.CreateLoad(irb.CreateStructGEP(descriptor, 1), "array.size");
+  Value* limit = irb.CreateAdd(size, ConstantInt::get(size->getType(), 1), "array.limit");
+  irb.CreateCondBr(irb.CreateICmpULT(index, limit, "array.isinbounds"), inBoundsBB, failBB);
+  irb.SetInsertPoint(inBoundsBB);
+  this->currentBlock() = inBoundsBB;
+
+  return irb.CreateLoad(irb.CreateStructGEP(descriptor, 0), "array.data");
+}
+
+// Adresse de l'élément index du tableau array, de type vtype, avec contrôle
+// des bornes
+Value* Builder::arrayElement(Value* array, Value* index, VarType vtype)
+{
+  IRBuilder<>& irb = this->irbuilder();
+  Function* F = irb.GetInsertBlock()->getParent();
+  BasicBlock* current = irb.GetInsertBlock();
+  BasicBlock* failBB = BasicBlock::Create(this->context(), "array.outofbounds", F);
+
+  irb.SetInsertPoint(failBB);
+  irb.CreateCall2(this->module().getFunction("BUILTINarrayOutOfBounds"), array, index);
+  irb.CreateUnreachable();
+  irb.SetInsertPoint(current);
+
+  Value* data = this->arrayData(array, index, failBB);
+  return this->element(data, index, vtype);
+}
+
+// Adresse de l'élément index des données d'un tableau : les éléments d'un
+// tableau de réels sont des double
+Value* Builder::element(Value* data, Value* index, VarType vtype)
+{
+  if (vtype == VarType::REAL) {
+    data = this->irbuilder().CreateBitCast(data, this->type(vtype)->getPointerTo(), "array.reals");
+  }
+  return this->irbuilder().CreateInBoundsGEP(data, index, "array.element");
+}
+
+void Builder::pushInBounds(const string& index, const map<string, Value*>& data)
+{
+  this->_inBounds.push_back(make_pair(index, data));
+}
+
+void Builder::popInBounds()
+{
+  this->_inBounds.pop_back();
+}
+
+// Données du tableau si $array{$index} est dans les bornes d'une boucle englobante
+Value* Builder::inBoundsData(const string& array, const string& index) const
+{
+  for (auto it = this->_inBounds.rbegin(); it != this->_inBounds.rend(); ++it) {
+    if (it->first == index && it->second.count(array)) {
+      return it->second.at(array);
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Identifiant non nul créé au premier passage par create(caractères, taille),
+ * puis lu dans une variable globale propre au site
+ */
+Value* Builder::cachedConstant(const string& create, const string& str, const string& name)
+{
+  IRBuilder<>& irb = this->irbuilder();
+  Type* i32 = irb.getInt32Ty();
+  Constant* chars = ConstantDataArray::getString(this->context(), str, false);
+  GlobalVariable* data = new GlobalVariable(this->module(), chars->getType(), true,
+                                            GlobalValue::PrivateLinkage, chars, name + ".chars");
+  GlobalVariable* cache = new GlobalVariable(this->module(), i32, false,
+                                             GlobalValue::PrivateLinkage, ConstantInt::get(i32, 0), name + ".constant");
+
+  Function* F = irb.GetInsertBlock()->getParent();
+  BasicBlock* current = irb.GetInsertBlock();
+  BasicBlock* createBB = BasicBlock::Create(this->context(), name + ".create", F);
+  BasicBlock* readyBB = BasicBlock::Create(this->context(), name + ".ready", F);
+  Value* cached = irb.CreateLoad(cache, name + ".cached");
+  irb.CreateCondBr(irb.CreateICmpEQ(cached, ConstantInt::get(i32, 0), name + ".isnew"), createBB, readyBB);
+
+  irb.SetInsertPoint(createBB);
+  Value* created = irb.CreateCall2(this->module().getFunction(create),
+                                   irb.CreateConstInBoundsGEP2_32(data, 0, 0),
+                                   ConstantInt::get(i32, str.size()), name + ".created");
+  irb.CreateStore(created, cache);
+  irb.CreateBr(readyBB);
+
+  irb.SetInsertPoint(readyBB);
+  this->currentBlock() = readyBB;
+  PHINode* phi = irb.CreatePHI(i32, 2, name);
+  phi->addIncoming(cached, current);
+  phi->addIncoming(created, createBB);
+  return phi;
+}
+
+/*
+ * Texte littéral : créé une fois par BUILTINtextConstant. Le texte vide est
+ * l'identifiant 0.
+ */
+Value* Builder::textConstant(const string& text)
+{
+  if (text.empty()) {
+    return this->irbuilder().getInt32(0);
+  }
+  return this->cachedConstant("BUILTINtextConstant", text, "text");
+}
+
+// Clé du nom de propriété name, internée une fois par BUILTINobjectKey
+Value* Builder::objectKey(const string& name)
+{
+  return this->cachedConstant("BUILTINobjectKey", name, "object.key");
+}
+
+// Cache d'un accès $objet.nom, propre au site
+Value* Builder::propertyCache()
+{
+  return new GlobalVariable(this->module(), this->_propertyCacheType, false, GlobalValue::PrivateLinkage,
+                            Constant::getNullValue(this->_propertyCacheType), "object.cache");
 }
 
+/*
+ * $objet.nom lu dans le genre kind (FOURDVALUE_*), sur 64 bits. Un objet de
+ * la forme retenue par le cache du site, dont la valeur est déjà du genre
+ * demandé, est lu directement ; sinon BUILTINobjectGetCached cherche la
+ * propriété et met le cache à jour. La clé n'est internée qu'à la première
+ * recherche. Avec FOURDVALUE_RELEASE, l'objet rend sa référence après la
+ * lecture.
+ */
+Value* Builder::getProperty(Value* object, const string& name, int kind)
+{
+  IRBuilder<>& irb = this->irbuilder();
+  Function* F = irb.GetInsertBlock()->getParent();
+  BasicBlock* validBB = BasicBlock::Create(this->context(), "object.valid", F);
+  BasicBlock* shapedBB = BasicBlock::Create(this->context(), "object.shaped", F);
+  BasicBlock* hitBB = BasicBlock::Create(this->context(), "object.hit", F);
+  BasicBlock* missBB = BasicBlock::Create(this->context(), "object.miss", F);
+  BasicBlock* doneBB = BasicBlock::Create(this->context(), "object.done", F);
+  Value* cache = this->propertyCache();
+
+  Value* count = irb.CreateLoad(this->_objectCount, "object.count");
+  irb.CreateCondBr(irb.CreateICmpULT(object, count, "object.isvalid"), validBB, missBB);
+
+  irb.SetInsertPoint(validBB);
+  Value* descriptor = irb.CreateInBoundsGEP(irb.CreateLoad(this->_objects, "objects"), object, "object.descriptor");
+  Value* shape = irb.CreateLoad(irb.CreateStructGEP(descriptor, 1), "object.shape");
+  Value* cachedShape = irb.CreateLoad(irb.CreateStructGEP(cache, 0), "object.cachedshape");
+  irb.CreateCondBr(irb.CreateICmpEQ(shape, cachedShape, "object.sameshape"), shapedBB, missBB);
+
+  irb.SetInsertPoint(shapedBB);
+  Value* values = irb.CreateLoad(irb.CreateStructGEP(descriptor, 9), "object.values");
+  Value* position = irb.CreateLoad(irb.CreateStructGEP(cache, 1), "object.position");
+  Value* value = irb.CreateInBoundsGEP(values, position, "object.value");
+  Value* valueKind = irb.CreateLoad(irb.CreateStructGEP(value, 1), "object.kind");
+  int wanted = kind & ~FOURDVALUE_RELEASE;
+  irb.CreateCondBr(irb.CreateICmpEQ(valueKind, irb.getInt32(wanted), "object.samekind"), hitBB, missBB);
+
+  irb.SetInsertPoint(hitBB);
+  Value* bits = irb.CreateLoad(irb.CreateStructGEP(value, 2), "object.bits");
+  if (wanted == FOURDVALUE_TEXT || wanted == FOURDVALUE_OBJECT) {
+    // Un texte ou un objet lu porte sa propre référence
+    Value* counted = this->callBuiltin(wanted == FOURDVALUE_TEXT ? "text.retain" : "object.retain",
+                                       irb.CreateTrunc(bits, irb.getInt32Ty()), "object.counted");
+    bits = irb.CreateZExt(counted, bits->getType(), "object.bits");
+  }
+  if (kind & FOURDVALUE_RELEASE) {
+    this->callBuiltin("object.release", object);
+  }
+  irb.CreateBr(doneBB);
+
+  irb.SetInsertPoint(missBB);
+  this->currentBlock() = missBB;
+  Value* key = this->objectKey(name);
+  Value* found = irb.CreateCall4(this->module().getFunction("BUILTINobjectGetCached"),
+                                 object, key, irb.getInt32(kind), cache, "object.found");
+  BasicBlock* foundBB = irb.GetInsertBlock();
+  irb.CreateBr(doneBB);
+
+  irb.SetInsertPoint(doneBB);
+  this->currentBlock() = doneBB;
+  PHINode* phi = irb.CreatePHI(bits->getType(), 2, "property");
+  phi->addIncoming(bits, hitBB);
+  phi->addIncoming(found, foundBB);
+  return phi;
+}
+
+// $objet.nom:=bits : BUILTINobjectSetCached affecte directement un objet de la
+// forme retenue par le cache du site
+Value* Builder::setProperty(Value* object, const string& name, int kind, Value* bits)
+{
+  IRBuilder<>& irb = this->irbuilder();
+  Value* key = this->objectKey(name);
+  Value* args[] = {object, key, irb.getInt32(kind), bits, this->propertyCache()};
+  return irb.CreateCall(this->module().getFunction("BUILTINobjectSetCached"), args);
+}
+
+// Appel du builtin de clé builtin dans Builtin::getList()
+Value* Builder::callBuiltin(const string& builtin, ArrayRef<Value*> args, const string& name)
+{
+  Function* F = this->module().getFunction(Builtin::getList()[builtin]->signature()->name());
+  assert(F != nullptr);
+  return this->irbuilder().CreateCall(F, args, name);
+}
+
+
+// Type LLVM d'une valeur : double pour un réel, i64 pour un entier 64 bits,
+// sinon un entier 32 bits (nombre, booléen, texte, tableau ou objet par leur identifiant)
+Type* Builder::type(VarType vtype)
+{
+  if (vtype == VarType::REAL) {
+    return Type::getDoubleTy(this->context());
+  }
+  if (vtype == VarType::LONG) {
+    return Type::getInt64Ty(this->context());
+  }
+  return Type::getInt32Ty(this->context());
+}
+
+// Conversion entre entiers et réel : extension signée d'un entier, troncature
+// vers un entier, comme Trunc
+Value* Builder::convert(Value* V, Type* to)
+{
+  // Booléen d'une comparaison : 0 ou 1
+  if (V->getType()->isIntegerTy(1) && V->getType() != to) {
+    V = this->_irb.CreateZExt(V, this->_irb.getInt32Ty(), "conv.bool");
+  }
+  Type* from = V->getType();
+  if (from == to) {
+    return V;
+  }
+  if (from->isDoubleTy()) {
+    return this->_irb.CreateFPToSI(V, to, "conv.int");
+  }
+  if (to->isDoubleTy()) {
+    return this->_irb.CreateSIToFP(V, to, "conv.real");
+  }
+  return this->_irb.CreateSExtOrTrunc(V, to, "conv.int");
+}
 
 AllocaInst* Builder::createEntryBlockAlloca(Function *F, const string& name, Type* type)
 {
@@ -296,13 +1458,16 @@ void Builder::createAllocas(
 {
   AllocaInst *Alloca ;
   string varName;
-  Type* varType = Type::getInt32Ty(context());
+  Type* varType;
   for (auto& varPair : types) {
     varName = varPair.first;
-    //varType = varPair.second.getType();
+    varType = this->type(varPair.second);
     if (vals.count(varName) == 0) {
       Alloca = createEntryBlockAlloca(F, varName, varType);
       vals[varName] = Alloca;
+      // Comme dans l'interpréteur, une variable locale vaut 0 avant sa
+      // première affectation (un tableau non déclaré, par exemple)
+      this->irbuilder().CreateStore(Constant::getNullValue(varType), Alloca);
     }
   }
 }
@@ -310,7 +1475,8 @@ void Builder::createAllocas(
 
 void Builder::createGlobals(
           map<string, VarType>& types,
-          map<string, GlobalVariable*>& vals
+          map<string, GlobalVariable*>& vals,
+          bool definition
 )
 {
   bool comma = false;
@@ -318,7 +1484,7 @@ void Builder::createGlobals(
   Type* type;
   for (auto& var : types) {
     name = var.first;
-    type = Type::getInt32Ty(context()); //should be return var.second.getType();
+    type = this->type(var.second);
     if (comma) {
       Logger::debug << ", ";
     } else {
@@ -331,7 +1497,7 @@ void Builder::createGlobals(
                         type,
                         false,
                         GlobalValue::ExternalLinkage,
-                        ConstantInt::get(Type::getInt32Ty(context()), 0),
+                        definition ? Constant::getNullValue(type) : nullptr,
                         name
       );
     } // else -> type verification
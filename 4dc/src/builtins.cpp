@@ -1,22 +1,9 @@
 #include "../include/builtins.h"
 #include "../include/functionsignature.h"
-#include <cstdio>
-#include <cstdlib>
+#include "../include/runtime.h"
 using namespace std;
 
 
-int BUILTINalert(int i)
-{
-  printf("%i\n", i);
-  return 0;
-}
-
-int BUILTINabort()
-{
-  abort();
-  return 0;
-}
-
 std::map<std::string, Builtin*> Builtin::_list{
   {"alert", new Builtin(new FunctionSignature(
       "BUILTINalert", VarType::INT, {VarType::INT}),
@@ -25,13 +12,280 @@ std::map<std::string, Builtin*> Builtin::_list{
   {"abort", new Builtin(new FunctionSignature(
       "BUILTINabort", VarType::INT, {}),
       (void*) &::BUILTINabort)
+  },
+
+  // Tableaux ; ARRAY LONGINT, ARRAY INTEGER, ARRAY REAL et ARRAY TEXT sont
+  // analysés par le parser
+  {"array longint", new Builtin(new FunctionSignature(
+      "BUILTINarrayResize", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayResize, BuiltinEffect::RESIZE)
+  },
+  {"array real", new Builtin(new FunctionSignature(
+      "BUILTINarrayResizeReal", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayResizeReal, BuiltinEffect::RESIZE)
+  },
+  {"array text", new Builtin(new FunctionSignature(
+      "BUILTINarrayResizeText", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayResizeText, BuiltinEffect::RESIZE)
+  },
+  {"size of array", new Builtin(new FunctionSignature(
+      "BUILTINarraySize", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarraySize, BuiltinEffect::NONE)
+  },
+  {"append to array", new Builtin(new FunctionSignature(
+      "BUILTINarrayAppend", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayAppend, BuiltinEffect::RESIZE)
+  },
+  // Variantes choisies par CallAST selon le type des éléments du tableau
+  {"append to array.real", new Builtin(new FunctionSignature(
+      "BUILTINarrayAppendReal", VarType::INT, {VarType::INT, VarType::REAL}),
+      (void*) &::BUILTINarrayAppendReal, BuiltinEffect::RESIZE)
+  },
+  {"append to array.text", new Builtin(new FunctionSignature(
+      "BUILTINarrayAppendText", VarType::INT, {VarType::INT, VarType::STRING}),
+      (void*) &::BUILTINarrayAppendText, BuiltinEffect::RESIZE)
+  },
+  {"insert in array", new Builtin(new FunctionSignature(
+      "BUILTINarrayInsert", VarType::INT, {VarType::INT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayInsert, BuiltinEffect::RESIZE)
+  },
+  {"delete from array", new Builtin(new FunctionSignature(
+      "BUILTINarrayDelete", VarType::INT, {VarType::INT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayDelete, BuiltinEffect::RESIZE)
+  },
+  // Réductions vectorisées
+  {"sum", new Builtin(new FunctionSignature(
+      "BUILTINarraySum", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarraySum, BuiltinEffect::NONE)
+  },
+  {"average", new Builtin(new FunctionSignature(
+      "BUILTINarrayAverage", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarrayAverage, BuiltinEffect::NONE)
+  },
+  {"min", new Builtin(new FunctionSignature(
+      "BUILTINarrayMin", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarrayMin, BuiltinEffect::NONE)
+  },
+  {"max", new Builtin(new FunctionSignature(
+      "BUILTINarrayMax", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarrayMax, BuiltinEffect::NONE)
+  },
+  {"find in array", new Builtin(new FunctionSignature(
+      "BUILTINarrayFind", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayFind, BuiltinEffect::NONE)
+  },
+  // Tableaux de réels et de textes
+  {"sum.real", new Builtin(new FunctionSignature(
+      "BUILTINarraySumReal", VarType::REAL, {VarType::INT}),
+      (void*) &::BUILTINarraySumReal, BuiltinEffect::NONE)
+  },
+  {"average.real", new Builtin(new FunctionSignature(
+      "BUILTINarrayAverageReal", VarType::REAL, {VarType::INT}),
+      (void*) &::BUILTINarrayAverageReal, BuiltinEffect::NONE)
+  },
+  {"min.real", new Builtin(new FunctionSignature(
+      "BUILTINarrayMinReal", VarType::REAL, {VarType::INT}),
+      (void*) &::BUILTINarrayMinReal, BuiltinEffect::NONE)
+  },
+  {"max.real", new Builtin(new FunctionSignature(
+      "BUILTINarrayMaxReal", VarType::REAL, {VarType::INT}),
+      (void*) &::BUILTINarrayMaxReal, BuiltinEffect::NONE)
+  },
+  {"find in array.real", new Builtin(new FunctionSignature(
+      "BUILTINarrayFindReal", VarType::INT, {VarType::INT, VarType::REAL}),
+      (void*) &::BUILTINarrayFindReal, BuiltinEffect::NONE)
+  },
+  {"find in array.text", new Builtin(new FunctionSignature(
+      "BUILTINarrayFindText", VarType::INT, {VarType::INT, VarType::STRING}),
+      (void*) &::BUILTINarrayFindText, BuiltinEffect::NONE)
+  },
+  // SORT ARRAY : les tableaux suivis par array.sortfollow sont réordonnés
+  // comme la clé
+  {"sort array", new Builtin(new FunctionSignature(
+      "BUILTINarraySort", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarraySort, BuiltinEffect::RESIZE)
+  },
+  {"array.sortfollow", new Builtin(new FunctionSignature(
+      "BUILTINarraySortFollow", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarraySortFollow, BuiltinEffect::RESIZE)
+  },
+  // Accès aux éléments $tableau{$i} : le point rend ces noms inaccessibles
+  // depuis le langage
+  {"array.get", new Builtin(new FunctionSignature(
+      "BUILTINarrayGet", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayGet, BuiltinEffect::NONE)
+  },
+  {"array.set", new Builtin(new FunctionSignature(
+      "BUILTINarraySet", VarType::INT, {VarType::INT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarraySet, BuiltinEffect::IO)
+  },
+  {"array.getvalue", new Builtin(new FunctionSignature(
+      "BUILTINarrayGetValue", VarType::LONG, {VarType::INT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayGetValue, BuiltinEffect::NONE)
+  },
+  {"array.setvalue", new Builtin(new FunctionSignature(
+      "BUILTINarraySetValue", VarType::INT, {VarType::INT, VarType::INT, VarType::INT, VarType::LONG}),
+      (void*) &::BUILTINarraySetValue, BuiltinEffect::IO)
+  },
+  // Tableaux locaux à la sortie de leur méthode
+  {"array.release", new Builtin(new FunctionSignature(
+      "BUILTINarrayRelease", VarType::INT, {VarType::INT}),
+      (void*) &::BUILTINarrayRelease, BuiltinEffect::NONE)
+  },
+  {"array.outofbounds", new Builtin(new FunctionSignature(
+      "BUILTINarrayOutOfBounds", VarType::INT, {VarType::INT, VarType::INT}),
+      (void*) &::BUILTINarrayOutOfBounds, BuiltinEffect::IO)
+  },
+  // Textes
+  {"string", new Builtin(new FunctionSignature(
+      "BUILTINtextFromInt", VarType::STRING, {VarType::INT}),
+      (void*) &::BUILTINtextFromInt, BuiltinEffect::NONE)
+  },
+  {"num", new Builtin(new FunctionSignature(
+      "BUILTINtextToInt", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINtextToInt, BuiltinEffect::NONE)
+  },
+  {"length", new Builtin(new FunctionSignature(
+      "BUILTINtextLength", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINtextLength, BuiltinEffect::NONE)
+  },
+  {"position", new Builtin(new FunctionSignature(
+      "BUILTINtextPosition", VarType::INT, {VarType::STRING, VarType::STRING}),
+      (void*) &::BUILTINtextPosition, BuiltinEffect::NONE)
+  },
+  {"position.3", new Builtin(new FunctionSignature(
+      "BUILTINtextPositionFrom", VarType::INT, {VarType::STRING, VarType::STRING, VarType::INT}),
+      (void*) &::BUILTINtextPositionFrom, BuiltinEffect::NONE)
+  },
+  {"substring", new Builtin(new FunctionSignature(
+      "BUILTINtextSubstring", VarType::STRING, {VarType::STRING, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINtextSubstring, BuiltinEffect::NONE)
+  },
+  {"substring.2", new Builtin(new FunctionSignature(
+      "BUILTINtextSubstringToEnd", VarType::STRING, {VarType::STRING, VarType::INT}),
+      (void*) &::BUILTINtextSubstringToEnd, BuiltinEffect::NONE)
+  },
+  {"replace string", new Builtin(new FunctionSignature(
+      "BUILTINtextReplace", VarType::STRING, {VarType::STRING, VarType::STRING, VarType::STRING}),
+      (void*) &::BUILTINtextReplace, BuiltinEffect::NONE)
+  },
+  {"uppercase", new Builtin(new FunctionSignature(
+      "BUILTINtextUppercase", VarType::STRING, {VarType::STRING}),
+      (void*) &::BUILTINtextUppercase, BuiltinEffect::NONE)
+  },
+  {"lowercase", new Builtin(new FunctionSignature(
+      "BUILTINtextLowercase", VarType::STRING, {VarType::STRING}),
+      (void*) &::BUILTINtextLowercase, BuiltinEffect::NONE)
+  },
+  // ALERT d'un texte : choisi par CallAST quand l'argument est un texte
+  {"alert.text", new Builtin(new FunctionSignature(
+      "BUILTINalertText", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINalertText)
+  },
+  // ALERT et String d'un réel : choisis par CallAST quand l'argument est un réel
+  {"alert.real", new Builtin(new FunctionSignature(
+      "BUILTINalertReal", VarType::INT, {VarType::REAL}),
+      (void*) &::BUILTINalertReal)
+  },
+  {"string.real", new Builtin(new FunctionSignature(
+      "BUILTINtextFromReal", VarType::STRING, {VarType::REAL}),
+      (void*) &::BUILTINtextFromReal, BuiltinEffect::NONE)
+  },
+  // ALERT et String d'un entier 64 bits
+  {"alert.long", new Builtin(new FunctionSignature(
+      "BUILTINalertLong", VarType::INT, {VarType::LONG}),
+      (void*) &::BUILTINalertLong)
+  },
+  {"string.long", new Builtin(new FunctionSignature(
+      "BUILTINtextFromLong", VarType::STRING, {VarType::LONG}),
+      (void*) &::BUILTINtextFromLong, BuiltinEffect::NONE)
+  },
+  // Références et opérateurs des textes, utilisés par le code généré
+  {"text.retain", new Builtin(new FunctionSignature(
+      "BUILTINtextRetain", VarType::STRING, {VarType::STRING}),
+      (void*) &::BUILTINtextRetain, BuiltinEffect::NONE)
+  },
+  {"text.release", new Builtin(new FunctionSignature(
+      "BUILTINtextRelease", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINtextRelease, BuiltinEffect::NONE)
+  },
+  {"text.concat", new Builtin(new FunctionSignature(
+      "BUILTINtextConcat", VarType::STRING, {VarType::STRING, VarType::STRING}),
+      (void*) &::BUILTINtextConcat, BuiltinEffect::NONE)
+  },
+  {"text.appendto", new Builtin(new FunctionSignature(
+      "BUILTINtextAppendTo", VarType::STRING, {VarType::STRING, VarType::STRING}),
+      (void*) &::BUILTINtextAppendTo, BuiltinEffect::NONE)
+  },
+  {"text.compare", new Builtin(new FunctionSignature(
+      "BUILTINtextCompare", VarType::INT, {VarType::STRING, VarType::STRING}),
+      (void*) &::BUILTINtextCompare, BuiltinEffect::NONE)
+  },
+  // Objets et collections
+  {"new object", new Builtin(new FunctionSignature(
+      "BUILTINobjectNew", VarType::OBJECT, {}),
+      (void*) &::BUILTINobjectNew)
+  },
+  {"new collection", new Builtin(new FunctionSignature(
+      "BUILTINcollectionNew", VarType::OBJECT, {}),
+      (void*) &::BUILTINcollectionNew)
+  },
+  {"object.retain", new Builtin(new FunctionSignature(
+      "BUILTINobjectRetain", VarType::OBJECT, {VarType::OBJECT}),
+      (void*) &::BUILTINobjectRetain, BuiltinEffect::NONE)
+  },
+  {"object.release", new Builtin(new FunctionSignature(
+      "BUILTINobjectRelease", VarType::INT, {VarType::OBJECT}),
+      (void*) &::BUILTINobjectRelease, BuiltinEffect::NONE)
+  },
+  {"ob remove", new Builtin(new FunctionSignature(
+      "BUILTINobjectRemove", VarType::INT, {VarType::OBJECT, VarType::STRING}),
+      (void*) &::BUILTINobjectRemove)
+  },
+  // Accès aux attributs et aux éléments : valeurs de 64 bits de genre
+  // FOURDVALUE_*, appelées par GETV et SETV dans le bytecode
+  {"object.get", new Builtin(new FunctionSignature(
+      "BUILTINobjectGet", VarType::LONG, {VarType::OBJECT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINobjectGet, BuiltinEffect::NONE)
+  },
+  {"object.set", new Builtin(new FunctionSignature(
+      "BUILTINobjectSet", VarType::OBJECT, {VarType::OBJECT, VarType::INT, VarType::INT, VarType::LONG}),
+      (void*) &::BUILTINobjectSet)
+  },
+  {"object.keyof", new Builtin(new FunctionSignature(
+      "BUILTINobjectKeyOf", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINobjectKeyOf, BuiltinEffect::NONE)
+  },
+  {"object.findkey", new Builtin(new FunctionSignature(
+      "BUILTINobjectFindKey", VarType::INT, {VarType::STRING}),
+      (void*) &::BUILTINobjectFindKey, BuiltinEffect::NONE)
+  },
+  {"collection.get", new Builtin(new FunctionSignature(
+      "BUILTINcollectionGet", VarType::LONG, {VarType::OBJECT, VarType::INT, VarType::INT}),
+      (void*) &::BUILTINcollectionGet, BuiltinEffect::NONE)
+  },
+  {"collection.set", new Builtin(new FunctionSignature(
+      "BUILTINcollectionSet", VarType::OBJECT, {VarType::OBJECT, VarType::INT, VarType::INT, VarType::LONG}),
+      (void*) &::BUILTINcollectionSet)
+  },
+  {"collection.insert", new Builtin(new FunctionSignature(
+      "BUILTINcollectionInsert", VarType::OBJECT, {VarType::OBJECT, VarType::INT, VarType::INT, VarType::LONG}),
+      (void*) &::BUILTINcollectionInsert)
+  },
+  {"json parse", new Builtin(new FunctionSignature(
+      "BUILTINjsonParse", VarType::OBJECT, {VarType::STRING}),
+      (void*) &::BUILTINjsonParse)
+  },
+  {"json stringify", new Builtin(new FunctionSignature(
+      "BUILTINjsonStringify", VarType::STRING, {VarType::OBJECT}),
+      (void*) &::BUILTINjsonStringify, BuiltinEffect::NONE)
   }
 };
 
 
 
-Builtin::Builtin(FunctionSignature* signature, void* ptr)
-  : _signature(signature), _ptr(ptr)
+Builtin::Builtin(FunctionSignature* signature, void* ptr, BuiltinEffect effect)
+  : _signature(signature), _ptr(ptr), _effect(effect)
 {}
 Builtin::~Builtin() = default;
 
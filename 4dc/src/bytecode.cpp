@@ -0,0 +1,172 @@
+#include "../include/bytecode.h"
+#include "../include/func.h"
+#include "../include/functionsignature.h"
+#include "../include/util/util.h"
+#include <cassert>
+#include <cstring>
+
+using namespace std;
+
+BytecodeBuilder::BytecodeBuilder(
+    Bytecode& bytecode,
+    const vector<Func*>& methods,
+    const map<string, int32_t*>& globalVars,
+    const map<string, int32_t*>& persistentVars
+)
+  : _bytecode(bytecode), _methods(methods),
+    _globalVars(globalVars), _persistentVars(persistentVars),
+    _stack(0)
+{
+  // $0 et les arguments occupent les premières cases
+  for (unsigned i = 0; i <= bytecode.argsNumber; ++i) {
+    this->_slots[Util::toS(i)] = i;
+  }
+  bytecode.slots = bytecode.argsNumber + 1;
+}
+BytecodeBuilder::~BytecodeBuilder() = default;
+
+unsigned BytecodeBuilder::emit(OpCode op, int32_t arg, void* ptr)
+{
+  // Suivi de la profondeur de pile pour dimensionner les cadres d'appel
+  switch (op) {
+  case OpCode::PUSH:
+  case OpCode::CONST:
+  case OpCode::LOAD:
+  case OpCode::LOADG:
+  case OpCode::LOADGW:
+    ++this->_stack;
+    break;
+  case OpCode::CALL:
+    this->_stack -= this->argsNumber(arg);
+    ++this->_stack;
+    break;
+  case OpCode::BUILTIN:
+    this->_stack -= arg;
+    ++this->_stack;
+    break;
+  case OpCode::SETV:
+  case OpCode::SETP:
+    this->_stack -= 2;
+    break;
+  case OpCode::NEG:
+  case OpCode::NEGR:
+  case OpCode::NEGL:
+  case OpCode::ITOR:
+  case OpCode::RTOI:
+  case OpCode::LTOI:
+  case OpCode::LTOR:
+  case OpCode::RTOL:
+  case OpCode::MATH:
+  case OpCode::BUILTINR:
+  case OpCode::BUILTINL:
+  case OpCode::RBUILTIN:
+  case OpCode::JUMP:
+    break;
+  default:
+    // Opérateurs binaires, STORE, POP, JUMPZ, RET, BUILTINIR
+    --this->_stack;
+    break;
+  }
+  if (this->_stack > this->_bytecode.maxStack) {
+    this->_bytecode.maxStack = this->_stack;
+  }
+  if (op == OpCode::CALL) {
+    this->_bytecode.callees.push_back(arg);
+  }
+  this->_bytecode.code.push_back(Instruction{op, arg, ptr});
+  return this->_bytecode.code.size() - 1;
+}
+
+// Empile un réel, rangé bit à bit parmi les constantes
+unsigned BytecodeBuilder::emitReal(double value)
+{
+  int64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return this->emitLong(bits);
+}
+
+// Empile une constante de 64 bits
+unsigned BytecodeBuilder::emitLong(int64_t value)
+{
+  this->_bytecode.constants.push_back(value);
+  return this->emit(OpCode::CONST, this->_bytecode.constants.size() - 1);
+}
+
+// Cache d'un accès $objet.nom, propre à l'instruction
+FourDPropertyCache* BytecodeBuilder::propertyCache()
+{
+  this->_bytecode.caches.push_back(FourDPropertyCache{0, 0});
+  return &this->_bytecode.caches.back();
+}
+
+// Conversion entre entier, entier 64 bits et réel de la valeur au sommet de la
+// pile ; toute autre valeur (booléen, texte, tableau) est un entier. Un entier
+// 32 bits est déjà étendu à 64 bits sur la pile.
+void BytecodeBuilder::emitConvert(VarType from, VarType to)
+{
+  if (from == VarType::REAL && to != VarType::REAL) {
+    this->emit(to == VarType::LONG ? OpCode::RTOL : OpCode::RTOI);
+  } else if (from == VarType::LONG && to == VarType::REAL) {
+    this->emit(OpCode::LTOR);
+  } else if (from == VarType::LONG && to != VarType::LONG) {
+    this->emit(OpCode::LTOI);
+  } else if (from != VarType::REAL && to == VarType::REAL) {
+    this->emit(OpCode::ITOR);
+  }
+}
+
+void BytecodeBuilder::patch(unsigned instruction, unsigned target)
+{
+  assert(instruction < this->_bytecode.code.size());
+  this->_bytecode.code[instruction].arg = target;
+}
+
+int BytecodeBuilder::slot(const string& name)
+{
+  auto it = this->_slots.find(name);
+  if (it != this->_slots.end()) {
+    return it->second;
+  }
+  int slot = this->newSlot();
+  this->_slots[name] = slot;
+  return slot;
+}
+
+int BytecodeBuilder::newSlot()
+{
+  return this->_bytecode.slots++;
+}
+
+int32_t* BytecodeBuilder::globalVar(const string& name) const
+{
+  auto it = this->_globalVars.find(name);
+  return it != this->_globalVars.end() ? it->second : nullptr;
+}
+
+int32_t* BytecodeBuilder::persistentVar(const string& name) const
+{
+  auto it = this->_persistentVars.find(name);
+  return it != this->_persistentVars.end() ? it->second : nullptr;
+}
+
+int BytecodeBuilder::method(const string& name) const
+{
+  for (unsigned i = 0; i < this->_methods.size(); ++i) {
+    if (this->_methods[i]->name() == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+unsigned BytecodeBuilder::argsNumber(int method) const
+{
+  assert(method >= 0 && (unsigned) method < this->_methods.size());
+  return this->_methods[method]->signature()->argsNumber();
+}
+
+FunctionSignature* BytecodeBuilder::signature(int method) const
+{
+  assert(method >= 0 && (unsigned) method < this->_methods.size());
+  return this->_methods[method]->signature();
+}
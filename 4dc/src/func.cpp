@@ -2,12 +2,50 @@
 #include "../include/builder.h"
 #include "../include/functionsignature.h"
 #include "../include/ast.h"
+#include "../include/bytecode.h"
+#include "../include/builtins.h"
 #include "../include/util/util.h"
 #include "../include/util/logger.h"
 
 using namespace std;
 using namespace llvm;
 
+namespace {
+  // Réels, entiers 64 bits, textes et objets gardent leur type dans la
+  // signature, le reste est entier
+  VarType signatureType(const map<string, VarType>& vars, const string& name)
+  {
+    auto it = vars.find(name);
+    if (it != vars.end() && (isWide(it->second) || it->second == VarType::STRING || it->second == VarType::OBJECT)) {
+      return it->second;
+    }
+    return VarType::INT;
+  }
+
+  // Tableau déclaré dans la méthode : $0 et les paramètres désignent ceux de
+  // l'appelant
+  bool localArray(const pair<const string, VarType>& var)
+  {
+    int num;
+    return isArray(var.second) && !Util::strConvert(var.first, num);
+  }
+
+  // Nombre d'appels de la fonction F a elle-meme
+  int countSelfCalls(Function* F)
+  {
+    int n = 0;
+    for (auto& BB : *F) {
+      for (auto& I : BB) {
+        CallInst* call = dyn_cast<CallInst>(&I);
+        if (call && call->getCalledFunction() == F) {
+          ++n;
+        }
+      }
+    }
+    return n;
+  }
+}
+
 Func::Func(const string& name, BlocAST* body)
   : _name(Util::trim(Util::downcase(string(name)))),
     _signature(nullptr), _body(body)
@@ -28,10 +66,10 @@ Function* Func::create(FunctionSignature* signature, Builder& b)
   const string& name = signature->name();
   vector<Type*> argsType(signature->argsNumber());
   for (int i = 0; i < signature->argsNumber(); ++i) {
-    argsType[i] = Type::getInt32Ty(b.context()); //should be return type.getType();
+    argsType[i] = b.type(signature->argsType()[i]);
   }
   
-  Type* retType = Type::getInt32Ty(b.context()); // should be signature->returnType().getType();
+  Type* retType = b.type(signature->returnType());
   
   
   FunctionType *FT = FunctionType::get(retType, argsType, false);
@@ -67,14 +105,28 @@ Function* Func::create(FunctionSignature* signature, Builder& b)
 
 void Func::taggingPass(
     map<string, VarType>& globaleVars,
-    map<string, VarType>& persistentVars
+    map<string, VarType>& persistentVars,
+    const map<string, VarType>& returnTypes,
+    map<string, VarType>& propertyTypes
 )
 {
   Logger::debug << "  Passe de tag de la fonction " << _name << endl;
   map<int, VarType> argVars;
   
   Logger::debug << "    Parcours du corps de la fonction... ";
-  this->_body->taggingPass(argVars, _localVars, globaleVars, persistentVars);
+  // Parcours répétés jusqu'à ce que les types ne changent plus : les
+  // occurrences précédant la première affectation d'une variable prennent son
+  // type, une variable numérique affectée d'un réel devient réelle partout.
+  map<string, VarType> previousLocals, previousGlobals, previousPersistents;
+  int passes = 0;
+  do {
+    previousLocals = _localVars;
+    previousGlobals = globaleVars;
+    previousPersistents = persistentVars;
+    this->_body->taggingPass(argVars, _localVars, globaleVars, persistentVars, returnTypes, propertyTypes);
+    ++passes;
+  } while (passes < 2 || (passes < 8 && (previousLocals != _localVars || previousGlobals != globaleVars
+                                         || previousPersistents != persistentVars)));
   Logger::debug << "OK" << endl;
   
   Logger::debug << "    Analyse des variables... ";
@@ -86,23 +138,14 @@ void Func::taggingPass(
     }
   }
   
-  //VarType type;
-  VarType returnType = VarType::INT; // should be VOID
+  VarType returnType = signatureType(_localVars, "0"); // should be VOID without $0
   VarType variadicArgsType = VarType::VOID;
-  vector<VarType> argsType(nbArgs, VarType::INT); // should be VOID
-  
-  /*
-  for (auto& pairVar : argVars) {
-    int num = pairVar.first;
-    type = pairVar.second;
-    if (num == 0) {
-      returnType = type;
-    } else {
-      argsType[num] = type;
-    }
+  vector<VarType> argsType(nbArgs);
+  for (int num = 1; num <= nbArgs; ++num) {
+    argsType[num - 1] = signatureType(_localVars, Util::toS(num));
   }
-  */
   Logger::debug << "OK" << endl;
+  if (this->_signature) delete this->_signature;
   this->_signature = new FunctionSignature(this->_name, returnType, argsType, variadicArgsType);
   
   Logger::debug << "  Fin de la passe de tag" << endl;
@@ -140,7 +183,7 @@ Function* Func::Codegen(Builder& b)
       string s = Util::toS(i);
       Alloca = b.localVars()[s];
       assert(Alloca != nullptr);
-      b.irbuilder().CreateStore(&arg, Alloca);
+      b.irbuilder().CreateStore(b.convert(&arg, Alloca->getAllocatedType()), Alloca);
     }
     ++i;
   }
@@ -154,11 +197,23 @@ Function* Func::Codegen(Builder& b)
     Logger::debug << "  Finalisation... ";
     b.irbuilder().SetInsertPoint(block);
     // Finish off the function.
+    for (auto& pairVar : _localVars) {
+      if (pairVar.second == VarType::STRING && pairVar.first != "0") {
+        b.callBuiltin("text.release", b.irbuilder().CreateLoad(b.localVars()[pairVar.first], "var.text"));
+      }
+      if (pairVar.second == VarType::OBJECT && pairVar.first != "0") {
+        b.callBuiltin("object.release", b.irbuilder().CreateLoad(b.localVars()[pairVar.first], "var.object"));
+      }
+      if (localArray(pairVar)) {
+        b.callBuiltin("array.release", b.irbuilder().CreateLoad(b.localVars()[pairVar.first], "var.array"));
+      }
+    }
     Value* retVal = ConstantInt::get(Type::getInt32Ty(b.context()), 0);
     if (b.localVars().count("0")) {
       Alloca = b.localVars()["0"];
       retVal = b.irbuilder().CreateLoad(Alloca, "var.return");
     }
+    retVal = b.convert(retVal, F->getReturnType());
     b.irbuilder().CreateRet(retVal);
     Logger::debug << "OK" << endl;
     
@@ -169,9 +224,14 @@ Function* Func::Codegen(Builder& b)
     
     b.dumpDebug(F);
 
+    int selfCalls = countSelfCalls(F);
     Logger::debug << "  Optimisation... ";
     b.optimize(F);
     Logger::debug << "OK" << endl;
+    if (selfCalls > 0) {
+      Logger::debug << "  Recursion : " << selfCalls - countSelfCalls(F) << "/" << selfCalls
+                    << " appel(s) recursif(s) transforme(s) en boucle" << endl;
+    }
     Logger::debug << "Fonction Compilee" << endl;
 
     return F;
@@ -181,6 +241,45 @@ Function* Func::Codegen(Builder& b)
 }
 
 
+bool Func::Bytecodegen(BytecodeBuilder& bb)
+{
+  Logger::debug << "Generation du bytecode de la fonction " << *_signature << endl;
+  if (!this->_body->Bytecodegen(bb)) {
+    return false;
+  }
+  // Les textes et les objets des variables locales sont rendus, sauf $0 qui
+  // passe à l'appelant, et les tableaux locaux libérés
+  Builtin* release = Builtin::getList()["text.release"];
+  Builtin* releaseObject = Builtin::getList()["object.release"];
+  Builtin* releaseArray = Builtin::getList()["array.release"];
+  for (auto& pairVar : _localVars) {
+    if (pairVar.second == VarType::STRING && pairVar.first != "0") {
+      bb.emit(OpCode::LOAD, bb.slot(pairVar.first));
+      bb.emit(OpCode::BUILTIN, release->signature()->argsNumber(), release->getPtr());
+      bb.emit(OpCode::POP);
+    }
+    if (pairVar.second == VarType::OBJECT && pairVar.first != "0") {
+      bb.emit(OpCode::LOAD, bb.slot(pairVar.first));
+      bb.emit(OpCode::BUILTIN, releaseObject->signature()->argsNumber(), releaseObject->getPtr());
+      bb.emit(OpCode::POP);
+    }
+    if (localArray(pairVar)) {
+      bb.emit(OpCode::LOAD, bb.slot(pairVar.first));
+      bb.emit(OpCode::BUILTIN, releaseArray->signature()->argsNumber(), releaseArray->getPtr());
+      bb.emit(OpCode::POP);
+    }
+  }
+  // Valeur de retour : $0, ou 0 si elle n'est jamais affectée
+  if (this->_localVars.count("0")) {
+    bb.emit(OpCode::LOAD, bb.slot("0"));
+  } else {
+    bb.emit(OpCode::PUSH, 0);
+  }
+  bb.emit(OpCode::RET);
+  return true;
+}
+
+
 std::ostream& operator<<(std::ostream& out, const Func& f)
 {
   if (f._signature) {
@@ -0,0 +1,401 @@
+#include "../include/interpreter.h"
+#include "../include/compileerror.h"
+#include "../include/func.h"
+#include "../include/functionsignature.h"
+#include "../include/util/logger.h"
+#include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+  // Un réel occupe une valeur de la pile bit à bit
+  inline double real(int64_t value)
+  {
+    double d;
+    memcpy(&d, &value, sizeof(d));
+    return d;
+  }
+
+  inline int64_t bits(double d)
+  {
+    int64_t value;
+    memcpy(&value, &d, sizeof(value));
+    return value;
+  }
+
+  // Troncature, comme fptosi ; hors de l'intervalle des entiers : INT_MIN
+  inline int32_t truncate(double d)
+  {
+    return d > -2147483649.0 && d < 2147483648.0 ? static_cast<int32_t>(d) : INT_MIN;
+  }
+
+  inline int64_t truncateLong(double d)
+  {
+    return d >= -9223372036854775808.0 && d < 9223372036854775808.0 ? static_cast<int64_t>(d) : LLONG_MIN;
+  }
+
+  // Arguments entiers d'un appel natif
+  inline const int32_t* narrow(const int64_t* values, unsigned n, int32_t* args)
+  {
+    for (unsigned i = 0; i < n; ++i) {
+      args[i] = static_cast<int32_t>(values[i]);
+    }
+    return args;
+  }
+}
+
+Interpreter::Interpreter(unsigned threshold, Compiler compiler)
+  : _threshold(threshold), _compiler(compiler), _stop(false), _depth(0)
+{
+  this->_thread = thread(&Interpreter::compileLoop, this);
+}
+
+Interpreter::~Interpreter()
+{
+  // Une compilation en cours se termine avant l'arrêt du thread
+  {
+    lock_guard<mutex> lock(this->_mutex);
+    this->_stop = true;
+  }
+  this->_cond.notify_one();
+  this->_thread.join();
+}
+
+bool Interpreter::load(
+    const vector<Func*>& methods,
+    const map<string, int32_t*>& globalVars,
+    const map<string, int32_t*>& persistentVars
+)
+{
+  for (unsigned i = 0; i < methods.size(); ++i) {
+    unique_ptr<Method> m(new Method());
+    m->index = i;
+    m->bytecode.name = methods[i]->name();
+    m->bytecode.argsNumber = methods[i]->signature()->argsNumber();
+    FunctionSignature* signature = methods[i]->signature();
+    m->intSignature = !isWide(signature->returnType());
+    for (VarType type : signature->argsType()) {
+      m->intSignature = m->intSignature && !isWide(type);
+    }
+    m->requested = m->bytecode.argsNumber > MAX_NATIVE_ARGS || !m->intSignature;
+
+    BytecodeBuilder bb(m->bytecode, methods, globalVars, persistentVars);
+    if (!methods[i]->Bytecodegen(bb)) {
+      return false;
+    }
+    Logger::debug << "Bytecode de " << m->bytecode.name << " : "
+                  << m->bytecode.code.size() << " instruction(s)" << endl;
+    this->_methods.push_back(move(m));
+  }
+  return true;
+}
+
+int64_t Interpreter::call(unsigned method, const int64_t* args)
+{
+  assert(method < this->_methods.size());
+  Method& m = *this->_methods[method];
+  void* native = m.native.load(memory_order_acquire);
+  if (native) {
+    int32_t nativeArgs[MAX_NATIVE_ARGS];
+    return callNative(native, m.bytecode.argsNumber, narrow(args, m.bytecode.argsNumber, nativeArgs));
+  }
+  ++m.calls;
+  if (!m.requested && this->hot(m)) {
+    this->promote(m);
+  }
+  // Récursion profonde : le code natif élimine la récursion terminale (avec
+  // accumulateur), l'interpréteur non. Une méthode sans appel natif possible
+  // reste interprétée.
+  if (this->_depth >= MAX_DEPTH && m.bytecode.argsNumber <= MAX_NATIVE_ARGS && m.intSignature) {
+    native = this->waitNative(m);
+    if (native) {
+      int32_t nativeArgs[MAX_NATIVE_ARGS];
+      return callNative(native, m.bytecode.argsNumber, narrow(args, m.bytecode.argsNumber, nativeArgs));
+    }
+  }
+  ++this->_depth;
+  int64_t value = this->run(m, args);
+  --this->_depth;
+  return value;
+}
+
+unsigned Interpreter::nativeMethods() const
+{
+  unsigned n = 0;
+  for (auto& m : this->_methods) {
+    if (m->native.load(memory_order_acquire)) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+int64_t Interpreter::run(Method& m, const int64_t* args)
+{
+  const Bytecode& bc = m.bytecode;
+
+  // Cadre d'appel : variables locales suivies de la pile d'évaluation. Un
+  // zéro vaut aussi 0.0 pour une variable réelle.
+  vector<int64_t> frame(bc.slots + bc.maxStack, 0);
+  int64_t* slots = frame.data();
+  int64_t* sp = slots + bc.slots;
+  int32_t nativeArgs[MAX_NATIVE_ARGS];
+  for (unsigned i = 0; i < bc.argsNumber; ++i) {
+    slots[i + 1] = args[i];
+  }
+
+  // Les opérations arithmétiques bouclent sur 32 ou 64 bits comme le code natif
+  #define BINOP(expr) sp[-2] = (expr); --sp; break
+  #define U(v) static_cast<uint32_t>(v)
+  #define UL(v) static_cast<uint64_t>(v)
+  #define REALOP(expr) sp[-2] = bits(expr); --sp; break
+  #define R(v) real(v)
+
+  const Instruction* code = bc.code.data();
+  unsigned pc = 0;
+  while (true) {
+    const Instruction& i = code[pc++];
+    switch (i.op) {
+    case OpCode::PUSH:   *sp++ = i.arg; break;
+    case OpCode::CONST:  *sp++ = bc.constants[i.arg]; break;
+    case OpCode::LOAD:   *sp++ = slots[i.arg]; break;
+    case OpCode::STORE:  slots[i.arg] = *--sp; break;
+    case OpCode::LOADG:  *sp++ = *static_cast<int32_t*>(i.ptr); break;
+    case OpCode::STOREG: *static_cast<int32_t*>(i.ptr) = static_cast<int32_t>(*--sp); break;
+    case OpCode::LOADGW:  *sp++ = *static_cast<int64_t*>(i.ptr); break;
+    case OpCode::STOREGW: *static_cast<int64_t*>(i.ptr) = *--sp; break;
+    case OpCode::POP:    --sp; break;
+
+    case OpCode::ADD: BINOP(static_cast<int32_t>(U(sp[-2]) + U(sp[-1])));
+    case OpCode::SUB: BINOP(static_cast<int32_t>(U(sp[-2]) - U(sp[-1])));
+    case OpCode::MUL: BINOP(static_cast<int32_t>(U(sp[-2]) * U(sp[-1])));
+    case OpCode::DIV:
+      if (sp[-1] == 0 || (sp[-2] == INT_MIN && sp[-1] == -1)) {
+        Logger::error << "Runtime Error: Division by zero in \"" << bc.name << "\"" << endl;
+        exit(EXIT_FAILURE);
+      }
+      BINOP(sp[-2] / sp[-1]);
+    case OpCode::NEG: sp[-1] = static_cast<int32_t>(0u - U(sp[-1])); break;
+
+    case OpCode::LT: BINOP(sp[-2] <  sp[-1]);
+    case OpCode::LE: BINOP(sp[-2] <= sp[-1]);
+    case OpCode::GT: BINOP(sp[-2] >  sp[-1]);
+    case OpCode::GE: BINOP(sp[-2] >= sp[-1]);
+    case OpCode::EQ: BINOP(sp[-2] == sp[-1]);
+    case OpCode::NE: BINOP(sp[-2] != sp[-1]);
+    case OpCode::AND: BINOP(sp[-2] & sp[-1]);
+    case OpCode::OR:  BINOP(sp[-2] | sp[-1]);
+
+    case OpCode::ADDL: BINOP(static_cast<int64_t>(UL(sp[-2]) + UL(sp[-1])));
+    case OpCode::SUBL: BINOP(static_cast<int64_t>(UL(sp[-2]) - UL(sp[-1])));
+    case OpCode::MULL: BINOP(static_cast<int64_t>(UL(sp[-2]) * UL(sp[-1])));
+    case OpCode::DIVL:
+      if (sp[-1] == 0 || (sp[-2] == LLONG_MIN && sp[-1] == -1)) {
+        Logger::error << "Runtime Error: Division by zero in \"" << bc.name << "\"" << endl;
+        exit(EXIT_FAILURE);
+      }
+      BINOP(sp[-2] / sp[-1]);
+    case OpCode::NEGL: sp[-1] = static_cast<int64_t>(0ull - UL(sp[-1])); break;
+    case OpCode::LTOI: sp[-1] = static_cast<int32_t>(sp[-1]); break;
+    case OpCode::LTOR: sp[-1] = bits(static_cast<double>(sp[-1])); break;
+    case OpCode::RTOL: sp[-1] = truncateLong(R(sp[-1])); break;
+
+    case OpCode::ADDR: REALOP(R(sp[-2]) + R(sp[-1]));
+    case OpCode::SUBR: REALOP(R(sp[-2]) - R(sp[-1]));
+    case OpCode::MULR: REALOP(R(sp[-2]) * R(sp[-1]));
+    case OpCode::DIVR: REALOP(R(sp[-2]) / R(sp[-1]));
+    case OpCode::NEGR: sp[-1] = bits(-R(sp[-1])); break;
+    case OpCode::LTR: BINOP(R(sp[-2]) <  R(sp[-1]));
+    case OpCode::LER: BINOP(R(sp[-2]) <= R(sp[-1]));
+    case OpCode::GTR: BINOP(R(sp[-2]) >  R(sp[-1]));
+    case OpCode::GER: BINOP(R(sp[-2]) >= R(sp[-1]));
+    case OpCode::EQR: BINOP(R(sp[-2]) == R(sp[-1]));
+    case OpCode::NER: BINOP(R(sp[-2]) != R(sp[-1]));
+    case OpCode::ITOR: sp[-1] = bits(static_cast<int32_t>(sp[-1])); break;
+    case OpCode::RTOI: sp[-1] = truncate(R(sp[-1])); break;
+    case OpCode::MATH:
+      sp[-1] = bits(reinterpret_cast<double (*)(double)>(i.ptr)(R(sp[-1])));
+      break;
+
+    case OpCode::JUMPZ:
+      if (*--sp != 0) {
+        break;
+      }
+      // pas de break : saut
+    case OpCode::JUMP:
+      // Retour en arrière : une itération de boucle de plus
+      if (static_cast<unsigned>(i.arg) < pc) {
+        ++m.backEdges;
+        if (!m.requested && this->hot(m)) {
+          this->promote(m);
+        }
+      }
+      pc = i.arg;
+      break;
+
+    case OpCode::CALL:
+      sp -= this->_methods[i.arg]->bytecode.argsNumber;
+      *sp = this->call(i.arg, sp);
+      ++sp;
+      break;
+    case OpCode::BUILTIN:
+      sp -= i.arg;
+      *sp = callNative(i.ptr, i.arg, narrow(sp, i.arg, nativeArgs));
+      ++sp;
+      break;
+    case OpCode::BUILTINR:
+      sp[-1] = reinterpret_cast<int32_t (*)(double)>(i.ptr)(R(sp[-1]));
+      break;
+    case OpCode::BUILTINL:
+      sp[-1] = reinterpret_cast<int32_t (*)(int64_t)>(i.ptr)(sp[-1]);
+      break;
+    case OpCode::BUILTINIR:
+      sp[-2] = reinterpret_cast<int32_t (*)(int32_t, double)>(i.ptr)(static_cast<int32_t>(sp[-2]), R(sp[-1]));
+      --sp;
+      break;
+    case OpCode::RBUILTIN:
+      sp[-1] = bits(reinterpret_cast<double (*)(int32_t)>(i.ptr)(static_cast<int32_t>(sp[-1])));
+      break;
+    case OpCode::GETV:
+      sp[-2] = reinterpret_cast<int64_t (*)(int32_t, int32_t, int32_t)>(i.ptr)(
+                 static_cast<int32_t>(sp[-2]), static_cast<int32_t>(sp[-1]), i.arg);
+      --sp;
+      break;
+    case OpCode::SETV:
+      sp[-3] = reinterpret_cast<int32_t (*)(int32_t, int32_t, int32_t, int64_t)>(i.ptr)(
+                 static_cast<int32_t>(sp[-2]), static_cast<int32_t>(sp[-1]), i.arg, sp[-3]);
+      sp -= 2;
+      break;
+    case OpCode::GETP:
+      sp[-2] = BUILTINobjectGetCached(static_cast<int32_t>(sp[-2]), static_cast<int32_t>(sp[-1]), i.arg,
+                                      static_cast<FourDPropertyCache*>(i.ptr));
+      --sp;
+      break;
+    case OpCode::SETP:
+      sp[-3] = BUILTINobjectSetCached(static_cast<int32_t>(sp[-2]), static_cast<int32_t>(sp[-1]), i.arg, sp[-3],
+                                      static_cast<FourDPropertyCache*>(i.ptr));
+      sp -= 2;
+      break;
+
+    case OpCode::RET:
+      return *--sp;
+    }
+  }
+
+  #undef BINOP
+  #undef U
+  #undef UL
+  #undef REALOP
+  #undef R
+}
+
+void Interpreter::promote(Method& m)
+{
+  m.requested = true;
+  Logger::debug << "Methode " << m.bytecode.name << " chaude (" << m.calls << " appel(s), "
+                << m.backEdges << " iteration(s)) : compilation en arriere-plan" << endl;
+  {
+    lock_guard<mutex> lock(this->_mutex);
+    this->_queue.push_back(m.index);
+  }
+  this->_cond.notify_one();
+}
+
+void* Interpreter::waitNative(Method& m)
+{
+  if (!m.requested) {
+    this->promote(m);
+  }
+  Logger::debug << "Recursion profonde dans " << m.bytecode.name << " : attente du code natif" << endl;
+  unique_lock<mutex> lock(this->_mutex);
+  this->_compiledCond.wait(lock, [&m] {return m.compiled;});
+  return m.native.load(memory_order_acquire);
+}
+
+bool Interpreter::reachable(unsigned method, vector<unsigned>& methods) const
+{
+  // Le JIT compile une méthode avec toutes celles qu'elle peut appeler : si
+  // l'une d'elles n'a pas pu être compilée, la méthode reste interprétée
+  vector<bool> seen(this->_methods.size(), false);
+  vector<unsigned> todo{method};
+  seen[method] = true;
+  while (!todo.empty()) {
+    unsigned i = todo.back();
+    todo.pop_back();
+    if (this->_methods[i]->failed) {
+      return false;
+    }
+    if (!this->_methods[i]->compiled) {
+      methods.push_back(i);
+    }
+    for (unsigned callee : this->_methods[i]->bytecode.callees) {
+      if (!seen[callee]) {
+        seen[callee] = true;
+        todo.push_back(callee);
+      }
+    }
+  }
+  return true;
+}
+
+void Interpreter::compileLoop()
+{
+  unique_lock<mutex> lock(this->_mutex);
+  while (true) {
+    this->_cond.wait(lock, [this] {return this->_stop || !this->_queue.empty();});
+    if (this->_stop) {
+      return;
+    }
+    unsigned method = this->_queue.front();
+    this->_queue.pop_front();
+    lock.unlock();
+
+    vector<unsigned> methods;
+    vector<void*> code;
+    bool failed = !this->reachable(method, methods);
+    if (failed) {
+      methods = {method};
+    } else if (!methods.empty()) {
+      try {
+        this->_compiler(methods, code);
+        assert(code.size() == methods.size());
+      } catch (const CompileError& e) {
+        // Erreur tardive : l'exécution continue dans l'interpréteur
+        Logger::error << e.what() << endl;
+        failed = true;
+      }
+    }
+
+    // Les appels suivants de ces méthodes passent par le code natif
+    lock.lock();
+    for (unsigned i = 0; i < methods.size(); ++i) {
+      Method& m = *this->_methods[methods[i]];
+      m.compiled = true;
+      m.failed = failed;
+      if (!failed && m.bytecode.argsNumber <= MAX_NATIVE_ARGS && m.intSignature) {
+        m.native.store(code[i], memory_order_release);
+      }
+    }
+    this->_compiledCond.notify_all();
+  }
+}
+
+int32_t Interpreter::callNative(void* f, unsigned argc, const int32_t* a)
+{
+  typedef int32_t I;
+  intptr_t p = reinterpret_cast<intptr_t>(f);
+  switch (argc) {
+  case 0: return reinterpret_cast<I (*)()>(p)();
+  case 1: return reinterpret_cast<I (*)(I)>(p)(a[0]);
+  case 2: return reinterpret_cast<I (*)(I, I)>(p)(a[0], a[1]);
+  case 3: return reinterpret_cast<I (*)(I, I, I)>(p)(a[0], a[1], a[2]);
+  case 4: return reinterpret_cast<I (*)(I, I, I, I)>(p)(a[0], a[1], a[2], a[3]);
+  case 5: return reinterpret_cast<I (*)(I, I, I, I, I)>(p)(a[0], a[1], a[2], a[3], a[4]);
+  case 6: return reinterpret_cast<I (*)(I, I, I, I, I, I)>(p)(a[0], a[1], a[2], a[3], a[4], a[5]);
+  }
+  Logger::critical << "Critical Error: Appel natif a " << argc << " arguments non supporte" << endl;
+  exit(EXIT_FAILURE);
+}
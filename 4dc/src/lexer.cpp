@@ -4,6 +4,7 @@
 #include <cassert>
 #include "../include/util/logger.h"
 #include "../include/util/util.h"
+#include "../include/compileerror.h"
 
 /**
  * Helpers
@@ -43,6 +44,9 @@ Token Lexer::nextToken()
   // Identificateur (nom de variable, de fonctions)
   if (isAlpha(this->_chr) || this->_chr == '_') return this->eatIdToken();
 
+  // Attribut d'objet : .nom, la casse est conservée
+  if (this->_chr == '.' && (isAlpha(this->_in.peek()) || this->_in.peek() == '_')) return this->eatPropertyToken();
+
   // Nombre
   if (isDigit(this->_chr) || this->_chr == '.') return this->eatNumToken();
 
@@ -78,6 +82,9 @@ Token Lexer::eatIdToken()
   
   if (this->_str == "repeat") return TokenType::REPEAT;
   if (this->_str == "until") return TokenType::UNTIL;
+
+  if (this->_str == "case of") return TokenType::CASEOF;
+  if (this->_str == "end case") return TokenType::ENDCASE;
   
   return Token(TokenType::ID, this->_str);
 }
@@ -103,14 +110,34 @@ Token Lexer::eatNumToken()
   return Token(TokenType::NUM, this->_str);
 }
 
+Token Lexer::eatPropertyToken()
+{
+  this->eatChr();
+  this->_str = "";
+  while (isAlphaNum(this->_chr) || this->_chr == '_') {
+    this->eatChr();
+  }
+  return Token(TokenType::PROPERTY, this->_str);
+}
+
 Token Lexer::eatStringToken()
 {
   this->eatChr();
   this->_str = "";
   while (this->_chr != '"') {
     if (this->_chr == EOF) {
-      Logger::error << "Lexer Error: Expected '\"' but found EOF" << std::endl;
-      exit(EXIT_FAILURE);
+      throw CompileError("Lexer Error: Expected '\"' but found EOF");
+    }
+    // Séquences d'échappement de 4D : \" \\ \n \r \t
+    if (this->_chr == '\\') {
+      this->eatChr();
+      this->_str.pop_back();
+      if (this->_chr == EOF) {
+        throw CompileError("Lexer Error: Expected '\"' but found EOF");
+      }
+      if (this->_chr == 'n') this->_chr = '\n';
+      else if (this->_chr == 'r') this->_chr = '\r';
+      else if (this->_chr == 't') this->_chr = '\t';
     }
     this->eatChr();
   }
@@ -141,6 +168,10 @@ Token Lexer::eatSymbolToken()
     return TokenType::LEFTB;
   case '}':
     return TokenType::RIGHTB;
+  case '[':
+    return TokenType::LEFTSB;
+  case ']':
+    return TokenType::RIGHTSB;
   case ';':
     return TokenType::SEMICOL;
   case ':':
@@ -176,8 +207,7 @@ Token Lexer::eatOpToken()
            && !isEndLine(this->_chr) && this->_chr != EOF) {
       eatChr();
     }
-    Logger::error << "Lexer Error: Unknown Token " << str << std::endl;
-    exit(EXIT_FAILURE);
+    throw CompileError("Lexer Error: Unknown Token " + str);
   }
   return Token(TokenType::OP, str);
 }
@@ -0,0 +1,222 @@
+#include "../include/lib4dc.h"
+#include "../include/builder.h"
+#include "../include/compileerror.h"
+#include "../include/func.h"
+#include "../include/functionsignature.h"
+#include "../include/interpreter.h"
+#include "../include/options.h"
+#include "../include/util/util.h"
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+using namespace llvm;
+
+struct fourdc_error
+{
+  string message;
+};
+
+struct fourdc_method
+{
+  void* code;
+  unsigned argsNumber;
+};
+
+struct fourdc_context
+{
+  fourdc_context();
+  void configure();
+  void compile();
+  const fourdc_method* lookup(const string& name);
+
+  LLVMContext ctx; // construit avant le Builder
+  Builder builder;
+  Options options;
+  vector<pair<string, string>> sources; // nom, source
+  map<string, unsigned> argsNumbers;
+  map<string, unique_ptr<fourdc_method>> methods;
+  bool compiled;
+};
+
+namespace {
+  // Le runtime (BUILTINtexts, BUILTINarrays, BUILTINobjects...) est global :
+  // compilations et appels de tous les contextes sont sérialisés
+  mutex runtimeLock;
+  
+  fourdc_error* error(const string& message)
+  {
+    return new fourdc_error{message};
+  }
+  
+  string methodName(const string& name)
+  {
+    return Util::trim(Util::downcase(string(name)));
+  }
+}
+
+fourdc_context::fourdc_context()
+  : builder("lib4dc", ctx), compiled(false)
+{}
+
+void fourdc_context::compile()
+{
+  this->builder.setOptLevel(this->options.optLevel(), this->options.sizeLevel());
+  this->builder.setTarget(this->options.targetCPU(), this->options.targetFeatures());
+  this->builder.setFastMath(this->options.fastMath());
+  this->builder.setLazyCompilation(this->options.lazyCompilation());
+  this->builder.createJIT();
+  this->builder.setOptimizer(this->builder.getStandardOptimizer());
+  this->builder.setModuleOptimizer(this->builder.getStandardModuleOptimizer(this->options.inlineThreshold()));
+  
+  map<string, VarType> globalVars, persistentVars;
+  vector<unique_ptr<Func>> methods;
+  for (auto& source : this->sources) {
+    istringstream in(source.second);
+    methods.emplace_back(this->builder.parse(globalVars, persistentVars, source.first, in));
+  }
+  vector<Func*> defs;
+  for (auto& Fdef : methods) {
+    defs.push_back(Fdef.get());
+  }
+  this->builder.taggingPass(defs, globalVars, persistentVars);
+  this->builder.declareBuiltins();
+  this->builder.createGlobals(globalVars, this->builder.globalVars());
+  this->builder.createGlobals(persistentVars, this->builder.persistentVars());
+  
+  vector<Function*> functions;
+  for (auto& Fdef : methods) {
+    functions.push_back(this->builder.build(Fdef.get()));
+    this->argsNumbers[Fdef->name()] = Fdef->signature()->argsNumber();
+  }
+  // Toutes les méthodes restent accessibles depuis l'hôte
+  this->builder.optimizeModule(functions, false);
+}
+
+const fourdc_method* fourdc_context::lookup(const string& name)
+{
+  auto it = this->methods.find(name);
+  if (it != this->methods.end()) {
+    return it->second.get();
+  }
+  Function* F = this->builder.module().getFunction(name);
+  if (!F || F->empty() || !this->argsNumbers.count(name)) {
+    throw CompileError("Error: Unknown method \"" + name + "\"");
+  }
+  unsigned argsNumber = this->argsNumbers[name];
+  if (argsNumber > Interpreter::MAX_NATIVE_ARGS) {
+    throw CompileError("Error: \"" + name + "\" takes more than "
+                       + Util::toS(Interpreter::MAX_NATIVE_ARGS) + " arguments");
+  }
+  // fourdc_call ne passe que des entiers 32 bits
+  bool integers = F->getReturnType()->isIntegerTy(32);
+  for (auto& arg : F->args()) {
+    integers = integers && arg.getType()->isIntegerTy(32);
+  }
+  if (!integers) {
+    throw CompileError("Error: \"" + name + "\" takes or returns a real or a 64-bit integer");
+  }
+  fourdc_method* method = new fourdc_method{this->builder._jit->getPointerToFunction(F), argsNumber};
+  this->methods[name].reset(method);
+  return method;
+}
+
+
+extern "C" {
+
+fourdc_error* fourdc_context_create(const char* const* options, int count, fourdc_context** context)
+{
+  lock_guard<mutex> lock(runtimeLock);
+  *context = nullptr;
+  unique_ptr<fourdc_context> ctx(new fourdc_context());
+  for (int i = 0; i < count; ++i) {
+    if (!ctx->options.parse(options[i])) {
+      return error("Error: Unknown option \"" + string(options[i]) + "\"");
+    }
+  }
+  const Options& opts = ctx->options;
+  if (opts.emitKind() != EmitKind::NONE || opts.tiered() || opts.background() || opts.session()
+      || !opts.cacheDirectory().empty()) {
+    return error("Error: --emit, --tiered, --background, --session et --cache ne sont pas disponibles dans lib4dc");
+  }
+  *context = ctx.release();
+  return nullptr;
+}
+
+void fourdc_context_dispose(fourdc_context* context)
+{
+  lock_guard<mutex> lock(runtimeLock);
+  delete context;
+}
+
+fourdc_error* fourdc_add_method(fourdc_context* context, const char* name, const char* source, size_t length)
+{
+  if (context->compiled) {
+    return error("Error: Methods must be added before fourdc_compile");
+  }
+  context->sources.emplace_back(methodName(name), string(source, length));
+  return nullptr;
+}
+
+fourdc_error* fourdc_compile(fourdc_context* context)
+{
+  lock_guard<mutex> lock(runtimeLock);
+  if (context->compiled) {
+    return error("Error: fourdc_compile can only be called once");
+  }
+  if (context->sources.empty()) {
+    return error("Error: No method to compile");
+  }
+  context->compiled = true;
+  try {
+    context->compile();
+  } catch (const exception& e) {
+    // Le contexte reste dans l'état de l'échec : il ne peut plus qu'être détruit
+    context->argsNumbers.clear();
+    return error(e.what());
+  }
+  return nullptr;
+}
+
+fourdc_error* fourdc_lookup(fourdc_context* context, const char* name, const fourdc_method** method)
+{
+  lock_guard<mutex> lock(runtimeLock);
+  *method = nullptr;
+  if (!context->compiled) {
+    return error("Error: fourdc_compile must be called before fourdc_lookup");
+  }
+  try {
+    *method = context->lookup(methodName(name));
+  } catch (const exception& e) {
+    return error(e.what());
+  }
+  return nullptr;
+}
+
+int fourdc_method_args(const fourdc_method* method)
+{
+  return method->argsNumber;
+}
+
+fourdc_error* fourdc_call(const fourdc_method* method, const int32_t* args, int count, int32_t* result)
+{
+  if (count < 0 || static_cast<unsigned>(count) != method->argsNumber) {
+    return error("Error: Expected " + Util::toS(method->argsNumber) + " argument(s), got " + Util::toS(count));
+  }
+  lock_guard<mutex> lock(runtimeLock);
+  *result = Interpreter::callNative(method->code, method->argsNumber, args);
+  return nullptr;
+}
+
+const char* fourdc_error_message(const fourdc_error* error)
+{
+  return error->message.c_str();
+}
+
+void fourdc_error_dispose(fourdc_error* error)
+{
+  delete error;
+}
+
+}
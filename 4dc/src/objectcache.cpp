@@ -0,0 +1,60 @@
+#include "../include/objectcache.h"
+#include "../include/util/logger.h"
+#include "../include/util/util.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace llvm;
+
+DiskObjectCache::DiskObjectCache(const string& directory, const string& target)
+  : _directory(directory), _target(target), _hits(0), _misses(0)
+{
+  sys::fs::create_directories(directory);
+}
+DiskObjectCache::~DiskObjectCache() = default;
+
+string DiskObjectCache::filename(const Module* M) const
+{
+  string ir;
+  raw_string_ostream out(ir);
+  out << this->_target << "\n";
+  M->print(out, nullptr);
+  out.flush();
+
+  stringstream name;
+  name << this->_directory << "/" << hex << setw(16) << setfill('0') << Util::hash(ir) << ".o";
+  return name.str();
+}
+
+void DiskObjectCache::notifyObjectCompiled(const Module* M, const MemoryBuffer* obj)
+{
+  // Écrit dans un fichier temporaire puis le renomme : un autre processus
+  // ne peut jamais lire un objet incomplet.
+  string path = this->filename(M);
+  string tmp = path + ".tmp";
+  ofstream out(tmp, ios::binary);
+  out.write(obj->getBufferStart(), obj->getBufferSize());
+  out.close();
+  if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+    Logger::warning << "Warning: Impossible d'ecrire \"" << path << "\" dans le cache" << endl;
+    remove(tmp.c_str());
+  }
+}
+
+MemoryBuffer* DiskObjectCache::getObject(const Module* M)
+{
+  string path = this->filename(M);
+  auto buffer = MemoryBuffer::getFile(path);
+  if (!buffer) {
+    ++this->_misses;
+    Logger::debug << "Cache : " << path << " absent, generation du code" << endl;
+    return nullptr;
+  }
+  ++this->_hits;
+  Logger::debug << "Cache : " << path << " charge" << endl;
+  // MCJIT prend le contrôle du buffer
+  return buffer.get().release();
+}
@@ -0,0 +1,160 @@
+#include "../include/options.h"
+#include "../include/util/util.h"
+#include <sstream>
+
+using namespace std;
+
+namespace {
+  // Renvoie true et place la valeur dans value si arg est de la forme "name=value"
+  bool optionValue(const string& arg, const string& name, string& value)
+  {
+    if (arg.compare(0, name.size() + 1, name + "=") != 0) {
+      return false;
+    }
+    value = arg.substr(name.size() + 1);
+    return true;
+  }
+}
+
+Options::Options()
+  : _inlineThreshold(225), _defaultInlineThreshold(true),
+    _optLevel(2), _sizeLevel(0),
+    _targetCPU("native"), _lazyCompilation(true), _fastMath(false),
+    _emitKind(EmitKind::NONE), _runtimeLibrary("lib4dcrt.a"),
+    _tiered(false), _tierThreshold(1000), _jobs(1), _background(false),
+    _session(false), _watch(false)
+{}
+Options::~Options() = default;
+
+bool Options::isOption(const string& arg)
+{
+  return arg.size() > 1 && arg[0] == '-';
+}
+
+bool Options::parse(const string& arg)
+{
+  string value;
+  if (optionValue(arg, "--inline-threshold", value)) {
+    this->_defaultInlineThreshold = false;
+    return Util::strConvert(value, this->_inlineThreshold);
+  }
+
+  // Processeur cible ("native" pour le processeur hôte, "generic"...)
+  if (optionValue(arg, "-march", value) || optionValue(arg, "-mcpu", value)) {
+    this->_targetCPU = value;
+    return !value.empty();
+  }
+  // Extensions du jeu d'instructions : "+avx2,-fma"
+  if (optionValue(arg, "-mattr", value)) {
+    stringstream ss(value);
+    string feature;
+    while (getline(ss, feature, ',')) {
+      if (feature.empty() || (feature[0] != '+' && feature[0] != '-')) {
+        return false;
+      }
+      this->_targetFeatures.push_back(feature);
+    }
+    return true;
+  }
+
+  // Compilation en code natif à la demande (par défaut) ou de tout le module
+  if (arg == "--lazy") { this->_lazyCompilation = true; return true; }
+  if (arg == "--eager") { this->_lazyCompilation = false; return true; }
+
+  // Calcul réel : réassociation, FMA et vectorisation des réductions
+  if (arg == "--fast-math") { this->_fastMath = true; return true; }
+
+  // Compilation à l'avance : --emit=obj|asm|bc|so
+  if (optionValue(arg, "--emit", value)) {
+    if (value == "obj") this->_emitKind = EmitKind::OBJ;
+    else if (value == "asm") this->_emitKind = EmitKind::ASM;
+    else if (value == "bc") this->_emitKind = EmitKind::BC;
+    else if (value == "so") this->_emitKind = EmitKind::SO;
+    else return false;
+    return true;
+  }
+  if (optionValue(arg, "--output", value)) {
+    this->_output = value;
+    return !value.empty();
+  }
+  if (optionValue(arg, "--runtime", value)) {
+    this->_runtimeLibrary = value;
+    return !value.empty();
+  }
+
+  // Exécution à deux niveaux : interpréteur, puis JIT pour les méthodes chaudes
+  if (arg == "--tiered") { this->_tiered = true; return true; }
+  if (optionValue(arg, "--tier-threshold", value)) {
+    this->_tiered = true;
+    return Util::strConvert(value, this->_tierThreshold);
+  }
+
+  // Exécution pendant la compilation des autres méthodes
+  if (arg == "--background") { this->_background = true; return true; }
+
+  // Session persistante : commandes reload, run, quit sur l'entrée standard
+  if (arg == "--session") { this->_session = true; return true; }
+  // Surveillance des fichiers : les méthodes modifiées sont remplacées à chaud
+  if (arg == "--watch") { this->_session = this->_watch = true; return true; }
+
+  // Compilation des méthodes en parallèle : -jN ou --jobs=N
+  if (arg.compare(0, 2, "-j") == 0 || optionValue(arg, "--jobs", value)) {
+    if (value.empty()) {
+      value = arg.substr(2);
+    }
+    return Util::strConvert(value, this->_jobs) && this->_jobs > 0;
+  }
+
+  // Cache sur disque du code machine généré par le JIT
+  if (optionValue(arg, "--cache", value)) {
+    this->_cacheDirectory = value;
+    return !value.empty();
+  }
+
+  // Niveaux d'optimisation
+  if (arg == "-O0") { this->setOptLevel(0); return true; }
+  if (arg == "-O1") { this->setOptLevel(1); return true; }
+  if (arg == "-O2") { this->setOptLevel(2); return true; }
+  if (arg == "-O3") { this->setOptLevel(3); return true; }
+  if (arg == "-Os") { this->setOptLevel(2, 1); return true; }
+  if (arg == "-Oz") { this->setOptLevel(2, 2); return true; }
+  return false;
+}
+
+unsigned Options::inlineThreshold() const
+{
+  if (!this->_defaultInlineThreshold) {
+    return this->_inlineThreshold;
+  }
+  // Mêmes seuils que clang pour chaque niveau d'optimisation
+  if (this->_sizeLevel == 1) return 75;
+  if (this->_sizeLevel == 2) return 25;
+  if (this->_optLevel >= 3) return 275;
+  return 225;
+}
+
+string Options::output(const string& source) const
+{
+  if (!this->_output.empty()) {
+    return this->_output;
+  }
+  switch (this->_emitKind) {
+  case EmitKind::OBJ:
+    return source + ".o";
+  case EmitKind::ASM:
+    return source + ".s";
+  case EmitKind::BC:
+    return source + ".bc";
+  case EmitKind::SO:
+    return "lib" + source + ".so";
+  default:
+    return "";
+  }
+}
+
+string Options::optLevelName() const
+{
+  if (this->_sizeLevel == 1) return "s";
+  if (this->_sizeLevel == 2) return "z";
+  return Util::toS(this->_optLevel);
+}
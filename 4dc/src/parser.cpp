@@ -1,11 +1,33 @@
 #include "../include/parser.h"
 #include "../include/lexer.h"
+#include "../include/builtins.h"
+#include "../include/functionsignature.h"
 #include "../include/util/logger.h"
 #include <typeinfo>
 #include <sstream>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+namespace {
+  // Type d'un littéral numérique : réel s'il a une partie décimale ou dépasse
+  // 64 bits, entier 64 bits s'il dépasse 32 bits
+  VarType numberType(const std::string& str)
+  {
+    if (str.find('.') != std::string::npos) {
+      return VarType::REAL;
+    }
+    errno = 0;
+    long long value = strtoll(str.c_str(), nullptr, 10);
+    if (errno == ERANGE) {
+      return VarType::REAL;
+    }
+    return value > INT_MAX ? VarType::LONG : VarType::NUMBER;
+  }
+}
 
 Parser::Parser(Lexer& lex)
-: _lexer(lex), _currentLine(1)
+: _lexer(lex), _currentLine(1), _errorLine(0)
 {
   this->eatToken();
 }
@@ -13,6 +35,9 @@ Parser::Parser(Lexer& lex)
 Parser::~Parser() = default;
 
 std::string Parser::getErrorHeader(){
+  if (this->_errorLine == 0) {
+    this->_errorLine = this->_currentLine;
+  }
   std::stringstream ss;
   ss << "Parser Error (" << this->_currentLine << "): ";
   return ss.str();
@@ -70,7 +95,7 @@ VariableAST* Parser::persistantVariable() {
   // Consomme l'identifiant
   this->eatToken(TokenType::ID);
   
-  return new PersistentVariableAST(idName);
+  return this->arrayElement(new PersistentVariableAST(idName));
 }
 
 VariableAST* Parser::localVariable() {
@@ -82,10 +107,26 @@ VariableAST* Parser::localVariable() {
   if(this->_tok == TokenType::NUM){
     std::string number = this->_tok.str();
     this->eatToken();
-    return new LocalVariableAST(idName);
+    return this->arrayElement(new LocalVariableAST(idName));
   }
   if(!this->eatToken(TokenType::ID)) return nullptr;
-  return new LocalVariableAST(idName);
+  return this->arrayElement(new LocalVariableAST(idName));
+}
+
+// Élément de tableau : la variable est suivie de {index}
+VariableAST* Parser::arrayElement(VariableAST* array) {
+  if (this->_tok != TokenType::LEFTB) {
+    return array;
+  }
+  // Consomme l'accolade ouvrante
+  this->eatToken();
+  ExprAST* index = this->expression();
+  if (!index || !this->eatToken(TokenType::RIGHTB)) {
+    delete array;
+    delete index;
+    return nullptr;
+  }
+  return new ArrayElementAST(array, index);
 }
 
 ExprAST* Parser::identifier() {
@@ -94,9 +135,16 @@ ExprAST* Parser::identifier() {
   // Consomme l'identifieur
   this->eatToken();
 
+  // Builtin sans argument appelé sans parenthèses : New object, New collection
+  auto builtin = Builtin::getList().find(idName);
+  if (this->_tok != TokenType::LEFTP && builtin != Builtin::getList().end()
+      && builtin->second->signature()->argsNumber() == 0) {
+    return new CallAST(idName, {});
+  }
+
   // Simple identifer
   if (this->_tok != TokenType::LEFTP) {
-    return new GlobaleVariableAST(idName);
+    return this->arrayElement(new GlobaleVariableAST(idName));
   }
   
   // Appel de fonction
@@ -105,15 +153,21 @@ ExprAST* Parser::identifier() {
 }
 
 ExprAST* Parser::callFunction(std::string functionName){
+  std::vector<ExprAST*> args;
+  if (!this->callArguments(args)) return nullptr;
+  return new CallAST(functionName, args);  
+}
+
+// Arguments d'un appel, parenthèses comprises
+bool Parser::callArguments(std::vector<ExprAST*>& args){
 
   // Appel de fonction
   // Consomme la parenthèse ouvrante
   this->eatToken();
-  std::vector<ExprAST*> args;
   if (this->_tok != TokenType::RIGHTP) {
     while (true) {
       ExprAST* arg = this->expression();
-      if (!arg) return nullptr; // Propage l'erreur
+      if (!arg) return false; // Propage l'erreur
       args.push_back(arg);
 
       if (this->_tok == TokenType::RIGHTP) {
@@ -122,16 +176,47 @@ ExprAST* Parser::callFunction(std::string functionName){
 
       if (!this->eatToken(TokenType::SEMICOL)){
         Logger::error << this->getErrorHeader() << " or " << TokenType::RIGHTP << std::endl;
-        return nullptr;
+        return false;
       }
     }
   }
 
   // Consomme la parenthèse fermante
   this->eatToken();
+  return true;
+}
 
-
-  return new CallAST(functionName, args);  
+// Attributs et éléments d'un objet ou d'une collection : $o.nom, $o["nom"],
+// $c[index], et méthodes des collections : $c.push(valeur)
+ExprAST* Parser::property(ExprAST* object) {
+  while (object && (this->_tok == TokenType::PROPERTY || this->_tok == TokenType::LEFTSB)) {
+    if (this->_tok == TokenType::PROPERTY) {
+      std::string name = this->_tok.str();
+      // Consomme l'attribut
+      this->eatToken();
+      if (this->_tok != TokenType::LEFTP) {
+        object = new PropertyAST(object, name);
+        continue;
+      }
+      std::vector<ExprAST*> args;
+      if (!this->callArguments(args)) {
+        delete object;
+        return nullptr;
+      }
+      object = new MemberCallAST(object, name, args);
+      continue;
+    }
+    // Consomme le crochet ouvrant
+    this->eatToken();
+    ExprAST* key = this->expression();
+    if (!key || !this->eatToken(TokenType::RIGHTSB)) {
+      delete object;
+      delete key;
+      return nullptr;
+    }
+    object = new PropertyAST(object, key);
+  }
+  return object;
 }
 
 
@@ -151,6 +236,8 @@ BlocAST* Parser::bloc() {
       case TokenType::ENDFOR:
       case TokenType::ENDWHILE:
       case TokenType::UNTIL:
+      case TokenType::COLON:
+      case TokenType::ENDCASE:
     return new BlocAST(statements); // sort du block
       case TokenType::ENDL: // ne lit pas les lignes vides
     this->eatToken();
@@ -167,6 +254,36 @@ BlocAST* Parser::bloc() {
 
 StatementAST* Parser::statement() {
   
+  // Déclaration de tableau : ARRAY LONGINT($tableau; taille), ARRAY INTEGER,
+  // ARRAY REAL, ARRAY TEXT
+  if (this->_tok == TokenType::ID && (this->_tok.str() == "array longint" || this->_tok.str() == "array integer"
+                                      || this->_tok.str() == "array real" || this->_tok.str() == "array text")) {
+    return this->arraystatement();
+  }
+  
+  // SORT ARRAY($cle; $tableau2; ...; > ou <)
+  if (this->_tok == TokenType::ID && this->_tok.str() == "sort array") {
+    return this->sortarraystatement();
+  }
+  
+  // Déclaration de type : C_REAL($x; $y), C_LONGINT(...), C_INTEGER(...),
+  // C_INTEGER 64 BITS(...), C_TEXT(...), C_OBJECT(...), C_COLLECTION(...)
+  if (this->_tok == TokenType::ID && this->_tok.str() == "c_real") {
+    return this->declarationstatement(VarType::REAL);
+  }
+  if (this->_tok == TokenType::ID && (this->_tok.str() == "c_longint" || this->_tok.str() == "c_integer")) {
+    return this->declarationstatement(VarType::INT);
+  }
+  if (this->_tok == TokenType::ID && this->_tok.str() == "c_integer 64 bits") {
+    return this->declarationstatement(VarType::LONG);
+  }
+  if (this->_tok == TokenType::ID && this->_tok.str() == "c_text") {
+    return this->declarationstatement(VarType::STRING);
+  }
+  if (this->_tok == TokenType::ID && (this->_tok.str() == "c_object" || this->_tok.str() == "c_collection")) {
+    return this->declarationstatement(VarType::OBJECT);
+  }
+  
   switch(this->_tok.type()){
   case TokenType::IF:
     return this->ifstatement();
@@ -176,6 +293,8 @@ StatementAST* Parser::statement() {
     return this->whilestatement();
   case TokenType::REPEAT:
     return this->repeatstatement();
+  case TokenType::CASEOF:
+    return this->casestatement();
   //AFFECTATION OR EXPRESSION STATEMENTS
   default:
     ExprAST* expr = this->expression();
@@ -186,7 +305,8 @@ StatementAST* Parser::statement() {
       if (!expr->isVar()) {
         Logger::error << this->getErrorHeader() << *expr
                       << this->getErrorHeader() << " is not a variable." << std::endl;
-        exit(EXIT_FAILURE);
+        delete expr;
+        return nullptr;
       }
       
       // On consumme l'affectation
@@ -205,6 +325,127 @@ StatementAST* Parser::statement() {
   }
 }
 
+/////// ARRAY ////////
+
+StatementAST* Parser::arraystatement() {
+  std::string kind = this->_tok.str();
+  // Consomme la commande et la parenthèse ouvrante
+  this->eatToken();
+  if (!this->eatToken(TokenType::LEFTP)) return nullptr;
+  
+  ExprAST* array = this->expression();
+  if (!array) return nullptr;
+  if (!array->isVar()) {
+    Logger::error << this->getErrorHeader() << *array
+                  << this->getErrorHeader() << " is not a variable." << std::endl;
+    delete array;
+    return nullptr;
+  }
+  
+  // Consomme le semi-colon, puis la taille et la parenthèse fermante
+  ExprAST* size = nullptr;
+  if (!this->eatToken(TokenType::SEMICOL) || !(size = this->expression())
+      || !this->eatToken(TokenType::RIGHTP)) {
+    delete array;
+    delete size;
+    return nullptr;
+  }
+  
+  //l'instruction doit se terminer a la fin de la ligne ou du fichier
+  if(this->_tok!=TokenType::ENDF && !this->eatToken(TokenType::ENDL)) {
+    delete array;
+    delete size;
+    return nullptr;
+  }
+  
+  return new ArrayDeclarationAST(kind, (VariableAST*) array, size);
+}
+
+StatementAST* Parser::sortarraystatement() {
+  // Consomme la commande et la parenthèse ouvrante
+  this->eatToken();
+  if (!this->eatToken(TokenType::LEFTP)) return nullptr;
+  
+  std::vector<VariableAST*> arrays;
+  bool descending = false;
+  bool ok = true;
+  do {
+    // Le sens du tri (> croissant, < décroissant) termine la liste
+    if (this->_tok == TokenType::OP && (this->_tok.str() == ">" || this->_tok.str() == "<")) {
+      descending = this->_tok.str() == "<";
+      this->eatToken();
+      break;
+    }
+    ExprAST* array = this->expression();
+    if (!array) {
+      ok = false;
+      break;
+    }
+    if (!array->isVar()) {
+      Logger::error << this->getErrorHeader() << *array
+                    << this->getErrorHeader() << " is not a variable." << std::endl;
+      delete array;
+      ok = false;
+      break;
+    }
+    arrays.push_back((VariableAST*) array);
+    if (this->_tok != TokenType::SEMICOL) break;
+    this->eatToken();
+  } while (true);
+  
+  //la parenthèse fermante, puis la fin de la ligne ou du fichier
+  if (ok && arrays.empty()) {
+    Logger::error << this->getErrorHeader() << "SORT ARRAY expects at least one array." << std::endl;
+    ok = false;
+  }
+  if (!ok || !this->eatToken(TokenType::RIGHTP)
+      || (this->_tok!=TokenType::ENDF && !this->eatToken(TokenType::ENDL))) {
+    for (VariableAST* array : arrays) {
+      delete array;
+    }
+    return nullptr;
+  }
+  
+  return new SortArrayAST(arrays, descending);
+}
+
+StatementAST* Parser::declarationstatement(VarType vtype) {
+  // Consomme la commande et la parenthèse ouvrante
+  this->eatToken();
+  if (!this->eatToken(TokenType::LEFTP)) return nullptr;
+  
+  std::vector<VariableAST*> variables;
+  bool ok = true;
+  do {
+    ExprAST* variable = this->expression();
+    if (!variable) {
+      ok = false;
+      break;
+    }
+    if (!variable->isVar()) {
+      Logger::error << this->getErrorHeader() << *variable
+                    << this->getErrorHeader() << " is not a variable." << std::endl;
+      delete variable;
+      ok = false;
+      break;
+    }
+    variables.push_back((VariableAST*) variable);
+    if (this->_tok != TokenType::SEMICOL) break;
+    this->eatToken();
+  } while (true);
+  
+  //la parenthèse fermante, puis la fin de la ligne ou du fichier
+  if (!ok || !this->eatToken(TokenType::RIGHTP)
+      || (this->_tok!=TokenType::ENDF && !this->eatToken(TokenType::ENDL))) {
+    for (VariableAST* variable : variables) {
+      delete variable;
+    }
+    return nullptr;
+  }
+  
+  return new DeclarationAST(vtype, variables);
+}
+
 /////// IF ////////
 
 StatementAST* Parser::ifstatement() {
@@ -400,6 +641,55 @@ StatementAST* Parser::repeatstatement() {
   return new RepeatAST(untilAST, loopAST);
 }
 
+////// CASE OF ///////
+
+StatementAST* Parser::casestatement() {
+  std::vector<std::pair<ExprAST*, BlocAST*>> cases;
+  ExprAST *condAST;
+  BlocAST *thenAST;
+  BlocAST *elseAST = nullptr;
+
+  // Consomme le token CASE OF
+  this->eatToken();
+
+  while(this->_tok == TokenType::ENDL) this->eatToken();
+
+  // Parse les cas ": (condition)"
+  while(this->_tok == TokenType::COLON){
+    // Consomme le token ':'
+    this->eatToken();
+
+    // Parse la condition
+    condAST = this->expression();
+    if (!condAST) return nullptr;
+
+    if(this->_tok == TokenType::ENDL) this->eatToken();
+
+    // Parse le bloc du cas
+    thenAST = this->bloc();
+    if (!thenAST) return nullptr;
+
+    cases.emplace_back(condAST, thenAST);
+  }
+
+  // Consomme le token ELSE
+  if (this->_tok == TokenType::ELSE){
+    this->eatToken();
+
+    if(this->_tok == TokenType::ENDL) this->eatToken();
+
+    // Parse le bloc ELSE
+    elseAST = this->bloc();
+    if (!elseAST) return nullptr;
+  }
+
+  // Consomme le token ENDCASE
+  if (!this->eatToken(TokenType::ENDCASE)) return nullptr;
+  if(this->_tok == TokenType::ENDL) this->eatToken();
+
+  return new CaseAST(cases, elseAST);
+}
+
 //////////////////
 /// Expression ///
 //////////////////
@@ -457,13 +747,13 @@ ExprAST* Parser::binOpRHS(ExprAST *LHS) {
 ExprAST* Parser::primary() {
   switch (this->_tok.type()) {
   case TokenType::DOLLAR:
-    return this->localVariable();
+    return this->property(this->localVariable());
   case TokenType::DIAMOND:
-    return this->persistantVariable();
+    return this->property(this->persistantVariable());
   case TokenType::ID:
-    return this->identifier();
+    return this->property(this->identifier());
   case TokenType::NUM:
-    return this->literal(VarType::NUMBER);
+    return this->literal(numberType(this->_tok.str()));
   case TokenType::STRING:
     return this->literal(VarType::STRING);
   case TokenType::LEFTP:
@@ -0,0 +1,308 @@
+#include "../../include/runtime.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+FourDArray* BUILTINarrays = nullptr;
+int32_t BUILTINarrayCount = 0;
+
+namespace {
+  const int32_t FREE = -1; // descripteur libre, réutilisable
+  int32_t tableCapacity = 0;
+  std::vector<int32_t> freeArrays;
+
+  void fail(const char* message, int array)
+  {
+    fprintf(stderr, "Runtime Error: %s (array %i)\n", message, array);
+    exit(EXIT_FAILURE);
+  }
+
+  bool valid(int array)
+  {
+    return array > 0 && array < BUILTINarrayCount && BUILTINarrays[array].kind != FREE;
+  }
+
+  FourDArray& descriptor(int array)
+  {
+    if (!valid(array)) {
+      fail("Invalid array", array);
+    }
+    return BUILTINarrays[array];
+  }
+
+  // Descripteur d'un tableau dont les éléments sont de genre kind
+  FourDArray& descriptor(int array, int32_t kind)
+  {
+    FourDArray& a = descriptor(array);
+    if (a.kind != kind) {
+      fail("Array of another type", array);
+    }
+    return a;
+  }
+
+  inline size_t elementSize(const FourDArray& a)
+  {
+    return a.kind == FOURDARRAY_REAL ? sizeof(double) : sizeof(int32_t);
+  }
+
+  inline char* element(FourDArray& a, int32_t index)
+  {
+    return reinterpret_cast<char*>(a.data) + index * elementSize(a);
+  }
+
+  // Rend les textes des éléments first à last d'un tableau de textes
+  void releaseTexts(FourDArray& a, int32_t first, int32_t last)
+  {
+    if (a.kind == FOURDARRAY_TEXT) {
+      for (int32_t i = first; i <= last; ++i) {
+        BUILTINtextRelease(a.data[i]);
+      }
+    }
+  }
+
+  // Nouveau descripteur, repris dans la liste des descripteurs libres s'il y
+  // en a ; le descripteur 0 est réservé : sa taille -1 fait échouer tous les
+  // contrôles de bornes du code généré, comme celle d'un descripteur libre
+  int newArray(int32_t kind)
+  {
+    int array;
+    if (!freeArrays.empty()) {
+      array = freeArrays.back();
+      freeArrays.pop_back();
+    } else {
+      if (BUILTINarrayCount == 0) {
+        BUILTINarrayCount = 1;
+        tableCapacity = 16;
+        BUILTINarrays = static_cast<FourDArray*>(calloc(tableCapacity, sizeof(FourDArray)));
+        if (BUILTINarrays) {
+          BUILTINarrays[0].size = -1;
+        }
+      }
+      if (BUILTINarrayCount == tableCapacity) {
+        tableCapacity *= 2;
+        BUILTINarrays = static_cast<FourDArray*>(realloc(BUILTINarrays, tableCapacity * sizeof(FourDArray)));
+      }
+      if (!BUILTINarrays) {
+        fail("Out of memory", BUILTINarrayCount);
+      }
+      array = BUILTINarrayCount++;
+    }
+    FourDArray& a = BUILTINarrays[array];
+    a.data = nullptr;
+    a.size = -1;
+    a.capacity = 0;
+    a.kind = kind;
+    return array;
+  }
+
+  // Redimensionne le tableau, les nouveaux éléments valent 0 (0.0, texte vide)
+  void resize(FourDArray& a, int32_t size)
+  {
+    size_t bytes = elementSize(a);
+    if (size + 1 > a.capacity) {
+      int32_t capacity = a.capacity < 8 ? 8 : a.capacity;
+      while (capacity < size + 1) {
+        capacity *= 2;
+      }
+      a.data = static_cast<int32_t*>(realloc(a.data, capacity * bytes));
+      if (!a.data) {
+        fail("Out of memory", size);
+      }
+      a.capacity = capacity;
+    }
+    if (size > a.size) {
+      memset(element(a, a.size + 1), 0, (size - a.size) * bytes);
+    } else {
+      releaseTexts(a, size + 1, a.size);
+    }
+    a.size = size;
+  }
+
+  // ARRAY LONGINT, ARRAY REAL, ARRAY TEXT : un tableau redéclaré d'un autre
+  // type perd ses éléments
+  int declare(int array, int size, int32_t kind)
+  {
+    if (!valid(array)) {
+      array = newArray(kind);
+    }
+    FourDArray& a = BUILTINarrays[array];
+    if (a.kind != kind) {
+      releaseTexts(a, 0, a.size);
+      free(a.data);
+      a.data = nullptr;
+      a.size = -1;
+      a.capacity = 0;
+      a.kind = kind;
+    }
+    resize(a, size < 0 ? 0 : size);
+    return array;
+  }
+
+  inline int32_t arrayKind(int kind)
+  {
+    return kind == FOURDVALUE_REAL ? FOURDARRAY_REAL : FOURDARRAY_TEXT;
+  }
+}
+
+
+int BUILTINarrayResize(int array, int size)
+{
+  return declare(array, size, FOURDARRAY_LONGINT);
+}
+
+int BUILTINarrayResizeReal(int array, int size)
+{
+  return declare(array, size, FOURDARRAY_REAL);
+}
+
+int BUILTINarrayResizeText(int array, int size)
+{
+  return declare(array, size, FOURDARRAY_TEXT);
+}
+
+// Tableau local à la sortie de sa méthode : ses éléments sont libérés et son
+// descripteur réutilisé. Un tableau jamais déclaré (0) ou déjà libéré est ignoré.
+int BUILTINarrayRelease(int array)
+{
+  if (!valid(array)) {
+    return 0;
+  }
+  FourDArray& a = BUILTINarrays[array];
+  releaseTexts(a, 0, a.size);
+  free(a.data);
+  a.data = nullptr;
+  a.size = -1;
+  a.capacity = 0;
+  a.kind = FREE;
+  freeArrays.push_back(array);
+  return 0;
+}
+
+int BUILTINarraySize(int array)
+{
+  return descriptor(array).size;
+}
+
+int BUILTINarrayAppend(int array, int value)
+{
+  FourDArray& a = descriptor(array, FOURDARRAY_LONGINT);
+  resize(a, a.size + 1);
+  a.data[a.size] = value;
+  return 0;
+}
+
+int BUILTINarrayAppendReal(int array, double value)
+{
+  FourDArray& a = descriptor(array, FOURDARRAY_REAL);
+  resize(a, a.size + 1);
+  a.reals[a.size] = value;
+  return 0;
+}
+
+// Le tableau reprend la référence du texte
+int BUILTINarrayAppendText(int array, int text)
+{
+  FourDArray& a = descriptor(array, FOURDARRAY_TEXT);
+  resize(a, a.size + 1);
+  a.data[a.size] = text;
+  return 0;
+}
+
+// Insère count éléments nuls avant l'élément position (à la fin si position > taille)
+int BUILTINarrayInsert(int array, int position, int count)
+{
+  FourDArray& a = descriptor(array);
+  if (count <= 0) {
+    return 0;
+  }
+  int32_t size = a.size;
+  if (position < 1 || position > size) {
+    position = size + 1;
+  }
+  resize(a, size + count);
+  size_t bytes = elementSize(a);
+  memmove(element(a, position + count), element(a, position), (size + 1 - position) * bytes);
+  memset(element(a, position), 0, count * bytes);
+  return 0;
+}
+
+// Supprime count éléments à partir de l'élément position
+int BUILTINarrayDelete(int array, int position, int count)
+{
+  FourDArray& a = descriptor(array);
+  if (position < 1 || position > a.size || count <= 0) {
+    return 0;
+  }
+  if (count > a.size - position + 1) {
+    count = a.size - position + 1;
+  }
+  releaseTexts(a, position, position + count - 1);
+  memmove(element(a, position), element(a, position + count),
+          (a.size + 1 - position - count) * elementSize(a));
+  a.size -= count;
+  return 0;
+}
+
+int BUILTINarrayGet(int array, int index)
+{
+  FourDArray& a = descriptor(array, FOURDARRAY_LONGINT);
+  if (index < 0 || index > a.size) {
+    BUILTINarrayOutOfBounds(array, index);
+  }
+  return a.data[index];
+}
+
+// La valeur est le premier argument : c'est l'ordre de la pile de l'interpréteur
+int BUILTINarraySet(int value, int array, int index)
+{
+  FourDArray& a = descriptor(array, FOURDARRAY_LONGINT);
+  if (index < 0 || index > a.size) {
+    BUILTINarrayOutOfBounds(array, index);
+  }
+  a.data[index] = value;
+  return value;
+}
+
+// Élément d'un tableau de réels ou de textes, de genre kind (FOURDVALUE_*) :
+// un réel bit à bit, ou un texte dont on reçoit une référence
+int64_t BUILTINarrayGetValue(int array, int index, int kind)
+{
+  FourDArray& a = descriptor(array, arrayKind(kind));
+  if (index < 0 || index > a.size) {
+    BUILTINarrayOutOfBounds(array, index);
+  }
+  if (a.kind == FOURDARRAY_REAL) {
+    int64_t bits;
+    memcpy(&bits, &a.reals[index], sizeof(bits));
+    return bits;
+  }
+  return BUILTINtextRetain(a.data[index]);
+}
+
+// Le tableau reprend la référence d'un texte affecté et rend l'ancienne
+int BUILTINarraySetValue(int array, int index, int kind, int64_t bits)
+{
+  FourDArray& a = descriptor(array, arrayKind(kind));
+  if (index < 0 || index > a.size) {
+    BUILTINarrayOutOfBounds(array, index);
+  }
+  if (a.kind == FOURDARRAY_REAL) {
+    memcpy(&a.reals[index], &bits, sizeof(bits));
+  } else {
+    BUILTINtextRelease(a.data[index]);
+    a.data[index] = static_cast<int32_t>(bits);
+  }
+  return 0;
+}
+
+int BUILTINarrayOutOfBounds(int array, int index)
+{
+  if (!valid(array)) {
+    fail("Invalid array", array);
+  }
+  fprintf(stderr, "Runtime Error: Array index %i out of range 0..%i (array %i)\n",
+          index, BUILTINarrays[array].size, array);
+  exit(EXIT_FAILURE);
+  return 0;
+}
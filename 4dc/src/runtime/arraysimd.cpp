@@ -0,0 +1,359 @@
+#include "../../include/runtime.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FOURDC_X86_KERNELS
+#endif
+
+/*
+ * Noyaux de Sum, Min, Max, Average et Find in array sur les éléments 1 à size
+ * d'un tableau : AVX2 ou SSE4.1 selon le processeur, version scalaire sinon.
+ */
+namespace {
+  int64_t sumScalar(const int32_t* data, int32_t n)
+  {
+    int64_t sum = 0;
+    for (int32_t i = 0; i < n; ++i) {
+      sum += data[i];
+    }
+    return sum;
+  }
+
+  int32_t minScalar(const int32_t* data, int32_t n)
+  {
+    int32_t min = data[0];
+    for (int32_t i = 1; i < n; ++i) {
+      min = data[i] < min ? data[i] : min;
+    }
+    return min;
+  }
+
+  int32_t maxScalar(const int32_t* data, int32_t n)
+  {
+    int32_t max = data[0];
+    for (int32_t i = 1; i < n; ++i) {
+      max = data[i] > max ? data[i] : max;
+    }
+    return max;
+  }
+
+  // Index du premier élément égal à value, -1 s'il n'y en a pas
+  int32_t findScalar(const int32_t* data, int32_t n, int32_t value)
+  {
+    for (int32_t i = 0; i < n; ++i) {
+      if (data[i] == value) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+#ifdef FOURDC_X86_KERNELS
+  // Somme exacte sur 64 bits : Average en a besoin, Sum la tronque
+  __attribute__((target("avx2")))
+  int64_t sumAVX2(const int32_t* data, int32_t n)
+  {
+    __m256i low = _mm256_setzero_si256(), high = _mm256_setzero_si256();
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+      high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(low, high));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumScalar(data + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  int32_t minAVX2(const int32_t* data, int32_t n)
+  {
+    if (n < 8) {
+      return minScalar(data, n);
+    }
+    __m256i min = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    int32_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+      min = _mm256_min_epi32(min, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), min);
+    int32_t result = minScalar(lanes, 8);
+    if (i < n) {
+      int32_t tail = minScalar(data + i, n - i);
+      result = tail < result ? tail : result;
+    }
+    return result;
+  }
+
+  __attribute__((target("avx2")))
+  int32_t maxAVX2(const int32_t* data, int32_t n)
+  {
+    if (n < 8) {
+      return maxScalar(data, n);
+    }
+    __m256i max = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    int32_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+      max = _mm256_max_epi32(max, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), max);
+    int32_t result = maxScalar(lanes, 8);
+    if (i < n) {
+      int32_t tail = maxScalar(data + i, n - i);
+      result = tail > result ? tail : result;
+    }
+    return result;
+  }
+
+  __attribute__((target("avx2")))
+  int32_t findAVX2(const int32_t* data, int32_t n, int32_t value)
+  {
+    __m256i needle = _mm256_set1_epi32(value);
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      __m256i eq = _mm256_cmpeq_epi32(needle, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+      int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+      if (mask) {
+        return i + __builtin_ctz(mask);
+      }
+    }
+    int32_t tail = findScalar(data + i, n - i, value);
+    return tail < 0 ? -1 : i + tail;
+  }
+
+  __attribute__((target("sse4.1")))
+  int64_t sumSSE41(const int32_t* data, int32_t n)
+  {
+    __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      low = _mm_add_epi64(low, _mm_cvtepi32_epi64(v));
+      high = _mm_add_epi64(high, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(low, high));
+    return lanes[0] + lanes[1] + sumScalar(data + i, n - i);
+  }
+
+  __attribute__((target("sse4.1")))
+  int32_t minSSE41(const int32_t* data, int32_t n)
+  {
+    if (n < 4) {
+      return minScalar(data, n);
+    }
+    __m128i min = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    int32_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+      min = _mm_min_epi32(min, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), min);
+    int32_t result = minScalar(lanes, 4);
+    if (i < n) {
+      int32_t tail = minScalar(data + i, n - i);
+      result = tail < result ? tail : result;
+    }
+    return result;
+  }
+
+  __attribute__((target("sse4.1")))
+  int32_t maxSSE41(const int32_t* data, int32_t n)
+  {
+    if (n < 4) {
+      return maxScalar(data, n);
+    }
+    __m128i max = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    int32_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+      max = _mm_max_epi32(max, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    int32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), max);
+    int32_t result = maxScalar(lanes, 4);
+    if (i < n) {
+      int32_t tail = maxScalar(data + i, n - i);
+      result = tail > result ? tail : result;
+    }
+    return result;
+  }
+
+  __attribute__((target("sse4.1")))
+  int32_t findSSE41(const int32_t* data, int32_t n, int32_t value)
+  {
+    __m128i needle = _mm_set1_epi32(value);
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      __m128i eq = _mm_cmpeq_epi32(needle, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+      int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+      if (mask) {
+        return i + __builtin_ctz(mask);
+      }
+    }
+    int32_t tail = findScalar(data + i, n - i, value);
+    return tail < 0 ? -1 : i + tail;
+  }
+#endif
+
+  struct Kernels
+  {
+    int64_t (*sum)(const int32_t*, int32_t);
+    int32_t (*min)(const int32_t*, int32_t);
+    int32_t (*max)(const int32_t*, int32_t);
+    int32_t (*find)(const int32_t*, int32_t, int32_t);
+  };
+
+  // Noyaux choisis une fois pour toutes selon le processeur
+  const Kernels& kernels()
+  {
+    static const Kernels selected = [] {
+      Kernels k = {sumScalar, minScalar, maxScalar, findScalar};
+#ifdef FOURDC_X86_KERNELS
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) {
+        k = {sumAVX2, minAVX2, maxAVX2, findAVX2};
+      } else if (__builtin_cpu_supports("sse4.1")) {
+        k = {sumSSE41, minSSE41, maxSSE41, findSSE41};
+      }
+#endif
+      return k;
+    }();
+    return selected;
+  }
+
+  // Éléments 1 à size du tableau, de genre kind ; BUILTINarraySize vérifie
+  // l'identifiant
+  inline const FourDArray& elements(int array, int32_t kind, int32_t& size)
+  {
+    size = BUILTINarraySize(array);
+    const FourDArray& a = BUILTINarrays[array];
+    if (a.kind != kind) {
+      fprintf(stderr, "Runtime Error: Array of another type (array %i)\n", array);
+      exit(EXIT_FAILURE);
+    }
+    return a;
+  }
+
+  inline const int32_t* elements(int array, int32_t& size)
+  {
+    return elements(array, FOURDARRAY_LONGINT, size).data + 1;
+  }
+
+  inline const double* reals(int array, int32_t& size)
+  {
+    return elements(array, FOURDARRAY_REAL, size).reals + 1;
+  }
+}
+
+
+int BUILTINarraySum(int array)
+{
+  int32_t size;
+  const int32_t* data = elements(array, size);
+  return static_cast<int32_t>(kernels().sum(data, size));
+}
+
+// Moyenne entière, arrondie vers zéro
+int BUILTINarrayAverage(int array)
+{
+  int32_t size;
+  const int32_t* data = elements(array, size);
+  return size ? static_cast<int32_t>(kernels().sum(data, size) / size) : 0;
+}
+
+int BUILTINarrayMin(int array)
+{
+  int32_t size;
+  const int32_t* data = elements(array, size);
+  return size ? kernels().min(data, size) : 0;
+}
+
+int BUILTINarrayMax(int array)
+{
+  int32_t size;
+  const int32_t* data = elements(array, size);
+  return size ? kernels().max(data, size) : 0;
+}
+
+// Numéro du premier élément égal à value, -1 s'il n'y en a pas
+int BUILTINarrayFind(int array, int value)
+{
+  int32_t size;
+  const int32_t* data = elements(array, size);
+  int32_t index = kernels().find(data, size, value);
+  return index < 0 ? -1 : index + 1;
+}
+
+// Tableaux de réels : boucles scalaires, dans l'ordre des éléments comme la
+// boucle For équivalente
+double BUILTINarraySumReal(int array)
+{
+  int32_t size;
+  const double* data = reals(array, size);
+  double sum = 0;
+  for (int32_t i = 0; i < size; ++i) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+double BUILTINarrayAverageReal(int array)
+{
+  int32_t size = BUILTINarraySize(array);
+  return size ? BUILTINarraySumReal(array) / size : 0;
+}
+
+double BUILTINarrayMinReal(int array)
+{
+  int32_t size;
+  const double* data = reals(array, size);
+  double min = size ? data[0] : 0;
+  for (int32_t i = 1; i < size; ++i) {
+    min = data[i] < min ? data[i] : min;
+  }
+  return min;
+}
+
+double BUILTINarrayMaxReal(int array)
+{
+  int32_t size;
+  const double* data = reals(array, size);
+  double max = size ? data[0] : 0;
+  for (int32_t i = 1; i < size; ++i) {
+    max = data[i] > max ? data[i] : max;
+  }
+  return max;
+}
+
+int BUILTINarrayFindReal(int array, double value)
+{
+  int32_t size;
+  const double* data = reals(array, size);
+  for (int32_t i = 0; i < size; ++i) {
+    if (data[i] == value) {
+      return i + 1;
+    }
+  }
+  return -1;
+}
+
+// Comparaison des textes sans distinction de casse, comme l'opérateur = ; le
+// texte cherché est rendu
+int BUILTINarrayFindText(int array, int text)
+{
+  int32_t size;
+  const int32_t* data = elements(array, FOURDARRAY_TEXT, size).data + 1;
+  int index = -1;
+  for (int32_t i = 0; i < size && index < 0; ++i) {
+    if (BUILTINtextOrder(data[i], text) == 0) {
+      index = i + 1;
+    }
+  }
+  BUILTINtextRelease(text);
+  return index;
+}
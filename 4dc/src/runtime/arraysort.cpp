@@ -0,0 +1,284 @@
+#include "../../include/runtime.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+/*
+ * SORT ARRAY : tri stable des éléments 1 à size de la clé. Les tableaux
+ * suivants sont réordonnés comme la clé.
+ * Une clé entière ou réelle est triée par base (LSD, octet par octet).
+ * Au-delà de PARALLEL_THRESHOLD éléments, chaque passe est répartie entre
+ * plusieurs threads (FOURDC_SORT_THREADS, sinon un par cœur) : histogramme par
+ * bloc, puis dispersion de chaque bloc à partir de sa position, dans l'ordre
+ * des blocs, ce qui conserve la stabilité.
+ * Une clé texte est triée par fusion : chaque thread trie son bloc, puis les
+ * blocs voisins sont fusionnés deux à deux.
+ */
+namespace {
+  const int32_t PARALLEL_THRESHOLD = 1 << 18;
+  const unsigned MAX_THREADS = 64;
+
+  std::vector<int> followers; // tableaux à réordonner lors du prochain tri
+
+  unsigned sortThreads()
+  {
+    static const unsigned threads = [] {
+      const char* env = getenv("FOURDC_SORT_THREADS");
+      int n = env ? atoi(env) : 0;
+      if (n <= 0) {
+        n = std::thread::hardware_concurrency();
+      }
+      return std::min(std::max(n, 1), static_cast<int>(MAX_THREADS));
+    }();
+    return threads;
+  }
+
+  // Exécute f(t) pour chaque bloc t, un thread par bloc
+  template<class F>
+  void parallelFor(unsigned threads, F f)
+  {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+      workers.emplace_back(f, t);
+    }
+    f(0);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  // Clé sans signe dont l'ordre croissant est l'ordre du tri demandé
+  inline uint32_t radixKey(int32_t value, bool descending)
+  {
+    uint32_t key = static_cast<uint32_t>(value) ^ 0x80000000u;
+    return descending ? ~key : key;
+  }
+
+  inline int32_t radixValue(uint32_t key, bool descending)
+  {
+    return static_cast<int32_t>((descending ? ~key : key) ^ 0x80000000u);
+  }
+
+  // Réels : le bit de signe est inversé pour un positif, tous les bits pour un
+  // négatif (dont l'ordre des bits est inverse)
+  inline uint64_t radixKey(double value, bool descending)
+  {
+    uint64_t key;
+    memcpy(&key, &value, sizeof(key));
+    key = key >> 63 ? ~key : key ^ 0x8000000000000000ull;
+    return descending ? ~key : key;
+  }
+
+  inline double radixValue(uint64_t key, bool descending)
+  {
+    key = descending ? ~key : key;
+    key = key >> 63 ? key ^ 0x8000000000000000ull : ~key;
+    double value;
+    memcpy(&value, &key, sizeof(value));
+    return value;
+  }
+
+  // Trie keys (et index, s'il n'est pas nul) ; les pointeurs désignent ensuite
+  // les tampons triés
+  template<class Key>
+  void radixSort(Key*& keys, int32_t*& index, Key*& keysTmp, int32_t*& indexTmp,
+                 size_t n, unsigned threads)
+  {
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<std::array<size_t, 256>> counts(threads);
+
+    for (unsigned shift = 0; shift < 8 * sizeof(Key); shift += 8) {
+      parallelFor(threads, [&](unsigned t) {
+        counts[t].fill(0);
+        for (size_t i = t * chunk, end = std::min(n, (t + 1) * chunk); i < end; ++i) {
+          ++counts[t][(keys[i] >> shift) & 0xFF];
+        }
+      });
+
+      // Passe inutile si tous les éléments ont le même octet
+      bool uniform = false;
+      for (unsigned digit = 0; digit < 256 && !uniform; ++digit) {
+        size_t total = 0;
+        for (unsigned t = 0; t < threads; ++t) {
+          total += counts[t][digit];
+        }
+        uniform = total == n;
+      }
+      if (uniform) {
+        continue;
+      }
+
+      // Position de départ de chaque bloc pour chaque octet
+      size_t offset = 0;
+      for (unsigned digit = 0; digit < 256; ++digit) {
+        for (unsigned t = 0; t < threads; ++t) {
+          size_t count = counts[t][digit];
+          counts[t][digit] = offset;
+          offset += count;
+        }
+      }
+
+      parallelFor(threads, [&](unsigned t) {
+        std::array<size_t, 256>& position = counts[t];
+        for (size_t i = t * chunk, end = std::min(n, (t + 1) * chunk); i < end; ++i) {
+          size_t p = position[(keys[i] >> shift) & 0xFF]++;
+          keysTmp[p] = keys[i];
+          if (index) {
+            indexTmp[p] = index[i];
+          }
+        }
+      });
+      std::swap(keys, keysTmp);
+      std::swap(index, indexTmp);
+    }
+  }
+
+  // Tri par base des éléments data, de clés Key : les valeurs sont
+  // reconstruites à partir des clés triées sans permutation, sinon la
+  // permutation triée est rangée dans permutation
+  template<class Key, class Value>
+  void sortNumbers(Value* data, std::vector<int32_t>* permutation, size_t n, unsigned threads, bool desc)
+  {
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<Key> keysBuffer(n), keysTmpBuffer(n);
+    Key* keys = keysBuffer.data();
+    Key* keysTmp = keysTmpBuffer.data();
+    parallelFor(threads, [&](unsigned t) {
+      for (size_t i = t * chunk, end = std::min(n, (t + 1) * chunk); i < end; ++i) {
+        keys[i] = radixKey(data[i], desc);
+      }
+    });
+
+    if (!permutation) {
+      int32_t* index = nullptr;
+      int32_t* indexTmp = nullptr;
+      radixSort(keys, index, keysTmp, indexTmp, n, threads);
+      parallelFor(threads, [&](unsigned t) {
+        for (size_t i = t * chunk, end = std::min(n, (t + 1) * chunk); i < end; ++i) {
+          data[i] = radixValue(keys[i], desc);
+        }
+      });
+      return;
+    }
+
+    std::vector<int32_t> indexTmpBuffer(n);
+    int32_t* index = permutation->data();
+    int32_t* indexTmp = indexTmpBuffer.data();
+    radixSort(keys, index, keysTmp, indexTmp, n, threads);
+    if (index != permutation->data()) {
+      std::copy(index, index + n, permutation->begin());
+    }
+  }
+
+  // Tri fusion de la permutation index selon les textes texts, sans
+  // distinction de casse comme les comparaisons de textes
+  void sortTexts(const int32_t* texts, int32_t* index, size_t n, unsigned threads, bool desc)
+  {
+    auto before = [texts, desc](int32_t a, int32_t b) {
+      int order = BUILTINtextOrder(texts[a], texts[b]);
+      return desc ? order > 0 : order < 0;
+    };
+    size_t chunk = (n + threads - 1) / threads;
+    parallelFor(threads, [&](unsigned t) {
+      size_t begin = std::min(n, t * chunk), end = std::min(n, (t + 1) * chunk);
+      std::stable_sort(index + begin, index + end, before);
+    });
+    // Fusion des blocs voisins, de largeur double à chaque passe ; à éléments
+    // égaux, std::merge garde d'abord ceux du premier bloc
+    std::vector<int32_t> merged(n);
+    for (size_t width = chunk; width < n; width *= 2) {
+      for (size_t begin = 0; begin < n; begin += 2 * width) {
+        size_t middle = std::min(n, begin + width), end = std::min(n, begin + 2 * width);
+        std::merge(index + begin, index + middle, index + middle, index + end, merged.begin() + begin, before);
+      }
+      std::copy(merged.begin(), merged.end(), index);
+    }
+  }
+
+  // Réordonne les éléments selon la permutation index ; les textes changent de
+  // place sans changer de références
+  template<class T>
+  void permute(T* elements, const int32_t* index, size_t n, unsigned threads)
+  {
+    size_t chunk = (n + threads - 1) / threads;
+    std::vector<T> values(n);
+    parallelFor(threads, [&](unsigned t) {
+      for (size_t i = t * chunk, end = std::min(n, (t + 1) * chunk); i < end; ++i) {
+        values[i] = elements[index[i]];
+      }
+    });
+    std::copy(values.begin(), values.end(), elements);
+  }
+}
+
+
+int BUILTINarraySortFollow(int array)
+{
+  followers.push_back(array);
+  return 0;
+}
+
+int BUILTINarraySort(int array, int descending)
+{
+  // Chaque tableau n'est réordonné qu'une fois
+  std::vector<int> arrays;
+  for (int other : followers) {
+    if (other != array && std::find(arrays.begin(), arrays.end(), other) == arrays.end()) {
+      arrays.push_back(other);
+    }
+  }
+  followers.clear();
+  int32_t size = BUILTINarraySize(array);
+  for (int other : arrays) {
+    if (BUILTINarraySize(other) != size) {
+      fprintf(stderr, "Runtime Error: SORT ARRAY on arrays of different sizes (array %i)\n", other);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (size < 2) {
+    return 0;
+  }
+
+  size_t n = size;
+  unsigned threads = size >= PARALLEL_THRESHOLD ? sortThreads() : 1;
+  bool desc = descending != 0;
+  FourDArray& key = BUILTINarrays[array];
+
+  // Clé numérique seule : les valeurs sont reconstruites à partir des clés triées
+  if (arrays.empty() && key.kind == FOURDARRAY_LONGINT) {
+    sortNumbers<uint32_t>(key.data + 1, nullptr, n, threads, desc);
+    return 0;
+  }
+  if (arrays.empty() && key.kind == FOURDARRAY_REAL) {
+    sortNumbers<uint64_t>(key.reals + 1, nullptr, n, threads, desc);
+    return 0;
+  }
+
+  // Plusieurs tableaux ou clé texte : tri de la permutation, appliquée à chacun
+  std::vector<int32_t> index(n);
+  for (size_t i = 0; i < n; ++i) {
+    index[i] = static_cast<int32_t>(i);
+  }
+  if (key.kind == FOURDARRAY_LONGINT) {
+    sortNumbers<uint32_t>(key.data + 1, &index, n, threads, desc);
+  } else if (key.kind == FOURDARRAY_REAL) {
+    sortNumbers<uint64_t>(key.reals + 1, &index, n, threads, desc);
+  } else {
+    sortTexts(key.data + 1, index.data(), n, threads, desc);
+  }
+
+  arrays.insert(arrays.begin(), array);
+  for (int a : arrays) {
+    FourDArray& other = BUILTINarrays[a];
+    if (other.kind == FOURDARRAY_REAL) {
+      permute(other.reals + 1, index.data(), n, threads);
+    } else {
+      permute(other.data + 1, index.data(), n, threads);
+    }
+  }
+  return 0;
+}
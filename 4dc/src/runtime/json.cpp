@@ -0,0 +1,646 @@
+#include "../../include/runtime.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FOURDC_SSE2_KERNELS
+#endif
+
+/*
+ * JSON Parse et JSON Stringify, sur les objets et collections natifs.
+ *
+ * L'analyse se fait en deux passes. La première parcourt le texte par blocs de
+ * 64 octets et en tire des masques de 64 bits (guillemets, barres obliques
+ * inverses, caractères de structure, espaces), quatre comparaisons SSE2 par
+ * masque. Les guillemets échappés sont retirés par arithmétique sur les
+ * masques, l'intérieur des chaînes est le XOR préfixe des guillemets restants :
+ * on en déduit, sans branchement par octet, l'index des positions où commence
+ * chaque élément ({ } [ ] : , chaînes et valeurs). La seconde passe suit cet
+ * index pour construire les objets et collections.
+ *
+ * L'écriture réutilise un tampon qui garde sa capacité d'un appel à l'autre ;
+ * les chaînes sont copiées par blocs de 16 octets sans caractère à échapper.
+ */
+namespace {
+  const int32_t BLOCK = 64;
+  const int MAX_DEPTH = 1024;
+
+  void fail(const char* message, int64_t offset)
+  {
+    fprintf(stderr, "Runtime Error: %s (offset %lld)\n", message, static_cast<long long>(offset));
+    exit(EXIT_FAILURE);
+  }
+
+  // Masques d'un bloc de 64 octets
+  struct Masks
+  {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t structural;
+    uint64_t space;
+  };
+
+#ifdef FOURDC_SSE2_KERNELS
+  inline uint64_t mask16(__m128i m, int i)
+  {
+    return static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(m))) << (16 * i);
+  }
+#endif
+
+  Masks classify(const char* block)
+  {
+    Masks m = {0, 0, 0, 0};
+#ifdef FOURDC_SSE2_KERNELS
+    for (int i = 0; i < 4; ++i) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+      m.quote |= mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), i);
+      m.backslash |= mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')), i);
+      // { } [ ] : , ; '[' et ']' ne diffèrent de '{' et '}' que par le bit 0x20
+      __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+      __m128i s = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+      s = _mm_or_si128(s, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+      s = _mm_or_si128(s, _mm_cmpeq_epi8(v, _mm_set1_epi8(',')));
+      m.structural |= mask16(s, i);
+      __m128i w = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+      w = _mm_or_si128(w, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+      w = _mm_or_si128(w, _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+      m.space |= mask16(w, i);
+    }
+#else
+    for (int i = 0; i < BLOCK; ++i) {
+      uint64_t bit = uint64_t(1) << i;
+      switch (block[i]) {
+      case '"': m.quote |= bit; break;
+      case '\\': m.backslash |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',': m.structural |= bit; break;
+      case ' ': case '\n': case '\r': case '\t': m.space |= bit; break;
+      }
+    }
+#endif
+    return m;
+  }
+
+  // Caractères échappés : ceux qui suivent une suite impaire de barres
+  // obliques inverses. carry : le premier caractère du bloc suivant l'est.
+  inline uint64_t escapedChars(uint64_t backslash, uint64_t& carry)
+  {
+    const uint64_t even = 0x5555555555555555ull;
+    backslash &= ~carry;
+    uint64_t followsEscape = backslash << 1 | carry;
+    uint64_t oddStarts = backslash & ~even & ~followsEscape;
+    uint64_t sequences = oddStarts + backslash;
+    carry = sequences < oddStarts;
+    uint64_t invert = sequences << 1;
+    return (even ^ invert) & followsEscape;
+  }
+
+  // Bit i : nombre impair de bits à 1 aux positions 0 à i
+  inline uint64_t prefixXor(uint64_t x)
+  {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+  }
+
+  // Première passe : positions de début des éléments, terminées par size
+  void structuralIndex(const char* data, int32_t size, std::vector<int32_t>& index)
+  {
+    index.clear();
+    index.reserve(size / 4 + 1);
+    uint64_t escapeCarry = 0;
+    uint64_t inStringCarry = 0; // tous les bits à 1 si une chaîne se poursuit
+    uint64_t scalarCarry = 0;   // le dernier octet continuait une valeur
+    char tail[BLOCK];
+    for (int32_t at = 0; at < size; at += BLOCK) {
+      const char* block = data + at;
+      if (size - at < BLOCK) {
+        memset(tail, ' ', BLOCK);
+        memcpy(tail, block, size - at);
+        block = tail;
+      }
+      Masks m = classify(block);
+      uint64_t quote = m.quote & ~escapedChars(m.backslash, escapeCarry);
+      uint64_t inString = prefixXor(quote) ^ inStringCarry;
+      inStringCarry = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+      // Valeurs : tout octet hors structure et espaces, dont on ne garde que
+      // le premier. Le guillemet ouvrant commence une chaîne, son contenu et
+      // le guillemet fermant ne comptent pas.
+      uint64_t scalar = ~(m.structural | m.space);
+      uint64_t nonQuote = scalar & ~quote;
+      uint64_t follows = nonQuote << 1 | scalarCarry;
+      scalarCarry = nonQuote >> 63;
+      uint64_t starts = (m.structural | (scalar & ~follows)) & ~(inString ^ quote);
+      for (; starts; starts &= starts - 1) {
+        index.push_back(at + __builtin_ctzll(starts));
+      }
+    }
+    if (inStringCarry) {
+      fail("Unterminated JSON string", size);
+    }
+    index.push_back(size);
+  }
+
+  // Seconde passe : construction des valeurs depuis l'index
+  class Parser
+  {
+    public:
+      Parser(const char* data, int32_t size, const std::vector<int32_t>& index)
+        : _data(data), _size(size), _index(index), _next(0) {}
+
+      // Valeur suivante : genre et bits d'une FourDValue, référence comprise
+      int value(int64_t& bits, int depth)
+      {
+        if (depth > MAX_DEPTH) {
+          fail("JSON nesting too deep", this->offset());
+        }
+        int32_t at = this->take();
+        switch (this->_data[at]) {
+        case '{': bits = this->object(depth); return FOURDVALUE_OBJECT;
+        case '[': bits = this->collection(depth); return FOURDVALUE_OBJECT;
+        case '"': bits = this->text(at); return FOURDVALUE_TEXT;
+        case 't': this->literal(at, "true"); bits = 1; return FOURDVALUE_BOOLEAN;
+        case 'f': this->literal(at, "false"); bits = 0; return FOURDVALUE_BOOLEAN;
+        case 'n': this->literal(at, "null"); bits = 0; return FOURDVALUE_NULL;
+        default: return this->number(at, bits);
+        }
+      }
+
+      void end()
+      {
+        if (this->_index[this->_next] != this->_size) {
+          fail("Unexpected data after JSON value", this->_index[this->_next]);
+        }
+      }
+
+    private:
+      const char* _data;
+      int32_t _size;
+      const std::vector<int32_t>& _index;
+      size_t _next;
+      std::string _buffer;
+
+      int32_t offset() const
+      {
+        return this->_index[this->_next > 0 ? this->_next - 1 : 0];
+      }
+
+      int32_t take()
+      {
+        int32_t at = this->_index[this->_next];
+        if (at == this->_size) {
+          fail("Unexpected end of JSON", at);
+        }
+        ++this->_next;
+        return at;
+      }
+
+      char peek() const
+      {
+        int32_t at = this->_index[this->_next];
+        return at == this->_size ? '\0' : this->_data[at];
+      }
+
+      void expect(char c)
+      {
+        int32_t at = this->take();
+        if (this->_data[at] != c) {
+          fail("Invalid JSON", at);
+        }
+      }
+
+      int object(int depth)
+      {
+        int object = BUILTINobjectNew();
+        if (this->peek() == '}') {
+          ++this->_next;
+          return object;
+        }
+        do {
+          int32_t at = this->take();
+          if (this->_data[at] != '"') {
+            fail("Invalid JSON property name", at);
+          }
+          const char* name = this->string(at);
+          int key = BUILTINobjectKey(name, this->_buffer.size());
+          this->expect(':');
+          int64_t bits;
+          int kind = this->value(bits, depth + 1);
+          BUILTINobjectSet(object, key, kind, bits);
+        } while (this->separator('}'));
+        return object;
+      }
+
+      int collection(int depth)
+      {
+        int collection = BUILTINcollectionNew();
+        if (this->peek() == ']') {
+          ++this->_next;
+          return collection;
+        }
+        do {
+          int64_t bits;
+          int kind = this->value(bits, depth + 1);
+          BUILTINcollectionInsert(collection, INT32_MAX, kind, bits);
+        } while (this->separator(']'));
+        return collection;
+      }
+
+      // ',' : un autre élément suit ; close : fin du conteneur
+      bool separator(char close)
+      {
+        int32_t at = this->take();
+        if (this->_data[at] == ',') {
+          return true;
+        }
+        if (this->_data[at] != close) {
+          fail("Invalid JSON", at);
+        }
+        return false;
+      }
+
+      void literal(int32_t at, const char* word)
+      {
+        size_t size = strlen(word);
+        if (at + size > static_cast<size_t>(this->_size) || memcmp(this->_data + at, word, size) != 0
+            || at + static_cast<int32_t>(size) != this->valueEnd(at)) {
+          fail("Invalid JSON literal", at);
+        }
+      }
+
+      // Fin d'une valeur hors chaîne : début de l'élément suivant, espaces
+      // retirés
+      int32_t valueEnd(int32_t at) const
+      {
+        int32_t end = this->_index[this->_next];
+        while (end > at && isSpace(this->_data[end - 1])) {
+          --end;
+        }
+        return end;
+      }
+
+      static bool isSpace(char c)
+      {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+      }
+
+      // Nombre : entier 64 bits s'il est entier et représentable, réel sinon
+      int number(int32_t at, int64_t& bits)
+      {
+        int32_t end = this->valueEnd(at);
+        const char* p = this->_data + at;
+        const char* last = this->_data + end;
+        bool negative = *p == '-';
+        p += negative;
+        if (p == last || *p < '0' || *p > '9' || (*p == '0' && p + 1 < last && p[1] >= '0' && p[1] <= '9')) {
+          fail("Invalid JSON value", at);
+        }
+        uint64_t integer = 0;
+        bool overflow = false;
+        for (; p < last && *p >= '0' && *p <= '9'; ++p) {
+          overflow |= integer > (UINT64_MAX - 9) / 10;
+          integer = integer * 10 + (*p - '0');
+        }
+        bool isInteger = p == last;
+        if (p < last && *p == '.') {
+          this->digits(++p, last, at);
+        }
+        if (p < last && (*p == 'e' || *p == 'E')) {
+          ++p;
+          p += p < last && (*p == '+' || *p == '-');
+          this->digits(p, last, at);
+        }
+        if (p != last) {
+          fail("Invalid JSON value", at);
+        }
+        if (isInteger && !overflow && integer <= static_cast<uint64_t>(INT64_MAX) + negative) {
+          bits = negative ? static_cast<int64_t>(0 - integer) : static_cast<int64_t>(integer);
+          return FOURDVALUE_NUMBER;
+        }
+        this->_buffer.assign(this->_data + at, end - at);
+        double d = strtod(this->_buffer.c_str(), nullptr);
+        memcpy(&bits, &d, sizeof(bits));
+        return FOURDVALUE_REAL;
+      }
+
+      void digits(const char*& p, const char* last, int32_t at)
+      {
+        const char* first = p;
+        while (p < last && *p >= '0' && *p <= '9') {
+          ++p;
+        }
+        if (p == first) {
+          fail("Invalid JSON value", at);
+        }
+      }
+
+      int text(int32_t at)
+      {
+        const char* data = this->string(at);
+        return BUILTINtextNew(data, this->_buffer.size());
+      }
+
+      // Contenu de la chaîne ouverte en at, déséchappé dans _buffer
+      const char* string(int32_t at)
+      {
+        this->_buffer.clear();
+        const char* p = this->_data + at + 1;
+        const char* last = this->_data + this->_size;
+        for (;;) {
+          const char* run = p;
+          p = plainRun(p, last);
+          this->_buffer.append(run, p - run);
+          if (p == last) {
+            fail("Unterminated JSON string", at);
+          }
+          if (*p == '"') {
+            return this->_buffer.data();
+          }
+          if (static_cast<unsigned char>(*p) < 0x20) {
+            fail("Invalid character in JSON string", p - this->_data);
+          }
+          p = this->escape(p, last);
+        }
+      }
+
+      // Premier octet à partir de p qui est '"', '\\' ou un caractère de
+      // contrôle
+      static const char* plainRun(const char* p, const char* last)
+      {
+#ifdef FOURDC_SSE2_KERNELS
+        for (; last - p >= 16; p += 16) {
+          __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+          __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+          // Contrôles : octets signés de 0 à 31
+          stop = _mm_or_si128(stop, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-1)),
+                                                  _mm_cmplt_epi8(v, _mm_set1_epi8(0x20))));
+          int mask = _mm_movemask_epi8(stop);
+          if (mask) {
+            return p + __builtin_ctz(mask);
+          }
+        }
+#endif
+        while (p < last && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) {
+          ++p;
+        }
+        return p;
+      }
+
+      // Séquence d'échappement en p ; renvoie la suite
+      const char* escape(const char* p, const char* last)
+      {
+        if (p + 1 == last) {
+          fail("Unterminated JSON string", p - this->_data);
+        }
+        switch (p[1]) {
+        case '"': this->_buffer += '"'; break;
+        case '\\': this->_buffer += '\\'; break;
+        case '/': this->_buffer += '/'; break;
+        case 'b': this->_buffer += '\b'; break;
+        case 'f': this->_buffer += '\f'; break;
+        case 'n': this->_buffer += '\n'; break;
+        case 'r': this->_buffer += '\r'; break;
+        case 't': this->_buffer += '\t'; break;
+        case 'u': {
+          uint32_t code = this->hex(p + 2, last);
+          p += 6;
+          // Paire de substitution UTF-16
+          if (code >= 0xD800 && code < 0xDC00 && last - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+            uint32_t low = this->hex(p + 2, last);
+            if (low >= 0xDC00 && low < 0xE000) {
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+              p += 6;
+            }
+          }
+          this->utf8(code >= 0xD800 && code < 0xE000 ? 0xFFFD : code);
+          return p;
+        }
+        default:
+          fail("Invalid JSON escape", p - this->_data);
+        }
+        return p + 2;
+      }
+
+      uint32_t hex(const char* p, const char* last)
+      {
+        if (last - p < 4) {
+          fail("Invalid JSON escape", p - this->_data);
+        }
+        uint32_t code = 0;
+        for (int i = 0; i < 4; ++i) {
+          char c = p[i];
+          int digit = c >= '0' && c <= '9' ? c - '0'
+                    : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : -1;
+          if (digit < 0) {
+            fail("Invalid JSON escape", p - this->_data);
+          }
+          code = code << 4 | digit;
+        }
+        return code;
+      }
+
+      void utf8(uint32_t code)
+      {
+        if (code < 0x80) {
+          this->_buffer += static_cast<char>(code);
+        } else if (code < 0x800) {
+          this->_buffer += static_cast<char>(0xC0 | code >> 6);
+          this->_buffer += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+          this->_buffer += static_cast<char>(0xE0 | code >> 12);
+          this->_buffer += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+          this->_buffer += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+          this->_buffer += static_cast<char>(0xF0 | code >> 18);
+          this->_buffer += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+          this->_buffer += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+          this->_buffer += static_cast<char>(0x80 | (code & 0x3F));
+        }
+      }
+  };
+
+  // Écriture : le tampon garde sa capacité entre deux appels
+  std::string output;
+
+  void writeString(const char* data, int32_t size)
+  {
+    static const char hexDigits[] = "0123456789abcdef";
+    const char* last = data + size;
+    output += '"';
+    for (const char* p = data; ; ) {
+      const char* run = p;
+#ifdef FOURDC_SSE2_KERNELS
+      for (; last - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        stop = _mm_or_si128(stop, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-1)),
+                                                _mm_cmplt_epi8(v, _mm_set1_epi8(0x20))));
+        int mask = _mm_movemask_epi8(stop);
+        if (mask) {
+          p += __builtin_ctz(mask);
+          break;
+        }
+      }
+#endif
+      while (p < last && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) {
+        ++p;
+      }
+      output.append(run, p - run);
+      if (p == last) {
+        break;
+      }
+      unsigned char c = *p++;
+      switch (c) {
+      case '"': output += "\\\""; break;
+      case '\\': output += "\\\\"; break;
+      case '\n': output += "\\n"; break;
+      case '\r': output += "\\r"; break;
+      case '\t': output += "\\t"; break;
+      default:
+        output += "\\u00";
+        output += hexDigits[c >> 4];
+        output += hexDigits[c & 0xF];
+      }
+    }
+    output += '"';
+  }
+
+  void writeLong(int64_t value)
+  {
+    char buffer[24];
+    char* p = buffer + sizeof(buffer);
+    uint64_t u = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    do {
+      *--p = static_cast<char>('0' + u % 10);
+      u /= 10;
+    } while (u);
+    if (value < 0) {
+      *--p = '-';
+    }
+    output.append(p, buffer + sizeof(buffer) - p);
+  }
+
+  void writeObject(int object, int depth);
+
+  void writeValue(const FourDValue& v, int depth)
+  {
+    switch (v.kind) {
+    case FOURDVALUE_NUMBER:
+      writeLong(v.bits);
+      break;
+    case FOURDVALUE_REAL: {
+      double d;
+      memcpy(&d, &v.bits, sizeof(d));
+      // Comme String : 15 chiffres significatifs ; JSON n'a ni infini ni NaN
+      if (std::isfinite(d)) {
+        char buffer[32];
+        output.append(buffer, snprintf(buffer, sizeof(buffer), "%.15g", d));
+      } else {
+        output += "null";
+      }
+      break;
+    }
+    case FOURDVALUE_TEXT: {
+      int size;
+      const char* data = BUILTINtextData(static_cast<int32_t>(v.bits), &size);
+      writeString(data, size);
+      break;
+    }
+    case FOURDVALUE_OBJECT:
+      writeObject(static_cast<int32_t>(v.bits), depth + 1);
+      break;
+    case FOURDVALUE_BOOLEAN:
+      output += v.bits ? "true" : "false";
+      break;
+    default:
+      output += "null";
+    }
+  }
+
+  // Propriétés dans leur ordre d'ajout, éléments dans l'ordre des index
+  void writeObject(int object, int depth)
+  {
+    if (object == 0) {
+      output += "null";
+      return;
+    }
+    if (object < 0 || object >= BUILTINobjectCount
+        || (BUILTINobjects[object].kind != FOURDOBJECT_OBJECT && BUILTINobjects[object].kind != FOURDOBJECT_COLLECTION)) {
+      fail("Invalid object", output.size());
+    }
+    if (depth > MAX_DEPTH) {
+      fail("JSON nesting too deep", output.size());
+    }
+    const FourDObject& o = BUILTINobjects[object];
+    bool collection = o.kind == FOURDOBJECT_COLLECTION;
+    output += collection ? '[' : '{';
+    bool first = true;
+    for (int32_t i = 0; i < o.size; ++i) {
+      const FourDValue& v = o.values[i];
+      if (!collection && v.key == 0) {
+        continue; // propriété supprimée
+      }
+      if (!first) {
+        output += ',';
+      }
+      first = false;
+      if (!collection) {
+        int size;
+        const char* name = BUILTINobjectKeyName(v.key, &size);
+        writeString(name, size);
+        output += ':';
+      }
+      writeValue(v, depth);
+    }
+    output += collection ? ']' : '}';
+  }
+}
+
+
+// JSON Parse(texte) : objet ou collection, objet indéfini pour null
+int BUILTINjsonParse(int text)
+{
+  int size;
+  const char* data = BUILTINtextData(text, &size);
+  // Un texte court est rangé dans BUILTINtexts, que les textes créés déplacent
+  char small[FOURDTEXT_SMALL + 1];
+  if (size <= FOURDTEXT_SMALL) {
+    memcpy(small, data, size + 1);
+    data = small;
+  }
+  std::vector<int32_t> index;
+  structuralIndex(data, size, index);
+  Parser parser(data, size, index);
+  int64_t bits;
+  int kind = parser.value(bits, 0);
+  parser.end();
+  BUILTINtextRelease(text);
+  if (kind == FOURDVALUE_NULL) {
+    return 0;
+  }
+  if (kind != FOURDVALUE_OBJECT) {
+    if (kind == FOURDVALUE_TEXT) {
+      BUILTINtextRelease(static_cast<int32_t>(bits));
+    }
+    fail("JSON value is not an object", 0);
+  }
+  return static_cast<int32_t>(bits);
+}
+
+// JSON Stringify(objet) : forme compacte, sans espaces ; l'objet rend sa référence
+int BUILTINjsonStringify(int object)
+{
+  output.clear();
+  writeObject(object, 0);
+  BUILTINobjectRelease(object);
+  return BUILTINtextNew(output.data(), output.size());
+}
@@ -0,0 +1,613 @@
+#include "../../include/runtime.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FOURDC_SSE2_KERNELS
+#endif
+
+FourDObject* BUILTINobjects = nullptr;
+int32_t BUILTINobjectCount = 0;
+
+/*
+ * Objets : table à adressage ouvert par groupes de FOURDOBJECT_GROUP cases.
+ * L'empreinte d'une clé donne le premier groupe et l'octet de contrôle (7 bits)
+ * de ses cases ; les 16 octets de contrôle d'un groupe sont comparés en une
+ * instruction SSE2, seules les cases dont l'octet correspond sont vérifiées.
+ * Un groupe contenant une case vide termine la recherche. Les groupes suivants
+ * sont parcourus par sauts croissants (1, 2, 3...), ce qui visite tous les
+ * groupes d'une table dont le nombre de groupes est une puissance de 2.
+ * La table est reconstruite au-delà de 7/8 de cases occupées.
+ *
+ * Formes : deux objets dont les propriétés ont été ajoutées dans le même ordre,
+ * sans suppression, partagent une forme et rangent chaque propriété à la même
+ * position de values. Les accès $objet.nom gardent la forme et la position du
+ * dernier objet rencontré (FourDPropertyCache).
+ *
+ * Références : un objet libéré rend celles de ses valeurs, et son descripteur
+ * est réutilisé. Sa forme est celle d'un dictionnaire : aucun cache ne le lit.
+ */
+namespace {
+  const int32_t MIN_SLOTS = 2 * FOURDOBJECT_GROUP;
+  const int32_t ROOT_SHAPE = 1; // objet vide
+  const int32_t FREE = -1; // genre d'un descripteur libre, réutilisable
+  int32_t tableCapacity = 0;
+  std::vector<int32_t> freeObjects;
+  std::vector<int32_t> unreferenced; // objets à libérer
+
+  // Forme suivante de chaque forme, par clé ajoutée
+  std::unordered_map<uint64_t, int32_t> transitions;
+  int32_t shapeCount = ROOT_SHAPE + 1;
+
+  // Clés internées : 0 ne désigne aucune propriété
+  std::unordered_map<std::string, int32_t> keyIds;
+  std::vector<std::string> keyNames(1);
+
+  void fail(const char* message, int object)
+  {
+    fprintf(stderr, "Runtime Error: %s (object %i)\n", message, object);
+    exit(EXIT_FAILURE);
+  }
+
+  void* allocate(void* data, size_t size)
+  {
+    data = realloc(data, size);
+    if (!data) {
+      fail("Out of memory", BUILTINobjectCount);
+    }
+    return data;
+  }
+
+  FourDObject& descriptor(int object)
+  {
+    if (object <= 0 || object >= BUILTINobjectCount || BUILTINobjects[object].kind == FREE) {
+      fail(object == 0 ? "Undefined object" : "Invalid object", object);
+    }
+    return BUILTINobjects[object];
+  }
+
+  FourDObject& descriptor(int object, int32_t kind)
+  {
+    FourDObject& o = descriptor(object);
+    if (o.kind != kind) {
+      fail(kind == FOURDOBJECT_COLLECTION ? "Not a collection" : "Not an object", object);
+    }
+    return o;
+  }
+
+  // Nouvel objet, portant une référence, repris dans la liste des
+  // descripteurs libres s'il y en a
+  int newObject(int32_t kind)
+  {
+    int object;
+    if (!freeObjects.empty()) {
+      object = freeObjects.back();
+      freeObjects.pop_back();
+    } else {
+      if (BUILTINobjectCount >= tableCapacity) {
+        tableCapacity = tableCapacity ? 2 * tableCapacity : 64;
+        BUILTINobjects = static_cast<FourDObject*>(allocate(BUILTINobjects, tableCapacity * sizeof(FourDObject)));
+      }
+      if (BUILTINobjectCount == 0) {
+        // 0 : objet indéfini, sans forme
+        BUILTINobjects[0] = FourDObject{0, FOURDOBJECT_DICTIONARY, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, 0};
+        BUILTINobjectCount = 1;
+      }
+      object = BUILTINobjectCount++;
+    }
+    int32_t shape = kind == FOURDOBJECT_OBJECT ? ROOT_SHAPE : FOURDOBJECT_DICTIONARY;
+    BUILTINobjects[object] = FourDObject{kind, shape, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, 1};
+    return object;
+  }
+
+  // Libère les objets de unreferenced et rend les références de leurs
+  // valeurs ; les objets dont c'était la dernière sont libérés à leur tour,
+  // sans récursion
+  void destroyUnreferenced()
+  {
+    while (!unreferenced.empty()) {
+      int object = unreferenced.back();
+      unreferenced.pop_back();
+      FourDObject& o = BUILTINobjects[object];
+      for (int32_t i = 0; i < o.size; ++i) {
+        const FourDValue& v = o.values[i];
+        if (v.kind == FOURDVALUE_TEXT) {
+          BUILTINtextRelease(static_cast<int32_t>(v.bits));
+        } else if (v.kind == FOURDVALUE_OBJECT && v.bits != 0 && --BUILTINobjects[v.bits].refs == 0) {
+          unreferenced.push_back(static_cast<int32_t>(v.bits));
+        }
+      }
+      free(o.control);
+      free(o.positions);
+      free(o.values);
+      o = FourDObject{FREE, FOURDOBJECT_DICTIONARY, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, 0};
+      freeObjects.push_back(object);
+    }
+  }
+
+  // Garantit la place de capacity valeurs
+  void reserve(FourDObject& o, int32_t capacity)
+  {
+    if (capacity <= o.capacity) {
+      return;
+    }
+    int32_t grown = o.capacity ? o.capacity : 4;
+    while (grown < capacity) {
+      grown = grown > INT32_MAX / 2 ? INT32_MAX : grown * 2;
+    }
+    o.values = static_cast<FourDValue*>(allocate(o.values, grown * sizeof(FourDValue)));
+    o.capacity = grown;
+  }
+
+  int32_t lengthKey()
+  {
+    static const int32_t key = BUILTINobjectKey("length", 6);
+    return key;
+  }
+
+  // Empreinte de Fibonacci : les bits de poids fort sont les mieux mélangés
+  inline uint64_t hash(int32_t key)
+  {
+    return static_cast<uint64_t>(static_cast<uint32_t>(key)) * 0x9E3779B97F4A7C15ull;
+  }
+
+  inline uint8_t tag(uint64_t h)
+  {
+    return static_cast<uint8_t>(h >> 57);
+  }
+
+  inline int32_t firstGroup(uint64_t h, int32_t groups)
+  {
+    return static_cast<int32_t>(h >> 32) & (groups - 1);
+  }
+
+  // Masque des cases du groupe dont l'octet de contrôle vaut byte
+  inline uint32_t matchByte(const uint8_t* control, uint8_t byte)
+  {
+#ifdef FOURDC_SSE2_KERNELS
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(byte))));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FOURDOBJECT_GROUP; ++i) {
+      mask |= static_cast<uint32_t>(control[i] == byte) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Masque des cases vides ou supprimées : seul leur octet a le bit de poids fort
+  inline uint32_t matchFree(const uint8_t* control)
+  {
+#ifdef FOURDC_SSE2_KERNELS
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(control)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < FOURDOBJECT_GROUP; ++i) {
+      mask |= static_cast<uint32_t>(control[i] >> 7) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Case de la propriété key, -1 si elle n'est pas définie
+  int32_t findSlot(const FourDObject& o, int32_t key)
+  {
+    if (o.slots == 0 || key <= 0) {
+      return -1;
+    }
+    uint64_t h = hash(key);
+    int32_t groups = o.slots / FOURDOBJECT_GROUP;
+    int32_t group = firstGroup(h, groups);
+    for (int32_t step = 1; ; group = (group + step++) & (groups - 1)) {
+      const uint8_t* control = o.control + group * FOURDOBJECT_GROUP;
+      for (uint32_t match = matchByte(control, tag(h)); match; match &= match - 1) {
+        int32_t slot = group * FOURDOBJECT_GROUP + __builtin_ctz(match);
+        if (o.values[o.positions[slot]].key == key) {
+          return slot;
+        }
+      }
+      if (matchByte(control, FOURDOBJECT_EMPTY)) {
+        return -1;
+      }
+    }
+  }
+
+  // Première case libre (vide ou supprimée) sur le chemin de key
+  int32_t freeSlot(const FourDObject& o, int32_t key)
+  {
+    uint64_t h = hash(key);
+    int32_t groups = o.slots / FOURDOBJECT_GROUP;
+    int32_t group = firstGroup(h, groups);
+    for (int32_t step = 1; ; group = (group + step++) & (groups - 1)) {
+      uint32_t free = matchFree(o.control + group * FOURDOBJECT_GROUP);
+      if (free) {
+        return group * FOURDOBJECT_GROUP + __builtin_ctz(free);
+      }
+    }
+  }
+
+  // Retire les propriétés supprimées de values et reconstruit une table
+  // remplie au plus à moitié
+  void rebuild(FourDObject& o)
+  {
+    int32_t size = 0;
+    for (int32_t i = 0; i < o.size; ++i) {
+      if (o.values[i].key != 0) {
+        o.values[size++] = o.values[i];
+      }
+    }
+    o.size = size;
+    int32_t slots = MIN_SLOTS;
+    while (slots <= 2 * size) {
+      slots *= 2;
+    }
+    if (slots != o.slots) {
+      o.control = static_cast<uint8_t*>(allocate(o.control, slots));
+      o.positions = static_cast<int32_t*>(allocate(o.positions, slots * sizeof(int32_t)));
+      o.slots = slots;
+    }
+    memset(o.control, FOURDOBJECT_EMPTY, slots);
+    for (int32_t i = 0; i < size; ++i) {
+      int32_t slot = freeSlot(o, o.values[i].key);
+      o.control[slot] = tag(hash(o.values[i].key));
+      o.positions[slot] = i;
+    }
+    o.used = size;
+  }
+
+  // Forme d'un objet de forme shape auquel on ajoute la propriété key
+  int32_t transition(int32_t shape, int32_t key)
+  {
+    uint64_t edge = static_cast<uint64_t>(shape) << 32 | static_cast<uint32_t>(key);
+    auto it = transitions.find(edge);
+    if (it != transitions.end()) {
+      return it->second;
+    }
+    transitions.emplace(edge, shapeCount);
+    return shapeCount++;
+  }
+
+  // Nouvelle propriété key, valeur nulle : sa position dans values. Les
+  // propriétés supprimées sont retirées de values avant qu'il ne grandisse.
+  int32_t insert(FourDObject& o, int32_t key)
+  {
+    if (8 * (o.used + 1) > 7 * o.slots || (o.size == o.capacity && 2 * o.count < o.size)) {
+      rebuild(o);
+    }
+    reserve(o, o.size + 1);
+    int32_t slot = freeSlot(o, key);
+    if (o.control[slot] == FOURDOBJECT_EMPTY) {
+      ++o.used;
+    }
+    o.control[slot] = tag(hash(key));
+    o.positions[slot] = o.size;
+    o.values[o.size] = FourDValue{key, FOURDVALUE_NULL, 0};
+    ++o.count;
+    // Un objet de forme n'a pas de propriété supprimée : rebuild ne déplace
+    // aucune valeur
+    if (o.shape != FOURDOBJECT_DICTIONARY) {
+      o.shape = o.count > FOURDOBJECT_MAX_SHAPED ? FOURDOBJECT_DICTIONARY : transition(o.shape, key);
+    }
+    return o.size++;
+  }
+
+  // Position de la propriété key, ajoutée si elle n'est pas définie
+  int32_t position(FourDObject& o, int32_t key)
+  {
+    int32_t slot = findSlot(o, key);
+    return slot < 0 ? insert(o, key) : o.positions[slot];
+  }
+
+  // La valeur reprend la référence d'un texte ou d'un objet affecté et rend
+  // l'ancienne
+  void assign(FourDValue& v, int kind, int64_t bits)
+  {
+    if (v.kind == FOURDVALUE_TEXT) {
+      BUILTINtextRelease(static_cast<int32_t>(v.bits));
+    } else if (v.kind == FOURDVALUE_OBJECT) {
+      BUILTINobjectRelease(static_cast<int32_t>(v.bits));
+    }
+    v.kind = kind;
+    v.bits = kind == FOURDVALUE_BOOLEAN ? bits != 0 : bits;
+  }
+
+  inline int64_t realBits(double d)
+  {
+    int64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+  }
+
+  inline double real(int64_t bits)
+  {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+  }
+
+  // Valeur lue dans le genre kind ; un texte ou un objet lu porte sa propre
+  // référence
+  int64_t read(const FourDValue& v, int kind)
+  {
+    bool number = v.kind == FOURDVALUE_NUMBER || v.kind == FOURDVALUE_BOOLEAN;
+    switch (kind) {
+    case FOURDVALUE_NUMBER:
+      if (v.kind == FOURDVALUE_REAL) {
+        double d = real(v.bits);
+        return d >= -9223372036854775808.0 && d < 9223372036854775808.0 ? static_cast<int64_t>(d) : INT64_MIN;
+      }
+      return number ? v.bits : 0;
+    case FOURDVALUE_REAL:
+      return v.kind == FOURDVALUE_REAL ? v.bits : realBits(number ? static_cast<double>(v.bits) : 0.0);
+    case FOURDVALUE_TEXT:
+      if (v.kind == FOURDVALUE_TEXT) {
+        return BUILTINtextRetain(static_cast<int32_t>(v.bits));
+      }
+      if (v.kind == FOURDVALUE_REAL) {
+        return BUILTINtextFromReal(real(v.bits));
+      }
+      return number ? BUILTINtextFromLong(v.bits) : 0;
+    case FOURDVALUE_BOOLEAN:
+      return number && v.bits != 0;
+    case FOURDVALUE_OBJECT:
+      return v.kind == FOURDVALUE_OBJECT ? BUILTINobjectRetain(static_cast<int32_t>(v.bits)) : 0;
+    default:
+      return v.kind == kind ? v.bits : 0;
+    }
+  }
+
+  const FourDValue nullValue = {0, FOURDVALUE_NULL, 0};
+
+  // Genre d'un accès, sans FOURDVALUE_RELEASE
+  inline int accessKind(int kind)
+  {
+    return kind & ~FOURDVALUE_RELEASE;
+  }
+
+  // Fin d'un accès : l'objet accédé rend sa référence si le genre le demande
+  inline void endAccess(int object, int kind)
+  {
+    if (kind & FOURDVALUE_RELEASE) {
+      BUILTINobjectRelease(object);
+    }
+  }
+
+  int64_t get(int object, int key, int kind)
+  {
+    if (object == 0) {
+      return read(nullValue, kind);
+    }
+    if (object > 0 && object < BUILTINobjectCount && BUILTINobjects[object].kind == FOURDOBJECT_COLLECTION) {
+      FourDValue length = {0, FOURDVALUE_NUMBER, BUILTINobjects[object].size};
+      return read(key == lengthKey() ? length : nullValue, kind);
+    }
+    const FourDObject& o = descriptor(object, FOURDOBJECT_OBJECT);
+    int32_t slot = findSlot(o, key);
+    return read(slot < 0 ? nullValue : o.values[o.positions[slot]], kind);
+  }
+
+  int64_t getCached(int object, int key, int kind, FourDPropertyCache* cache)
+  {
+    if (object <= 0 || object >= BUILTINobjectCount) {
+      return get(object, key, kind);
+    }
+    const FourDObject& o = BUILTINobjects[object];
+    if (o.shape == cache->shape) {
+      return read(o.values[cache->position], kind);
+    }
+    if (o.kind != FOURDOBJECT_OBJECT) {
+      return get(object, key, kind);
+    }
+    int32_t slot = findSlot(o, key);
+    if (slot < 0) {
+      return read(nullValue, kind);
+    }
+    if (o.shape != FOURDOBJECT_DICTIONARY) {
+      *cache = FourDPropertyCache{o.shape, o.positions[slot]};
+    }
+    return read(o.values[o.positions[slot]], kind);
+  }
+}
+
+
+int BUILTINobjectNew()
+{
+  return newObject(FOURDOBJECT_OBJECT);
+}
+
+int BUILTINcollectionNew()
+{
+  return newObject(FOURDOBJECT_COLLECTION);
+}
+
+int BUILTINobjectRetain(int object)
+{
+  if (object != 0) {
+    ++descriptor(object).refs;
+  }
+  return object;
+}
+
+// L'objet indéfini (0) n'est pas compté
+int BUILTINobjectRelease(int object)
+{
+  if (object != 0 && --descriptor(object).refs == 0) {
+    unreferenced.push_back(object);
+    destroyUnreferenced();
+  }
+  return 0;
+}
+
+// Clé du nom de propriété, créée au premier appel
+int BUILTINobjectKey(const char* name, int size)
+{
+  std::string key(name, size);
+  auto it = keyIds.find(key);
+  if (it != keyIds.end()) {
+    return it->second;
+  }
+  int32_t id = keyNames.size();
+  keyIds.emplace(key, id);
+  keyNames.push_back(key);
+  return id;
+}
+
+// Clé d'un nom calculé, pour une affectation
+int BUILTINobjectKeyOf(int text)
+{
+  int size;
+  const char* data = BUILTINtextData(text, &size);
+  int key = BUILTINobjectKey(data, size);
+  BUILTINtextRelease(text);
+  return key;
+}
+
+// Clé d'un nom calculé, pour une lecture : 0 si aucune propriété ne porte ce
+// nom, sans l'interner
+int BUILTINobjectFindKey(int text)
+{
+  int size;
+  const char* data = BUILTINtextData(text, &size);
+  auto it = keyIds.find(std::string(data, size));
+  int key = it != keyIds.end() ? it->second : 0;
+  BUILTINtextRelease(text);
+  return key;
+}
+
+const char* BUILTINobjectKeyName(int key, int* size)
+{
+  if (key <= 0 || key >= static_cast<int>(keyNames.size())) {
+    fail("Invalid property", key);
+  }
+  *size = keyNames[key].size();
+  return keyNames[key].data();
+}
+
+// $objet.nom : propriété non définie ou objet indéfini : valeur nulle.
+// $collection.length : nombre d'éléments.
+int64_t BUILTINobjectGet(int object, int key, int kind)
+{
+  int64_t value = get(object, key, accessKind(kind));
+  endAccess(object, kind);
+  return value;
+}
+
+// $objet.nom:=valeur : la valeur d'un texte ou d'un objet reprend sa référence
+int BUILTINobjectSet(int object, int key, int kind, int64_t value)
+{
+  FourDObject& o = descriptor(object, FOURDOBJECT_OBJECT);
+  if (key <= 0) {
+    fail("Invalid property", object);
+  }
+  // position peut déplacer values
+  int32_t at = position(o, key);
+  assign(o.values[at], accessKind(kind), value);
+  endAccess(object, kind);
+  return object;
+}
+
+// $objet.nom, nom constant : un objet de la forme du cache est lu sans
+// recherche
+int64_t BUILTINobjectGetCached(int object, int key, int kind, FourDPropertyCache* cache)
+{
+  int64_t value = getCached(object, key, accessKind(kind), cache);
+  endAccess(object, kind);
+  return value;
+}
+
+// $objet.nom:=valeur, nom constant : le cache retient la forme de l'objet
+// après l'affectation
+int BUILTINobjectSetCached(int object, int key, int kind, int64_t value, FourDPropertyCache* cache)
+{
+  if (object > 0 && object < BUILTINobjectCount && BUILTINobjects[object].shape == cache->shape) {
+    assign(BUILTINobjects[object].values[cache->position], accessKind(kind), value);
+    endAccess(object, kind);
+    return object;
+  }
+  FourDObject& o = descriptor(object, FOURDOBJECT_OBJECT);
+  if (key <= 0) {
+    fail("Invalid property", object);
+  }
+  int32_t at = position(o, key);
+  assign(o.values[at], accessKind(kind), value);
+  if (o.shape != FOURDOBJECT_DICTIONARY) {
+    *cache = FourDPropertyCache{o.shape, at};
+  }
+  endAccess(object, kind);
+  return object;
+}
+
+// OB REMOVE($objet; nom)
+int BUILTINobjectRemove(int object, int text)
+{
+  int key = BUILTINobjectFindKey(text);
+  FourDObject& o = descriptor(object, FOURDOBJECT_OBJECT);
+  int32_t slot = findSlot(o, key);
+  if (slot >= 0) {
+    FourDValue& v = o.values[o.positions[slot]];
+    assign(v, FOURDVALUE_NULL, 0);
+    v.key = 0;
+    o.control[slot] = FOURDOBJECT_DELETED;
+    o.shape = FOURDOBJECT_DICTIONARY;
+    --o.count;
+  }
+  BUILTINobjectRelease(object);
+  return 0;
+}
+
+// $collection[index], à partir de 0 : valeur nulle au-delà de la fin
+int64_t BUILTINcollectionGet(int collection, int index, int kind)
+{
+  if (collection == 0) {
+    return read(nullValue, accessKind(kind));
+  }
+  const FourDObject& c = descriptor(collection, FOURDOBJECT_COLLECTION);
+  int64_t value = read(index >= 0 && index < c.size ? c.values[index] : nullValue, accessKind(kind));
+  endAccess(collection, kind);
+  return value;
+}
+
+// $collection[index]:=valeur : la collection est complétée de valeurs nulles
+int BUILTINcollectionSet(int collection, int index, int kind, int64_t value)
+{
+  FourDObject& c = descriptor(collection, FOURDOBJECT_COLLECTION);
+  if (index < 0) {
+    fail("Negative collection index", collection);
+  }
+  if (index >= c.size) {
+    reserve(c, index + 1);
+    for (int32_t i = c.size; i <= index; ++i) {
+      c.values[i] = nullValue;
+    }
+    c.size = index + 1;
+  }
+  assign(c.values[index], accessKind(kind), value);
+  endAccess(collection, kind);
+  return collection;
+}
+
+// $collection.insert(index; valeur) et $collection.push(valeur) : un index
+// négatif compte depuis la fin, un index au-delà de la fin ajoute la valeur.
+// La collection renvoyée porte la référence reçue.
+int BUILTINcollectionInsert(int collection, int index, int kind, int64_t value)
+{
+  FourDObject& c = descriptor(collection, FOURDOBJECT_COLLECTION);
+  if (index < 0) {
+    index = index + c.size < 0 ? 0 : index + c.size;
+  }
+  if (index > c.size) {
+    index = c.size;
+  }
+  reserve(c, c.size + 1);
+  memmove(c.values + index + 1, c.values + index, (c.size - index) * sizeof(FourDValue));
+  c.values[index] = nullValue;
+  ++c.size;
+  assign(c.values[index], kind, value);
+  return collection;
+}
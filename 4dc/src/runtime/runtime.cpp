@@ -0,0 +1,29 @@
+#include "../../include/runtime.h"
+#include <cstdio>
+#include <cstdlib>
+
+
+int BUILTINalert(int i)
+{
+  printf("%i\n", i);
+  return 0;
+}
+
+// ALERT d'un réel : 15 chiffres significatifs, comme String
+int BUILTINalertReal(double d)
+{
+  printf("%.15g\n", d);
+  return 0;
+}
+
+int BUILTINalertLong(int64_t i)
+{
+  printf("%lld\n", static_cast<long long>(i));
+  return 0;
+}
+
+int BUILTINabort()
+{
+  abort();
+  return 0;
+}
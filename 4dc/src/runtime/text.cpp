@@ -0,0 +1,315 @@
+#include "../../include/runtime.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+FourDText* BUILTINtexts = nullptr;
+int32_t BUILTINtextCount = 0;
+
+/*
+ * Textes : une valeur texte est l'identifiant de son descripteur dans
+ * BUILTINtexts, 0 désignant le texte vide. Chaque valeur produite par le code
+ * généré porte une référence, que son consommateur (variable, concaténation,
+ * builtin) reprend ou rend par BUILTINtextRelease. Un texte dont on détient la
+ * seule référence est complété sur place : $t:=$t+$x est amorti en O(1).
+ */
+namespace {
+  const int32_t FREE = -2; // descripteur libre, réutilisable
+  int32_t tableCapacity = 0;
+  std::vector<int32_t> freeTexts;
+  FourDText emptyText = {FOURDTEXT_CONSTANT, 0, 0, 0, {nullptr}};
+
+  void fail(const char* message, int text)
+  {
+    fprintf(stderr, "Runtime Error: %s (text %i)\n", message, text);
+    exit(EXIT_FAILURE);
+  }
+
+  FourDText& descriptor(int text)
+  {
+    if (text == 0) {
+      return emptyText;
+    }
+    if (text < 0 || text >= BUILTINtextCount || BUILTINtexts[text].refs == FREE) {
+      fail("Invalid text", text);
+    }
+    return BUILTINtexts[text];
+  }
+
+  inline char* chars(FourDText& t)
+  {
+    return t.capacity ? t.data : t.small;
+  }
+
+  // Garantit la place de capacity octets, zéro final non compris
+  void reserve(FourDText& t, int32_t capacity)
+  {
+    if (capacity <= FOURDTEXT_SMALL || capacity <= t.capacity) {
+      return;
+    }
+    int32_t grown = t.capacity < 2 * FOURDTEXT_SMALL ? 2 * FOURDTEXT_SMALL : t.capacity;
+    while (grown < capacity) {
+      grown = grown > INT32_MAX / 2 ? INT32_MAX - 1 : grown * 2;
+    }
+    char* data = static_cast<char*>(t.capacity ? realloc(t.data, grown + 1) : malloc(grown + 1));
+    if (!data) {
+      fail("Out of memory", capacity);
+    }
+    if (!t.capacity) {
+      memcpy(data, t.small, t.size + 1);
+    }
+    t.data = data;
+    t.capacity = grown;
+  }
+
+  // Nouveau texte de size octets non initialisés, portant une référence.
+  // Le tableau des descripteurs peut être déplacé : les références obtenues
+  // avant l'appel ne sont plus valides.
+  int newText(int32_t size)
+  {
+    int text;
+    if (!freeTexts.empty()) {
+      text = freeTexts.back();
+      freeTexts.pop_back();
+    } else {
+      if (BUILTINtextCount == 0) {
+        BUILTINtextCount = 1; // 0 : texte vide
+      }
+      if (BUILTINtextCount >= tableCapacity) {
+        tableCapacity = tableCapacity ? 2 * tableCapacity : 64;
+        BUILTINtexts = static_cast<FourDText*>(realloc(BUILTINtexts, tableCapacity * sizeof(FourDText)));
+        if (!BUILTINtexts) {
+          fail("Out of memory", BUILTINtextCount);
+        }
+      }
+      text = BUILTINtextCount++;
+    }
+    FourDText& t = BUILTINtexts[text];
+    t.refs = 1;
+    t.size = 0;
+    t.capacity = 0;
+    t.length = -1;
+    reserve(t, size);
+    t.size = size;
+    chars(t)[size] = '\0';
+    return text;
+  }
+
+  void destroy(int text)
+  {
+    FourDText& t = BUILTINtexts[text];
+    if (t.capacity) {
+      free(t.data);
+    }
+    t.refs = FREE;
+    freeTexts.push_back(text);
+  }
+
+  // Caractères de left + right : chaque caractère commence par un octet qui
+  // n'est pas une suite UTF-8, les comptes s'additionnent
+  inline int32_t addLengths(int32_t left, int32_t right)
+  {
+    return left < 0 || right < 0 ? -1 : left + right;
+  }
+
+  // Ajoute suffix (length caractères) à la fin de t, dont on détient la seule
+  // référence
+  void append(FourDText& t, const char* suffix, int32_t size, int32_t length)
+  {
+    if (size > INT32_MAX - 1 - t.size) {
+      fail("Text too long", t.size);
+    }
+    reserve(t, t.size + size);
+    memmove(chars(t) + t.size, suffix, size);
+    t.size += size;
+    t.length = addLengths(t.length, length);
+    chars(t)[t.size] = '\0';
+  }
+
+  // Nouveau texte left + right ; les deux références sont rendues
+  int concat(int left, int right)
+  {
+    int32_t leftSize = descriptor(left).size;
+    int32_t rightSize = descriptor(right).size;
+    if (rightSize > INT32_MAX - 1 - leftSize) {
+      fail("Text too long", left);
+    }
+    int text = newText(leftSize + rightSize);
+    char* data = chars(BUILTINtexts[text]);
+    memcpy(data, chars(descriptor(left)), leftSize);
+    memcpy(data + leftSize, chars(descriptor(right)), rightSize);
+    BUILTINtexts[text].length = addLengths(descriptor(left).length, descriptor(right).length);
+    BUILTINtextRelease(left);
+    BUILTINtextRelease(right);
+    return text;
+  }
+
+  // Comparaison de 4D : les lettres ASCII sans tenir compte de la casse
+  inline unsigned char fold(unsigned char c)
+  {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+  }
+}
+
+
+int BUILTINtextNew(const char* data, int size)
+{
+  if (size <= 0) {
+    return 0;
+  }
+  // Un texte court peut être rangé dans BUILTINtexts, que newText déplace
+  char small[FOURDTEXT_SMALL];
+  if (size <= FOURDTEXT_SMALL) {
+    memcpy(small, data, size);
+    data = small;
+  }
+  int text = newText(size);
+  memcpy(chars(BUILTINtexts[text]), data, size);
+  return text;
+}
+
+const char* BUILTINtextData(int text, int* size)
+{
+  FourDText& t = descriptor(text);
+  *size = t.size;
+  return chars(t);
+}
+
+// Texte littéral, créé une fois par littéral et jamais libéré
+int BUILTINtextConstant(const char* data, int size)
+{
+  int text = BUILTINtextNew(data, size);
+  if (text) {
+    BUILTINtexts[text].refs = FOURDTEXT_CONSTANT;
+  }
+  return text;
+}
+
+int BUILTINtextRetain(int text)
+{
+  FourDText& t = descriptor(text);
+  if (t.refs != FOURDTEXT_CONSTANT) {
+    ++t.refs;
+  }
+  return text;
+}
+
+int BUILTINtextRelease(int text)
+{
+  FourDText& t = descriptor(text);
+  if (t.refs != FOURDTEXT_CONSTANT && --t.refs == 0) {
+    destroy(text);
+  }
+  return 0;
+}
+
+// left + right : complété sur place si on détient la seule référence de left
+int BUILTINtextConcat(int left, int right)
+{
+  FourDText& l = descriptor(left);
+  FourDText& r = descriptor(right);
+  if (r.size == 0) {
+    BUILTINtextRelease(right);
+    return left;
+  }
+  if (l.size == 0) {
+    BUILTINtextRelease(left);
+    return right;
+  }
+  if (l.refs == 1) {
+    append(l, chars(r), r.size, r.length);
+    BUILTINtextRelease(right);
+    return left;
+  }
+  return concat(left, right);
+}
+
+// $t:=$t+suffix : text porte aussi la référence de la variable, rendue juste
+// après par l'affectation. Le texte est complété sur place si personne
+// d'autre ne le référence.
+int BUILTINtextAppendTo(int text, int suffix)
+{
+  FourDText& t = descriptor(text);
+  FourDText& s = descriptor(suffix);
+  if (t.refs == 2) {
+    append(t, chars(s), s.size, s.length);
+    BUILTINtextRelease(suffix);
+    return text;
+  }
+  return BUILTINtextConcat(text, suffix);
+}
+
+// -1, 0 ou 1 selon l'ordre de left et right
+int BUILTINtextCompare(int left, int right)
+{
+  int order = BUILTINtextOrder(left, right);
+  BUILTINtextRelease(left);
+  BUILTINtextRelease(right);
+  return order;
+}
+
+// Comparaison sans rendre les références : SORT ARRAY et Find in array
+int BUILTINtextOrder(int left, int right)
+{
+  FourDText& l = descriptor(left);
+  FourDText& r = descriptor(right);
+  const unsigned char* a = reinterpret_cast<const unsigned char*>(chars(l));
+  const unsigned char* b = reinterpret_cast<const unsigned char*>(chars(r));
+  int32_t size = l.size < r.size ? l.size : r.size;
+  int result = 0;
+  for (int32_t i = 0; i < size && result == 0; ++i) {
+    result = fold(a[i]) - fold(b[i]);
+  }
+  if (result == 0) {
+    result = l.size - r.size;
+  }
+  return (result > 0) - (result < 0);
+}
+
+// String(nombre)
+int BUILTINtextFromInt(int value)
+{
+  char buffer[16];
+  int size = snprintf(buffer, sizeof(buffer), "%i", value);
+  int text = BUILTINtextNew(buffer, size);
+  BUILTINtexts[text].length = size;
+  return text;
+}
+
+// String(réel) : 15 chiffres significatifs, sans zéros inutiles
+int BUILTINtextFromReal(double value)
+{
+  char buffer[32];
+  int size = snprintf(buffer, sizeof(buffer), "%.15g", value);
+  int text = BUILTINtextNew(buffer, size);
+  BUILTINtexts[text].length = size;
+  return text;
+}
+
+// String(entier 64 bits)
+int BUILTINtextFromLong(int64_t value)
+{
+  char buffer[24];
+  int size = snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+  int text = BUILTINtextNew(buffer, size);
+  BUILTINtexts[text].length = size;
+  return text;
+}
+
+// Num(texte) : le nombre au début du texte, 0 s'il n'y en a pas
+int BUILTINtextToInt(int text)
+{
+  int value = static_cast<int>(strtol(chars(descriptor(text)), nullptr, 10));
+  BUILTINtextRelease(text);
+  return value;
+}
+
+int BUILTINalertText(int text)
+{
+  FourDText& t = descriptor(text);
+  fwrite(chars(t), 1, t.size, stdout);
+  putchar('\n');
+  BUILTINtextRelease(text);
+  return 0;
+}
@@ -0,0 +1,373 @@
+#include "../../include/runtime.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define FOURDC_SSE2_KERNELS
+#endif
+
+/*
+ * Length, Position, Substring, Replace string, Uppercase et Lowercase.
+ * Les positions sont comptées en caractères UTF-8 : un caractère commence à
+ * chaque octet qui n'est pas une suite (10xxxxxx). Les parcours avancent par
+ * blocs de 16 octets en SSE2 (présent sur tout processeur x86-64) : recherche
+ * du premier octet, comptage des caractères, changement de casse des blocs
+ * ASCII. Le nombre de caractères est conservé dans le descripteur : sur un
+ * texte ASCII, Substring et Position n'ont plus à compter.
+ */
+namespace {
+  const int32_t BLOCK = 16;
+
+  inline unsigned char fold(unsigned char c)
+  {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+  }
+
+  inline bool isLetter(unsigned char c)
+  {
+    return fold(c) >= 'a' && fold(c) <= 'z';
+  }
+
+  inline bool startsChar(unsigned char c)
+  {
+    return (c & 0xC0) != 0x80;
+  }
+
+  // Caractères des n premiers octets de data
+  int32_t countChars(const char* data, int32_t n)
+  {
+    int32_t count = 0;
+    int32_t i = 0;
+#ifdef FOURDC_SSE2_KERNELS
+    const __m128i firstStart = _mm_set1_epi8(-64); // 0xC0
+    for (; i + BLOCK <= n; i += BLOCK) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      // Les suites 0x80 à 0xBF sont les octets signés inférieurs à -64
+      count += BLOCK - __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(v, firstStart)));
+    }
+#endif
+    for (; i < n; ++i) {
+      count += startsChar(data[i]);
+    }
+    return count;
+  }
+
+  // Octet où commence le caractère d'indice chars (à partir de 0), size au-delà
+  int32_t charOffset(const char* data, int32_t size, int32_t chars)
+  {
+    int32_t seen = 0;
+    int32_t i = 0;
+#ifdef FOURDC_SSE2_KERNELS
+    for (; i + BLOCK <= size; i += BLOCK) {
+      int32_t inBlock = countChars(data + i, BLOCK);
+      if (seen + inBlock > chars) {
+        break;
+      }
+      seen += inBlock;
+    }
+#endif
+    for (; i < size; ++i) {
+      if (startsChar(data[i])) {
+        if (seen == chars) {
+          return i;
+        }
+        ++seen;
+      }
+    }
+    return size;
+  }
+
+  // Premier indice de from à last (compris) où se trouve c, sans tenir compte
+  // de la casse ASCII ; -1 s'il n'y en a pas
+  int32_t findByte(const char* data, int32_t from, int32_t last, unsigned char c)
+  {
+    if (!isLetter(c)) {
+      const void* found = memchr(data + from, c, last - from + 1);
+      return found ? static_cast<int32_t>(static_cast<const char*>(found) - data) : -1;
+    }
+    unsigned char lower = fold(c);
+    int32_t i = from;
+#ifdef FOURDC_SSE2_KERNELS
+    // x | 0x20 ne vaut la minuscule d'une lettre que pour ses deux casses
+    const __m128i needle = _mm_set1_epi8(static_cast<char>(lower));
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    for (; i + BLOCK <= last + 1; i += BLOCK) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(v, caseBit), needle));
+      if (mask) {
+        return i + __builtin_ctz(mask);
+      }
+    }
+#endif
+    for (; i <= last; ++i) {
+      if (fold(data[i]) == lower) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // Premier octet, à partir de from, où find apparaît dans data ; -1 sinon
+  int32_t search(const char* data, int32_t size, const char* find, int32_t findSize, int32_t from)
+  {
+    if (findSize == 0 || findSize > size) {
+      return -1;
+    }
+    int32_t last = size - findSize;
+    while (from <= last) {
+      int32_t i = findByte(data, from, last, find[0]);
+      if (i < 0) {
+        return -1;
+      }
+      int32_t k = 1;
+      while (k < findSize && fold(data[i + k]) == fold(find[k])) {
+        ++k;
+      }
+      if (k == findSize) {
+        return i;
+      }
+      from = i + 1;
+    }
+    return -1;
+  }
+
+  // Casse des caractères de deux octets : Latin-1, Latin étendu A, grec et
+  // cyrillique. Chaque correspondance garde la taille UTF-8 du caractère.
+  uint32_t upperCodePoint(uint32_t c)
+  {
+    if ((c >= 0xE0 && c <= 0xFE && c != 0xF7) || (c >= 0x3B1 && c <= 0x3CB && c != 0x3C2)
+        || (c >= 0x430 && c <= 0x44F)) {
+      return c - 0x20;
+    }
+    if (c == 0xFF) return 0x178;
+    if (c == 0x3C2) return 0x3A3;
+    if (c >= 0x450 && c <= 0x45F) return c - 0x50;
+    // Latin étendu A : paires majuscule/minuscule consécutives ; ı et ſ n'ont
+    // pas de majuscule de deux octets
+    if (((c >= 0x101 && c <= 0x137) || (c >= 0x14B && c <= 0x177)) && (c & 1) && c != 0x131) {
+      return c - 1;
+    }
+    if (((c >= 0x13A && c <= 0x148) || (c >= 0x17A && c <= 0x17E)) && !(c & 1)) {
+      return c - 1;
+    }
+    return c;
+  }
+
+  uint32_t lowerCodePoint(uint32_t c)
+  {
+    if ((c >= 0xC0 && c <= 0xDE && c != 0xD7) || (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+        || (c >= 0x410 && c <= 0x42F)) {
+      return c + 0x20;
+    }
+    if (c == 0x178) return 0xFF;
+    if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+    if (((c >= 0x100 && c <= 0x136) || (c >= 0x14A && c <= 0x176)) && !(c & 1) && c != 0x130) {
+      return c + 1;
+    }
+    if (((c >= 0x139 && c <= 0x147) || (c >= 0x179 && c <= 0x17D)) && (c & 1)) {
+      return c + 1;
+    }
+    return c;
+  }
+
+  // Change sur place la casse des size octets de data
+  void convertCase(char* data, int32_t size, bool upper)
+  {
+    const char from = upper ? 'a' : 'A';
+    int32_t i = 0;
+    while (i < size) {
+#ifdef FOURDC_SSE2_KERNELS
+      if (i + BLOCK <= size) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // Bloc ASCII : les lettres concernées basculent le bit 0x20
+        if (_mm_movemask_epi8(v) == 0) {
+          __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(from - 1)),
+                                          _mm_cmplt_epi8(v, _mm_set1_epi8(from + 26)));
+          v = _mm_xor_si128(v, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), v);
+          i += BLOCK;
+          continue;
+        }
+      }
+#endif
+      unsigned char c = data[i];
+      if (c < 0x80) {
+        if (c >= from && c < from + 26) {
+          data[i] = c ^ 0x20;
+        }
+        ++i;
+      } else if ((c & 0xE0) == 0xC0 && i + 1 < size && (data[i + 1] & 0xC0) == 0x80) {
+        uint32_t code = ((c & 0x1F) << 6) | (data[i + 1] & 0x3F);
+        code = upper ? upperCodePoint(code) : lowerCodePoint(code);
+        data[i] = static_cast<char>(0xC0 | (code >> 6));
+        data[i + 1] = static_cast<char>(0x80 | (code & 0x3F));
+        i += 2;
+      } else {
+        // Autres caractères, octets invalides compris : inchangés
+        ++i;
+      }
+    }
+  }
+
+  inline char* textChars(int text)
+  {
+    FourDText& t = BUILTINtexts[text];
+    return t.capacity ? t.data : t.small;
+  }
+
+  // Nombre de caractères, compté une fois par texte
+  int32_t textLength(int text)
+  {
+    int32_t size;
+    const char* data = BUILTINtextData(text, &size);
+    if (size == 0) {
+      return 0;
+    }
+    FourDText& t = BUILTINtexts[text];
+    if (t.length < 0) {
+      t.length = countChars(data, size);
+    }
+    return t.length;
+  }
+
+  // Octet du caractère d'indice chars ; direct si chaque octet est un caractère
+  int32_t textOffset(int text, int32_t chars)
+  {
+    int32_t size;
+    const char* data = BUILTINtextData(text, &size);
+    if (chars <= 0) {
+      return 0;
+    }
+    if (textLength(text) == size) {
+      return chars < size ? chars : size;
+    }
+    return charOffset(data, size, chars);
+  }
+
+  // Caractère (à partir de 1) de l'octet offset
+  int32_t textPosition(int text, int32_t offset)
+  {
+    int32_t size;
+    const char* data = BUILTINtextData(text, &size);
+    return (textLength(text) == size ? offset : countChars(data, offset)) + 1;
+  }
+
+  int changeCase(int text, bool upper)
+  {
+    int32_t size;
+    const char* data = BUILTINtextData(text, &size);
+    if (size == 0) {
+      return text;
+    }
+    int result = text;
+    if (BUILTINtexts[text].refs != 1) {
+      result = BUILTINtextNew(data, size);
+      BUILTINtexts[result].length = BUILTINtexts[text].length;
+      BUILTINtextRelease(text);
+    }
+    convertCase(textChars(result), size, upper);
+    return result;
+  }
+}
+
+
+int BUILTINtextLength(int text)
+{
+  int32_t length = textLength(text);
+  BUILTINtextRelease(text);
+  return length;
+}
+
+int BUILTINtextPositionFrom(int find, int text, int start)
+{
+  int32_t size, findSize;
+  const char* data = BUILTINtextData(text, &size);
+  const char* findData = BUILTINtextData(find, &findSize);
+  int32_t offset = search(data, size, findData, findSize, textOffset(text, start < 1 ? 0 : start - 1));
+  int position = offset < 0 ? 0 : textPosition(text, offset);
+  BUILTINtextRelease(find);
+  BUILTINtextRelease(text);
+  return position;
+}
+
+int BUILTINtextPosition(int find, int text)
+{
+  return BUILTINtextPositionFrom(find, text, 1);
+}
+
+// count caractères à partir du caractère start
+int BUILTINtextSubstring(int text, int start, int count)
+{
+  int32_t size;
+  BUILTINtextData(text, &size);
+  int32_t length = textLength(text);
+  if (start < 1) {
+    start = 1;
+  }
+  if (count <= 0 || start > length) {
+    BUILTINtextRelease(text);
+    return 0;
+  }
+  if (count > length - start + 1) {
+    count = length - start + 1;
+  }
+  if (start == 1 && count == length) {
+    return text;
+  }
+  int32_t begin = textOffset(text, start - 1);
+  int32_t end = textOffset(text, start - 1 + count);
+  int result = BUILTINtextNew(textChars(text) + begin, end - begin);
+  BUILTINtexts[result].length = count;
+  BUILTINtextRelease(text);
+  return result;
+}
+
+int BUILTINtextSubstringToEnd(int text, int start)
+{
+  return BUILTINtextSubstring(text, start, INT32_MAX);
+}
+
+// Remplace chaque occurrence de oldText, sans tenir compte de la casse ASCII
+int BUILTINtextReplace(int text, int oldText, int newText)
+{
+  int32_t size, oldSize, newSize;
+  const char* data = BUILTINtextData(text, &size);
+  const char* oldData = BUILTINtextData(oldText, &oldSize);
+  const char* newData = BUILTINtextData(newText, &newSize);
+  int32_t found = search(data, size, oldData, oldSize, 0);
+  int result = text;
+  if (found >= 0) {
+    std::string replaced;
+    int32_t from = 0;
+    while (found >= 0) {
+      replaced.append(data + from, found - from);
+      replaced.append(newData, newSize);
+      from = found + oldSize;
+      found = search(data, size, oldData, oldSize, from);
+    }
+    replaced.append(data + from, size - from);
+    if (replaced.size() > static_cast<size_t>(INT32_MAX - 1)) {
+      fprintf(stderr, "Runtime Error: Text too long (text %i)\n", text);
+      exit(EXIT_FAILURE);
+    }
+    result = BUILTINtextNew(replaced.data(), static_cast<int>(replaced.size()));
+    BUILTINtextRelease(text);
+  }
+  BUILTINtextRelease(oldText);
+  BUILTINtextRelease(newText);
+  return result;
+}
+
+int BUILTINtextUppercase(int text)
+{
+  return changeCase(text, true);
+}
+
+int BUILTINtextLowercase(int text)
+{
+  return changeCase(text, false);
+}
@@ -0,0 +1,268 @@
+#include "../include/server.h"
+#include "../include/util/logger.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+  // Descripteurs transmis par le client : entrée, sortie et erreur standard
+  const int FDS_NUMBER = 3;
+  // Taille maximale d'une requête (dossier courant et arguments)
+  const uint32_t MAX_REQUEST_SIZE = 1 << 20;
+  // Délai de réception d'une requête, en secondes
+  const int REQUEST_TIMEOUT = 10;
+  
+  volatile sig_atomic_t stopRequested = 0;
+  void requestStop(int)
+  {
+    stopRequested = 1;
+  }
+  
+  bool socketAddress(const string& path, sockaddr_un& addr)
+  {
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+      Logger::error << "Error: Invalid socket path \"" << path << "\"" << endl;
+      return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    return true;
+  }
+  
+  bool writeAll(int fd, const char* data, size_t size)
+  {
+    while (size > 0) {
+      ssize_t n = write(fd, data, size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      data += n;
+      size -= n;
+    }
+    return true;
+  }
+  
+  bool readAll(int fd, char* data, size_t size)
+  {
+    while (size > 0) {
+      ssize_t n = read(fd, data, size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      data += n;
+      size -= n;
+    }
+    return true;
+  }
+  
+  // Seul l'utilisateur du démon peut lui soumettre des compilations
+  bool trustedPeer(int client)
+  {
+    ucred cred;
+    socklen_t length = sizeof(cred);
+    if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &cred, &length) != 0 || length != sizeof(cred)) {
+      Logger::error << "Error: Cannot identify the client: " << strerror(errno) << endl;
+      return false;
+    }
+    if (cred.uid != getuid()) {
+      Logger::error << "Error: Request from uid " << cred.uid << " refused" << endl;
+      return false;
+    }
+    return true;
+  }
+  
+  // Requête : taille (32 bits), puis dossier courant et arguments terminés par '\0'.
+  // Les descripteurs accompagnent le premier octet. Lue par le processus fils :
+  // un client lent ne bloque que sa propre compilation.
+  bool receiveRequest(int client, int fds[FDS_NUMBER], string& cwd, vector<string>& args)
+  {
+    timeval timeout = {REQUEST_TIMEOUT, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    uint32_t size;
+    char control[CMSG_SPACE(sizeof(int) * FDS_NUMBER)];
+    iovec iov = {&size, sizeof(size)};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(client, &msg, MSG_WAITALL);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (n != sizeof(size) || !cmsg || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * FDS_NUMBER)) {
+      return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * FDS_NUMBER);
+    if (size > MAX_REQUEST_SIZE) {
+      Logger::error << "Error: Request too large (" << size << " bytes)" << endl;
+      for (int i = 0; i < FDS_NUMBER; ++i) close(fds[i]);
+      return false;
+    }
+    
+    string payload(size, '\0');
+    if (!readAll(client, &payload[0], size)) {
+      for (int i = 0; i < FDS_NUMBER; ++i) close(fds[i]);
+      return false;
+    }
+    size_t begin = 0, end;
+    while ((end = payload.find('\0', begin)) != string::npos) {
+      args.push_back(payload.substr(begin, end - begin));
+      begin = end + 1;
+    }
+    if (args.empty()) {
+      for (int i = 0; i < FDS_NUMBER; ++i) close(fds[i]);
+      return false;
+    }
+    cwd = args.front();
+    args.erase(args.begin());
+    return true;
+  }
+  
+  // Processus fils : lit la requête, reprend l'environnement du client et compile
+  void runRequest(int client, Server::Command& command)
+  {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    int fds[FDS_NUMBER];
+    string cwd;
+    vector<string> args;
+    bool received = receiveRequest(client, fds, cwd, args);
+    close(client);
+    if (!received) {
+      Logger::error << "Error: Invalid compile request" << endl;
+      exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < FDS_NUMBER; ++i) {
+      dup2(fds[i], i);
+      close(fds[i]);
+    }
+    if (chdir(cwd.c_str()) != 0) {
+      Logger::error << "Error: Cannot change directory to \"" << cwd << "\"" << endl;
+      exit(EXIT_FAILURE);
+    }
+    int status = command(args);
+    cout.flush();
+    exit(status);
+  }
+}
+
+namespace Server {
+  int serve(const string& socketPath, Command command)
+  {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) {
+      return EXIT_FAILURE;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socketPath.c_str()); // socket d'un démon précédent
+    if (listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+      Logger::error << "Error: Cannot listen on \"" << socketPath << "\": " << strerror(errno) << endl;
+      return EXIT_FAILURE;
+    }
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    signal(SIGPIPE, SIG_IGN);
+    Logger::info << "Serveur de compilation en attente sur " << socketPath << endl;
+    
+    map<pid_t, int> pending; // compilation en cours -> connexion du client
+    pollfd pfd = {listener, POLLIN, 0};
+    while (!stopRequested) {
+      if (poll(&pfd, 1, 50) > 0) {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client >= 0 && trustedPeer(client)) {
+          pid_t pid = fork();
+          if (pid == 0) {
+            close(listener);
+            runRequest(client, command);
+          }
+          if (pid > 0) {
+            pending[pid] = client;
+          } else {
+            Logger::error << "Error: fork: " << strerror(errno) << endl;
+            close(client);
+          }
+        } else if (client >= 0) {
+          close(client);
+        }
+      }
+      
+      // Renvoie le code de sortie des compilations terminées
+      int status;
+      pid_t pid;
+      while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        auto it = pending.find(pid);
+        if (it == pending.end()) continue;
+        int32_t code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        writeAll(it->second, (const char*) &code, sizeof(code));
+        close(it->second);
+        pending.erase(it);
+      }
+    }
+    
+    close(listener);
+    unlink(socketPath.c_str());
+    Logger::info << "Arret du serveur de compilation" << endl;
+    return EXIT_SUCCESS;
+  }
+  
+  int request(const string& socketPath, const vector<string>& args)
+  {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) {
+      return EXIT_FAILURE;
+    }
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0 || connect(server, (sockaddr*) &addr, sizeof(addr)) != 0) {
+      Logger::error << "Error: Cannot connect to \"" << socketPath << "\": " << strerror(errno) << endl;
+      return EXIT_FAILURE;
+    }
+    
+    char* cwd = getcwd(nullptr, 0);
+    string payload = cwd ? cwd : ".";
+    free(cwd);
+    payload += '\0';
+    for (auto& arg : args) {
+      payload += arg;
+      payload += '\0';
+    }
+    uint32_t size = payload.size();
+    
+    int fds[FDS_NUMBER] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    char control[CMSG_SPACE(sizeof(fds))];
+    memset(control, 0, sizeof(control));
+    iovec iov = {&size, sizeof(size)};
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    
+    int32_t code;
+    if (sendmsg(server, &msg, 0) != sizeof(size)
+        || !writeAll(server, payload.data(), payload.size())
+        || !readAll(server, (char*) &code, sizeof(code))) {
+      Logger::error << "Error: Connection to the compile server lost" << endl;
+      close(server);
+      return EXIT_FAILURE;
+    }
+    close(server);
+    return code;
+  }
+}
@@ -0,0 +1,456 @@
+#include "../include/session.h"
+#include "../include/compileerror.h"
+#include "../include/func.h"
+#include "../include/functionsignature.h"
+#include "../include/util/logger.h"
+#include "../include/util/util.h"
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace llvm;
+
+namespace {
+  // Temps écoulé depuis since, en millisecondes
+  double elapsedMs(chrono::steady_clock::time_point since)
+  {
+    auto elapsed = chrono::steady_clock::now() - since;
+    return chrono::duration_cast<chrono::microseconds>(elapsed).count() / 1000.;
+  }
+
+  bool readFile(const string& filename, string& source)
+  {
+    ifstream in(filename);
+    if (!in) {
+      return false;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+    source = ss.str();
+    return true;
+  }
+}
+
+Session::Session(const vector<pair<string,File>>& files, const Options& options)
+  : _builder("Session"), _files(files), _indirect(options.watch())
+{
+  assert(!files.empty());
+  // Le JIT classique sait recompiler une fonction déjà générée
+  // (recompileAndRelinkFunction), contrairement à MCJIT : pas de cache disque.
+  if (!options.cacheDirectory().empty()) {
+    Logger::warning << "Warning: --cache est ignore avec --session" << endl;
+  }
+  this->_builder.setOptLevel(options.optLevel(), options.sizeLevel());
+  this->_builder.setTarget(options.targetCPU(), options.targetFeatures());
+  this->_builder.setFastMath(options.fastMath());
+  // Le code natif en cours d'exécution ne doit jamais rappeler le JIT
+  this->_builder.setLazyCompilation(options.lazyCompilation() && !this->_indirect);
+  this->_builder.createJIT();
+  // Pas d'optimisation inter-fonctions : une méthode inlinée dans ses
+  // appelantes ne pourrait plus être remplacée seule.
+  this->_builder.setOptimizer(this->_builder.getStandardOptimizer());
+  this->_builder.declareBuiltins();
+}
+
+Session::~Session()
+{
+  for (auto& method : this->_methods) {
+    delete method.second.def;
+  }
+}
+
+unsigned Session::update()
+{
+  auto start = chrono::steady_clock::now();
+  map<string, VarType> oldGlobalVars = this->_globalVars;
+  map<string, VarType> oldPersistentVars = this->_persistentVars;
+  map<string, VarType> oldReturnTypes = this->_builder._returnTypes;
+  map<string, VarType> oldPropertyTypes = this->_builder._propertyTypes;
+  
+  // Parse les fichiers modifiés seulement. Le type d'un appel dépend du
+  // résultat de la méthode appelée : les appelantes d'une méthode dont la
+  // signature change sont analysées de nouveau depuis leur source, jusqu'à
+  // ce qu'aucune signature ne change plus.
+  vector<pair<Func*, uint64_t>> parsed;
+  set<string> redeclared;
+  try {
+    for (auto& file : this->_files) {
+      this->parse(file, false, parsed);
+    }
+    unsigned tagged = 0;
+    while (tagged < parsed.size()) {
+      tagged = parsed.size();
+      vector<Func*> methods;
+      set<string> names;
+      for (auto& method : parsed) {
+        methods.push_back(method.first);
+        names.insert(method.first->name());
+      }
+      this->_builder.taggingPass(methods, this->_globalVars, this->_persistentVars);
+      redeclared.clear();
+      for (Func* Fdef : methods) {
+        auto it = this->_methods.find(Fdef->name());
+        if (it == this->_methods.end() || !(*it->second.def->signature() == *Fdef->signature())) {
+          redeclared.insert(Fdef->name());
+        }
+      }
+      for (auto& file : this->_files) {
+        auto it = this->_methods.find(Util::trim(Util::downcase(string(file.first))));
+        if (it == this->_methods.end() || names.count(it->first)) {
+          continue;
+        }
+        for (auto& callee : it->second.callees) {
+          if (redeclared.count(callee)) {
+            this->parse(file, true, parsed);
+            break;
+          }
+        }
+      }
+    }
+  } catch (...) {
+    // Les méthodes déjà compilées restent inchangées
+    for (auto& method : parsed) {
+      delete method.first;
+    }
+    this->_builder._returnTypes = oldReturnTypes;
+    this->_builder._propertyTypes = oldPropertyTypes;
+    throw;
+  }
+  if (parsed.empty()) {
+    Logger::info << "Session : aucune methode modifiee" << endl;
+    return 0;
+  }
+  
+  this->_builder.createGlobals(this->_globalVars, this->_builder.globalVars());
+  this->_builder.createGlobals(this->_persistentVars, this->_builder.persistentVars());
+  Logger::debug << endl;
+  
+  // Méthodes à recompiler : les méthodes modifiées, les appelantes des
+  // méthodes dont la signature a changé et les utilisatrices des variables
+  // dont le type a changé.
+  set<string> affected, changedVars;
+  for (auto& method : parsed) {
+    affected.insert(method.first->name());
+  }
+  for (auto& var : oldGlobalVars) {
+    if (this->_globalVars[var.first] != var.second) changedVars.insert(var.first);
+  }
+  for (auto& var : oldPersistentVars) {
+    if (this->_persistentVars[var.first] != var.second) changedVars.insert(var.first);
+  }
+  for (auto& method : this->_methods) {
+    for (auto& callee : method.second.callees) {
+      if (redeclared.count(callee)) affected.insert(method.first);
+    }
+    for (auto& var : method.second.globals) {
+      if (changedVars.count(var)) affected.insert(method.first);
+    }
+  }
+  
+  // Mise à jour des définitions
+  for (auto& method : parsed) {
+    Func* Fdef = method.first;
+    auto it = this->_methods.find(Fdef->name());
+    if (it != this->_methods.end()) {
+      delete it->second.def;
+    }
+    Method& m = this->_methods[Fdef->name()];
+    m.def = Fdef;
+    m.hash = method.second;
+  }
+  
+  // Une méthode dont la signature change est déclarée de nouveau ; l'ancienne
+  // version est supprimée une fois ses appelantes recompilées. En mode
+  // indirect, toute méthode recompilée est une nouvelle fonction : l'ancienne
+  // version peut être en cours d'exécution et n'est jamais modifiée.
+  Module& M = this->_builder.module();
+  const set<string>& replaced = this->_indirect ? affected : redeclared;
+  vector<Function*> oldFunctions;
+  for (auto& name : replaced) {
+    Function* old = M.getFunction(name);
+    if (old) {
+      old->setName(name + ".old");
+      oldFunctions.push_back(old);
+    }
+  }
+  for (auto& name : affected) {
+    Function* F = M.getFunction(name);
+    if (F && !F->empty()) {
+      F->deleteBody();
+    }
+  }
+  for (auto& name : replaced) {
+    Func::create(this->_methods[name].def->signature(), this->_builder);
+  }
+  if (this->_indirect) {
+    Type* slotType = this->_builder.dataLayout()->getIntPtrType(this->_builder.context());
+    for (auto& name : redeclared) {
+      if (!this->_builder._methodSlots.count(name)) {
+        this->_builder._methodSlots[name] = new GlobalVariable(
+            M, slotType, false, GlobalValue::InternalLinkage,
+            ConstantInt::get(slotType, 0), name + ".slot"
+        );
+      }
+    }
+  }
+  
+  // Compilation
+  try {
+    for (auto& name : affected) {
+      Method& m = this->_methods[name];
+      Function* F = this->_builder.build(m.def);
+      this->recordDependencies(m, F);
+      // Le code déjà généré est remplacé par un saut vers la nouvelle version
+      if (!this->_indirect && !redeclared.count(name)) {
+        this->_builder._jit->recompileAndRelinkFunction(F);
+      }
+    }
+  } catch (const CompileError&) {
+    // Le code natif précédent reste en place : les fichiers seront
+    // recompilés à la prochaine mise à jour.
+    for (auto& method : parsed) {
+      this->_methods[method.first->name()].hash = 0;
+    }
+    throw;
+  }
+  if (this->_indirect) {
+    // Les nouvelles versions sont installées une fois toutes compilées : un
+    // appel en cours d'exécution utilise l'ancienne ou la nouvelle version.
+    for (auto& name : affected) {
+      void* code = this->_builder._jit->getPointerToFunction(M.getFunction(name));
+      void* slot = this->_builder._jit->getPointerToGlobal(this->_builder._methodSlots[name]);
+      reinterpret_cast<atomic<intptr_t>*>(slot)
+          ->store(reinterpret_cast<intptr_t>(code), memory_order_release);
+    }
+    // L'ancien code natif peut être en cours d'exécution : il est libéré à
+    // la fin de l'exécution, par releaseRetired
+    for (auto& old : oldFunctions) {
+      old->deleteBody();
+      this->_retired.push_back(old);
+    }
+  } else {
+    for (auto& old : oldFunctions) {
+      if (old->use_empty()) {
+        this->_builder._jit->freeMachineCodeForFunction(old);
+        old->eraseFromParent();
+      }
+    }
+  }
+  
+  Logger::info << "Session : " << affected.size() << " methode(s) recompilee(s) sur "
+               << this->_methods.size() << " en " << elapsedMs(start) << " ms" << endl;
+  return affected.size();
+}
+
+/*
+ * Parse le fichier d'une méthode, s'il a changé depuis la dernière mise à
+ * jour ou si force est vrai, et l'ajoute à parsed. Un fichier illisible
+ * (en cours d'écriture, supprimé...) garde la version précédente de la
+ * méthode ; sans version précédente, ou si elle doit être analysée de
+ * nouveau, la mise à jour échoue.
+ */
+void Session::parse(const pair<string,File>& file, bool force, vector<pair<Func*, uint64_t>>& parsed)
+{
+  string source;
+  string name = Util::trim(Util::downcase(string(file.first)));
+  auto it = this->_methods.find(name);
+  if (!readFile(file.second.filename(), source)) {
+    string message = "Error: Cannot read file \"" + file.second.filename() + "\"";
+    if (force || it == this->_methods.end()) {
+      throw CompileError(message);
+    }
+    Logger::error << message << ", previous version of \"" << name << "\" kept" << endl;
+    return;
+  }
+  uint64_t hash = Util::hash(source);
+  if (!force && it != this->_methods.end() && it->second.hash == hash) {
+    return;
+  }
+  istringstream in(source);
+  Func* Fdef = this->_builder.parse(this->_globalVars, this->_persistentVars, file.first, in);
+  parsed.emplace_back(Fdef, hash);
+  if (&file == &this->_files.back()) {
+    this->_entry = Fdef->name();
+  }
+}
+
+void* Session::entryPoint()
+{
+  auto it = this->_methods.find(this->_entry);
+  if (it == this->_methods.end()) {
+    Logger::error << "Error: No entry method" << endl;
+    return nullptr;
+  }
+  if (it->second.def->signature()->argsNumber() != 0) {
+    Logger::error << "Build Error: " << *it->second.def->signature() << " must take 0 argument" << endl;
+    return nullptr;
+  }
+  if (this->_indirect) {
+    void* slot = this->_builder._jit->getPointerToGlobal(this->_builder._methodSlots[this->_entry]);
+    return reinterpret_cast<void*>(reinterpret_cast<atomic<intptr_t>*>(slot)->load(memory_order_acquire));
+  }
+  return this->_builder._jit->getPointerToFunction(this->_builder.module().getFunction(this->_entry));
+}
+
+bool Session::run()
+{
+  void* entry = this->entryPoint();
+  if (!entry) {
+    return false;
+  }
+  Logger::info << "Execution :" << endl;
+  auto start = chrono::steady_clock::now();
+  int (*f)() = (int (*)())(intptr_t) entry;
+  int result = f();
+  Logger::info << "=> " << result << endl;
+  Logger::info << "Temps d'execution : " << elapsedMs(start) << " ms" << endl;
+  return true;
+}
+
+void Session::loop(istream& in)
+{
+  Logger::info << "Session : commandes reload, run, quit" << endl;
+  string command;
+  while (getline(in, command)) {
+    Util::downcase(Util::trim(command));
+    try {
+      if (command == "reload") {
+        this->update();
+      } else if (command == "run") {
+        this->run();
+      } else if (command == "quit") {
+        break;
+      } else if (!command.empty()) {
+        Logger::error << "Error: Unknown command \"" << command << "\"" << endl;
+      }
+    } catch (const CompileError& e) {
+      Logger::error << e.what() << endl;
+    }
+  }
+}
+
+bool Session::watch()
+{
+  void* entry = this->entryPoint();
+  if (!entry) {
+    return false;
+  }
+  
+  // Les éditeurs remplacent souvent le fichier : on surveille donc les dossiers
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    Logger::error << "Error: inotify: " << strerror(errno) << endl;
+    return false;
+  }
+  map<int, string> directories;
+  set<string> watched;
+  for (auto& file : this->_files) {
+    const string& filename = file.second.filename();
+    string directory = Util::dirname(filename);
+    int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+      Logger::error << "Error: inotify: \"" << directory << "\": " << strerror(errno) << endl;
+      close(fd);
+      return false;
+    }
+    directories[wd] = directory;
+    watched.insert(directory + "/" + filename.substr(filename.find_last_of('/') + 1));
+  }
+  
+  // Seul ce thread utilise le Builder et le JIT : le thread d'exécution
+  // n'appelle que du code natif, qui passe par les slots des méthodes.
+  atomic<bool> done(false);
+  int result = 0;
+  Logger::info << "Execution (surveillance des fichiers) :" << endl;
+  auto start = chrono::steady_clock::now();
+  thread execution([&] {
+    int (*f)() = (int (*)())(intptr_t) entry;
+    result = f();
+    done = true;
+  });
+  
+  alignas(inotify_event) char buffer[4096];
+  pollfd pfd = {fd, POLLIN, 0};
+  while (!done) {
+    if (poll(&pfd, 1, 100) <= 0) {
+      continue;
+    }
+    bool changed = false;
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+      for (char* p = buffer; p < buffer + length; ) {
+        inotify_event* event = reinterpret_cast<inotify_event*>(p);
+        if (event->len && watched.count(directories[event->wd] + "/" + event->name)) {
+          changed = true;
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+    if (changed) {
+      try {
+        this->update();
+      } catch (const CompileError& e) {
+        // L'exécution continue avec les versions précédentes
+        Logger::error << e.what() << endl;
+      }
+    }
+  }
+  execution.join();
+  close(fd);
+  this->releaseRetired();
+  
+  Logger::info << "=> " << result << endl;
+  Logger::info << "Temps d'execution : " << elapsedMs(start) << " ms" << endl;
+  return true;
+}
+
+/*
+ * Supprime les anciennes versions des méthodes remplacées à chaud, et leur
+ * code natif, une fois que plus aucune exécution ne peut s'y trouver.
+ */
+void Session::releaseRetired()
+{
+  for (auto& old : this->_retired) {
+    if (old->use_empty()) {
+      this->_builder._jit->freeMachineCodeForFunction(old);
+      old->eraseFromParent();
+    }
+  }
+  this->_retired.clear();
+}
+
+void Session::recordDependencies(Method& method, Function* F)
+{
+  method.callees.clear();
+  method.globals.clear();
+  for (auto& BB : *F) {
+    for (auto& I : BB) {
+      if (CallInst* call = dyn_cast<CallInst>(&I)) {
+        Function* callee = call->getCalledFunction();
+        if (callee && this->_methods.count(callee->getName().str())) {
+          method.callees.insert(callee->getName().str());
+        }
+      }
+      for (auto& op : I.operands()) {
+        GlobalVariable* var = dyn_cast<GlobalVariable>(op);
+        if (!var) continue;
+        // En mode indirect, un appel de méthode est un chargement de son slot
+        string name = var->getName().str();
+        auto slot = this->_builder._methodSlots.find(name.substr(0, name.rfind(".slot")));
+        if (slot != this->_builder._methodSlots.end() && slot->second == var) {
+          method.callees.insert(slot->first);
+        } else {
+          method.globals.insert(name);
+        }
+      }
+    }
+  }
+}
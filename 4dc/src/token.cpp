@@ -58,6 +58,9 @@ std::ostream& operator<<(std::ostream& out, TokenType tokType)
   case TokenType::STRING:
     out << "STRING";
     break;
+  case TokenType::PROPERTY:
+    out << "PROPERTY";
+    break;
   case TokenType::DOLLAR:
     out << "DOLLAR";
     break;
@@ -76,6 +79,12 @@ std::ostream& operator<<(std::ostream& out, TokenType tokType)
   case TokenType::RIGHTB:
     out << "RIGHTB";
     break;
+  case TokenType::LEFTSB:
+    out << "LEFTSB";
+    break;
+  case TokenType::RIGHTSB:
+    out << "RIGHTSB";
+    break;
   case TokenType::SEMICOL:
     out << "SEMICOL";
     break;
@@ -109,6 +118,12 @@ std::ostream& operator<<(std::ostream& out, TokenType tokType)
   case TokenType::UNTIL:
     out << "UNTIL";
     break;
+  case TokenType::CASEOF:
+    out << "CASEOF";
+    break;
+  case TokenType::ENDCASE:
+    out << "ENDCASE";
+    break;
   case TokenType::AFFECT:
     out << "AFFECT";
     break;
@@ -134,6 +149,8 @@ std::string tokenTypeToString(TokenType tokType) {
     return "NUM";
   case TokenType::STRING:
     return "STRING";
+  case TokenType::PROPERTY:
+    return "PROPERTY";
   case TokenType::DOLLAR:
     return "$";
   case TokenType::DIAMOND:
@@ -146,6 +163,10 @@ std::string tokenTypeToString(TokenType tokType) {
     return "{";
   case TokenType::RIGHTB:
     return "}";
+  case TokenType::LEFTSB:
+    return "[";
+  case TokenType::RIGHTSB:
+    return "]";
   case TokenType::SEMICOL:
     return ";";
   case TokenType::COLON:
@@ -168,6 +189,10 @@ std::string tokenTypeToString(TokenType tokType) {
     return "Repeat";
   case TokenType::UNTIL:
     return "Until";
+  case TokenType::CASEOF:
+    return "Case of";
+  case TokenType::ENDCASE:
+    return "End case";
   case TokenType::AFFECT:
     return ":=";
   case TokenType::OP:
@@ -70,6 +70,15 @@ namespace Util {
     return string(basenameBegin, basenameEnd);
   }
   
+  string dirname(const string& path)
+  {
+    auto slash = path.find_last_of("/\\");
+    if (slash == string::npos) {
+      return ".";
+    }
+    return slash == 0 ? path.substr(0, 1) : path.substr(0, slash);
+  }
+  
   double str2dbl(const std::string& str)
   {
     return strtod(str.c_str(), 0);
@@ -79,4 +88,15 @@ namespace Util {
   {
     return strtol(str.c_str(), nullptr, 0);
   }
+  
+  // FNV-1a 64 bits : empreinte stable d'une execution a l'autre
+  uint64_t hash(const std::string& data)
+  {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
 }
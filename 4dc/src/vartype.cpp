@@ -13,12 +13,30 @@ std::ostream& operator<<(std::ostream& out, VarType vtype){
   case VarType::INT:
     out << "int";
     break;
+  case VarType::LONG:
+    out << "long";
+    break;
+  case VarType::REAL:
+    out << "real";
+    break;
   case VarType::STRING:
     out << "string";
     break;
   case VarType::BOOLEAN:
     out << "boolean";
     break;
+  case VarType::OBJECT:
+    out << "object";
+    break;
+  case VarType::INT_ARRAY:
+    out << "int array";
+    break;
+  case VarType::REAL_ARRAY:
+    out << "real array";
+    break;
+  case VarType::STRING_ARRAY:
+    out << "string array";
+    break;
   case VarType::VOID:
     out << "void";
     break;
@@ -0,0 +1,156 @@
+/*
+ * Programme hote de lib4dc : creation d'un contexte, ajout et compilation de
+ * methodes, recherche et appels, destruction. Les chemins d'erreur renvoient
+ * une erreur sans interrompre le programme.
+ */
+#include "lib4dc.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void check(int condition, const char* message)
+{
+  if (!condition) {
+    fprintf(stderr, "Echec : %s\n", message);
+    ++failures;
+  }
+}
+
+/* Une erreur attendue : son message est non vide, puis elle est liberee */
+static void expectError(fourdc_error* error, const char* message)
+{
+  check(error != NULL && strlen(fourdc_error_message(error)) > 0, message);
+  if (error) {
+    fourdc_error_dispose(error);
+  }
+}
+
+static void expectSuccess(fourdc_error* error, const char* message)
+{
+  if (error) {
+    fprintf(stderr, "%s\n", fourdc_error_message(error));
+    fourdc_error_dispose(error);
+  }
+  check(error == NULL, message);
+}
+
+static void testMethods(void)
+{
+  const char* options[] = {"-O2"};
+  const char* add = "$0 := $1 + $2";
+  const char* twice = "$0 := add($1; $1)";
+  fourdc_context* context;
+  const fourdc_method* method;
+  int32_t args[2] = {40, 2};
+  int32_t result = 0;
+
+  expectSuccess(fourdc_context_create(options, 1, &context), "creation du contexte");
+  expectError(fourdc_lookup(context, "add", &method), "recherche avant compilation");
+  expectSuccess(fourdc_add_method(context, "add", add, strlen(add)), "ajout de add");
+  expectSuccess(fourdc_add_method(context, "twice", twice, strlen(twice)), "ajout de twice");
+  expectSuccess(fourdc_compile(context), "compilation");
+  expectError(fourdc_compile(context), "seconde compilation");
+  expectError(fourdc_add_method(context, "late", add, strlen(add)), "ajout apres compilation");
+
+  expectSuccess(fourdc_lookup(context, "add", &method), "recherche de add");
+  check(method != NULL && fourdc_method_args(method) == 2, "arguments de add");
+  if (method) {
+    expectSuccess(fourdc_call(method, args, 2, &result), "appel de add");
+    check(result == 42, "add(40; 2) = 42");
+    expectError(fourdc_call(method, args, 1, &result), "appel de add avec un argument");
+  }
+
+  expectSuccess(fourdc_lookup(context, "twice", &method), "recherche de twice");
+  if (method) {
+    args[0] = 21;
+    expectSuccess(fourdc_call(method, args, 1, &result), "appel de twice");
+    check(result == 42, "twice(21) = 42");
+  }
+
+  expectError(fourdc_lookup(context, "unknown", &method), "recherche d'une methode inconnue");
+  check(method == NULL, "methode inconnue : NULL");
+  fourdc_context_dispose(context);
+}
+
+/* Contexte compile et appele : une methode d'un argument, NULL en cas d'echec */
+static fourdc_context* compileValue(const char* source, const fourdc_method** method)
+{
+  fourdc_context* context;
+
+  *method = NULL;
+  expectSuccess(fourdc_context_create(NULL, 0, &context), "creation du contexte");
+  if (!context) {
+    return NULL;
+  }
+  expectSuccess(fourdc_add_method(context, "value", source, strlen(source)), "ajout de value");
+  expectSuccess(fourdc_compile(context), "compilation de value");
+  expectSuccess(fourdc_lookup(context, "value", method), "recherche de value");
+  return context;
+}
+
+/*
+ * Deux contextes l'un apres l'autre, avec une methode et un attribut de meme
+ * nom mais de types differents : chaque contexte garde ses propres types,
+ * le runtime commun garde des resultats separes
+ */
+static void testContexts(void)
+{
+  const char* numbers = "C_OBJECT($o)\n$o := New object\n$o.size := $1 * 2\n$0 := $o.size";
+  const char* texts = "C_OBJECT($o)\n$o := New object\n$o.size := String($1)\n$0 := Length($o.size) + 100";
+  fourdc_context* first;
+  fourdc_context* second;
+  const fourdc_method* method;
+  int32_t arg = 21;
+  int32_t result = 0;
+
+  first = compileValue(numbers, &method);
+  if (method) {
+    expectSuccess(fourdc_call(method, &arg, 1, &result), "appel de value (premier contexte)");
+    check(result == 42, "premier contexte : value(21) = 42");
+  }
+
+  second = compileValue(texts, &method);
+  if (method) {
+    arg = 12345;
+    expectSuccess(fourdc_call(method, &arg, 1, &result), "appel de value (second contexte)");
+    check(result == 105, "second contexte : value(12345) = 105");
+  }
+
+  /* Le premier contexte reste utilisable apres la creation du second */
+  if (first) {
+    expectSuccess(fourdc_lookup(first, "value", &method), "nouvelle recherche de value");
+    if (method) {
+      arg = 5;
+      expectSuccess(fourdc_call(method, &arg, 1, &result), "nouvel appel de value (premier contexte)");
+      check(result == 10, "premier contexte : value(5) = 10");
+    }
+  }
+  fourdc_context_dispose(first);
+  fourdc_context_dispose(second);
+}
+
+static void testErrors(void)
+{
+  const char* badOptions[] = {"--unknown-option"};
+  const char* badSource = "$0 := (1 +";
+  fourdc_context* context;
+
+  expectError(fourdc_context_create(badOptions, 1, &context), "option inconnue");
+  check(context == NULL, "option inconnue : pas de contexte");
+
+  /* Erreur de compilation : le contexte ne peut plus qu'etre detruit */
+  expectSuccess(fourdc_context_create(NULL, 0, &context), "creation du contexte");
+  expectError(fourdc_compile(context), "compilation sans methode");
+  expectSuccess(fourdc_add_method(context, "bad", badSource, strlen(badSource)), "ajout de bad");
+  expectError(fourdc_compile(context), "compilation de bad");
+  fourdc_context_dispose(context);
+}
+
+int main(void)
+{
+  testMethods();
+  testContexts();
+  testErrors();
+  return failures == 0 ? 0 : 1;
+}